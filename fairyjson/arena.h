@@ -0,0 +1,175 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace fairy {
+
+    /**
+     * 分块的 bump 分配器
+     * 每次分配只移动当前块内的指针，块用完后再向系统申请新块；
+     * 单次分配无法单独释放，只能通过 clear() 或析构一次性归还全部块
+     */
+    class Arena {
+    public:
+        static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+        explicit Arena(size_t chunkSize = DEFAULT_CHUNK_SIZE) :
+            chunkSize(chunkSize < MIN_CHUNK_SIZE ? size_t(MIN_CHUNK_SIZE) : chunkSize)
+        {}
+
+        ~Arena() {
+            releaseChunks(nullptr);
+        }
+
+        Arena(const Arena&) = delete;
+        Arena& operator=(const Arena&) = delete;
+
+        /**
+         * 从当前块中切出一段内存
+         * @param size 所需字节数
+         * @param align 对齐要求，必须是 2 的幂
+         * @return 分配到的内存地址
+         */
+        void* allocate(size_t size, size_t align = alignof(std::max_align_t)) {
+            auto p = alignUp(cur, align);
+            if (cur == nullptr || p + size > end) {
+                p = alignUp(newChunk(size + align), align);
+            }
+            cur = p + size;
+            allocated += size;
+            return p;
+        }
+
+        /**
+         * 释放全部内存，但保留第一个块以供复用
+         */
+        void clear() {
+            if (head == nullptr)
+                return;
+            // 块链表是头插的，最早申请的块在尾部
+            Chunk* first = head;
+            while (first->next != nullptr)
+                first = first->next;
+            releaseChunks(first);
+            head = first;
+            cur = first->data();
+            end = cur + first->size;
+            allocated = 0;
+        }
+
+        /**
+         * @return 自上次 clear() 以来分配出去的字节数
+         */
+        size_t bytesAllocated() const {
+            return allocated;
+        }
+
+        /**
+         * @return 当前持有的块的数量
+         */
+        size_t chunkCount() const {
+            size_t n = 0;
+            for (auto chk = head; chk != nullptr; chk = chk->next)
+                ++n;
+            return n;
+        }
+
+    private:
+        static const size_t MIN_CHUNK_SIZE = 256;
+
+        struct Chunk {
+            Chunk* next;
+            size_t size;
+
+            char* data() {
+                return reinterpret_cast<char*>(this + 1);
+            }
+        };
+
+        static char* alignUp(char* p, size_t align) {
+            auto addr = reinterpret_cast<uintptr_t>(p);
+            return reinterpret_cast<char*>((addr + align - 1) & ~(uintptr_t)(align - 1));
+        }
+
+        /**
+         * 申请一个新块，超过块大小的请求单独占用一个块
+         * @param minSize 新块至少要容纳的字节数
+         * @return 新块可用区域的起始地址
+         */
+        char* newChunk(size_t minSize) {
+            size_t size = minSize > chunkSize ? minSize : chunkSize;
+            auto chk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + size));
+            chk->next = head;
+            chk->size = size;
+            head = chk;
+            cur = chk->data();
+            end = cur + size;
+            return cur;
+        }
+
+        /**
+         * 沿块链表逐个释放，直到遇到 keep 为止
+         */
+        void releaseChunks(Chunk* keep) {
+            while (head != nullptr && head != keep) {
+                auto next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+            if (keep != nullptr)
+                keep->next = nullptr;
+        }
+
+        Chunk* head = nullptr;
+        char* cur = nullptr;
+        char* end = nullptr;
+        size_t chunkSize;
+        size_t allocated = 0;
+    };
+
+
+    /**
+     * 供 STL 容器使用的分配器
+     * 绑定了 Arena 时从 Arena 中分配且 deallocate 为空操作，否则退化为普通的堆分配
+     */
+    template <typename T>
+    struct ArenaAllocator {
+        typedef T value_type;
+
+        Arena* arena = nullptr;
+
+        ArenaAllocator() = default;
+
+        explicit ArenaAllocator(Arena* a) : arena(a) {}
+
+        template <typename U>
+        ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+        T* allocate(size_t n) {
+            if (arena != nullptr)
+                return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, size_t) {
+            if (arena == nullptr)
+                ::operator delete(p);
+        }
+    };
+
+    template <typename T, typename U>
+    inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+        return a.arena == b.arena;
+    }
+
+    template <typename T, typename U>
+    inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+        return a.arena != b.arena;
+    }
+}
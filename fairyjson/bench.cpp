@@ -0,0 +1,1355 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <new>
+#include <string>
+#include "fairy_json.h"
+#include "simd.h"
+#include "number.h"
+#include "key_pool.h"
+#include "lazy_json.h"
+#include "structural.h"
+#include "tape.h"
+#include "sax.h"
+#include "incremental.h"
+#include "ndjson.h"
+#include "parallel.h"
+#include "json_path.h"
+#include "projection.h"
+#include "msgpack.h"
+#include "bind.h"
+#include <fstream>
+#include <vector>
+#include <sstream>
+#include <map>
+#include <algorithm>
+
+
+using namespace fairy;
+
+/*
+ * 简单的性能测试程序，请在 Release 模式下运行：
+ *   cmake -DCMAKE_BUILD_TYPE=Release ... && ./fairyjson_bench
+ */
+
+static size_t alloc_count = 0;
+static size_t alloc_bytes = 0;
+
+void* operator new(size_t size) {
+    ++alloc_count;
+    alloc_bytes += size;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double elapsed_us(bench_clock::time_point begin, bench_clock::time_point end) {
+    return std::chrono::duration<double, std::micro>(end - begin).count();
+}
+
+/**
+ * 生成一份由 n 条记录组成的 json 数组
+ */
+static std::string make_records(int n) {
+    std::string json = "[";
+    char buf[512];
+    for (int i = 0; i < n; ++i) {
+        snprintf(buf, sizeof(buf),
+                 "%s{\"id\": %d, \"name\": \"user_%d\", \"email\": \"user_%d@example.com\", "
+                 "\"tags\": [\"alpha\", \"beta\", \"gamma\"], \"score\": %d.25, \"active\": %s, "
+                 "\"address\": {\"city\": \"Beijing\", \"street\": \"No.%d Changan Avenue\", \"zip\": \"100%03d\"}}",
+                 i == 0 ? "" : ", ", i, i, i, i % 100, i % 2 ? "true" : "false", i, i % 1000);
+        json += buf;
+    }
+    json += "]";
+    return json;
+}
+
+/**
+ * 生成一份以长字符串为主的 json 数组，模拟日志类数据，每隔几条带有转义字符
+ */
+static std::string make_log_lines(int n) {
+    std::string json = "[";
+    char buf[512];
+    for (int i = 0; i < n; ++i) {
+        snprintf(buf, sizeof(buf),
+                 "%s\"2021-05-14T10:%02d:%02d.%03dZ INFO [worker-%d] request handled: method=GET path=/api/v1/users/%d "
+                 "status=200 latency=%dms agent=Mozilla/5.0 (X11; Linux x86_64)%s\"",
+                 i == 0 ? "" : ", ", i / 60 % 60, i % 60, i % 1000, i % 8, i, i % 97,
+                 i % 4 == 0 ? " msg=\\\"quoted\\\"\\ttab\\u00e9" : "");
+        json += buf;
+    }
+    json += "]";
+    return json;
+}
+
+/**
+ * 以字符串为主的负载下的解析吞吐量
+ */
+static void bench_strings(const std::string& json, int rounds) {
+    printf("== string-heavy parse (%zu bytes, %d rounds) ==\n", json.size(), rounds);
+    printf("%-16s %14s %14s %14s\n", "mode", "allocs/parse", "parse(us)", "MB/s");
+    size_t allocs = 0;
+    double parse_us = 0;
+    for (int i = 0; i < rounds; ++i) {
+        FieldValue v;
+        const size_t before = alloc_count;
+        auto t0 = bench_clock::now();
+        json_parse(&v, json.c_str());
+        auto t1 = bench_clock::now();
+        allocs += alloc_count - before;
+        v.freeSpace();
+        parse_us += elapsed_us(t0, t1);
+    }
+    printf("%-16s %14zu %14.1f %14.1f\n", "heap", allocs / rounds, parse_us / rounds, json.size() * rounds / parse_us);
+
+    std::string buffer;
+    allocs = 0, parse_us = 0;
+    for (int i = 0; i < rounds; ++i) {
+        FieldValue v;
+        buffer = json;
+        const size_t before = alloc_count;
+        auto t0 = bench_clock::now();
+        json_parse_insitu(&v, &buffer[0]);
+        auto t1 = bench_clock::now();
+        allocs += alloc_count - before;
+        v.freeSpace();
+        parse_us += elapsed_us(t0, t1);
+    }
+    printf("%-16s %14zu %14.1f %14.1f\n", "insitu", allocs / rounds, parse_us / rounds, json.size() * rounds / parse_us);
+
+    Document doc;
+    allocs = 0, parse_us = 0;
+    for (int i = 0; i < rounds; ++i) {
+        buffer = json;
+        const size_t before = alloc_count;
+        auto t0 = bench_clock::now();
+        json_parse_insitu(&doc, &buffer[0]);
+        auto t1 = bench_clock::now();
+        allocs += alloc_count - before;
+        doc.clear();
+        parse_us += elapsed_us(t0, t1);
+    }
+    printf("%-16s %14zu %14.1f %14.1f\n", "insitu+document", allocs / rounds, parse_us / rounds, json.size() * rounds / parse_us);
+    printf("\n");
+}
+
+/**
+ * 去掉字符串之外的全部空白
+ */
+static std::string minify(const std::string& json) {
+    std::string out;
+    bool inString = false;
+    for (size_t i = 0; i < json.size(); ++i) {
+        const char ch = json[i];
+        if (inString) {
+            out += ch;
+            if (ch == '\\')
+                out += json[++i];
+            else if (ch == '"')
+                inString = false;
+        } else if (ch == '"') {
+            inString = true;
+            out += ch;
+        } else if (!isWhitespace(ch)) {
+            out += ch;
+        }
+    }
+    return out;
+}
+
+/**
+ * 把紧凑的 json 按“换行 + 缩进”的方式重新排版
+ */
+static std::string indent(const std::string& json, int width) {
+    std::string out;
+    bool inString = false;
+    int depth = 0;
+    for (size_t i = 0; i < json.size(); ++i) {
+        const char ch = json[i];
+        if (inString) {
+            out += ch;
+            if (ch == '\\')
+                out += json[++i];
+            else if (ch == '"')
+                inString = false;
+            continue;
+        }
+        switch (ch) {
+            case '"':
+                inString = true;
+                out += ch;
+                break;
+            case '{': case '[':
+                out += ch;
+                out += '\n';
+                out.append(++depth * width, ' ');
+                break;
+            case '}': case ']':
+                out += '\n';
+                out.append(--depth * width, ' ');
+                out += ch;
+                break;
+            case ',':
+                out += ",\n";
+                out.append(depth * width, ' ');
+                break;
+            case ':':
+                out += ": ";
+                break;
+            default:
+                out += ch;
+        }
+    }
+    return out;
+}
+
+static double parse_throughput(const std::string& json, int rounds) {
+    double parse_us = 0;
+    for (int i = 0; i < rounds; ++i) {
+        FieldValue v;
+        auto t0 = bench_clock::now();
+        json_parse(&v, json.c_str());
+        auto t1 = bench_clock::now();
+        v.freeSpace();
+        parse_us += elapsed_us(t0, t1);
+    }
+    return json.size() * rounds / parse_us;
+}
+
+/**
+ * 依次跳过全部空白与单个非空白字节，只测量空白扫描内核本身
+ */
+template <const char* (*skip)(const char*)>
+static double skip_throughput(const std::string& json, int rounds) {
+    size_t tokens = 0;
+    auto t0 = bench_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        for (const char* p = skip(json.c_str()); *p != '\0'; p = skip(p + 1))
+            ++tokens;
+    }
+    auto t1 = bench_clock::now();
+    if (tokens == 0)
+        printf("unreachable\n");
+    return json.size() * rounds / elapsed_us(t0, t1);
+}
+
+/**
+ * 同一份数据的紧凑版本与缩进版本的解析吞吐量
+ */
+static void bench_whitespace(const std::string& json, int rounds) {
+    const std::string compact = minify(json);
+    const std::string pretty = indent(compact, 4);
+    printf("== whitespace: minified (%zu bytes) vs indented (%zu bytes), %d rounds ==\n",
+           compact.size(), pretty.size(), rounds);
+    printf("%-16s %14s %14s %14s\n", "input", "parse MB/s", "skip MB/s", "scalar MB/s");
+    printf("%-16s %14.1f %14.1f %14.1f\n", "minified", parse_throughput(compact, rounds),
+           skip_throughput<skipWhitespace>(compact, rounds), skip_throughput<skipWhitespaceScalar>(compact, rounds));
+    printf("%-16s %14.1f %14.1f %14.1f\n", "indented", parse_throughput(pretty, rounds),
+           skip_throughput<skipWhitespace>(pretty, rounds), skip_throughput<skipWhitespaceScalar>(pretty, rounds));
+    printf("\n");
+}
+
+/**
+ * 生成 n 个数字组成的 json 数组：integers 为 ID/时间戳一类的整数，否则为 canada.json 一类的坐标浮点数
+ */
+static std::string make_numbers(int n, bool integers) {
+    std::string json = "[";
+    char buf[64];
+    srand(42);
+    for (int i = 0; i < n; ++i) {
+        if (integers)
+            snprintf(buf, sizeof(buf), "%s%lld", i == 0 ? "" : ",", 1600000000000LL + (long long)rand() * rand());
+        else
+            snprintf(buf, sizeof(buf), "%s%.15g", i == 0 ? "" : ",", (rand() - RAND_MAX / 2) / 1e6 * 0.37);
+        json += buf;
+    }
+    json += "]";
+    return json;
+}
+
+/**
+ * 数字解析：readNumber 与 strtod 的单个数字耗时，以及整个数组的解析吞吐量
+ */
+static void bench_numbers(const std::string& json, const char* name, int rounds) {
+    std::vector<const char*> tokens;
+    for (const char* p = json.c_str() + 1; *p != '\0'; ++p) {
+        tokens.push_back(p);
+        while (*p != ',' && *p != ']')
+            ++p;
+    }
+    double sink = 0;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (auto token : tokens)
+            sink += strtod(token, nullptr);
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (auto token : tokens) {
+            FieldValue v;
+            const char* end;
+            readNumber(token, &end, &v);
+            sink += v.getNumber();
+        }
+    }
+    auto t2 = bench_clock::now();
+    const double count = double(tokens.size()) * rounds;
+    printf("%-16s %14.1f %14.1f %14.1f\n", name, elapsed_us(t0, t1) * 1000 / count, elapsed_us(t1, t2) * 1000 / count,
+           parse_throughput(json, rounds));
+    if (sink == 0.5)
+        printf("unreachable\n");
+}
+
+/**
+ * 格式化 double：ostringstream（旧实现，默认 6 位精度，不能还原）、snprintf("%.17g") 与 writeDouble 的对比
+ */
+static void bench_write_doubles(const std::string& json, int rounds) {
+    FieldValue v;
+    json_parse(&v, json.c_str());
+    std::vector<double> values;
+    for (auto& e : *v.getArray())
+        values.push_back(e.getNumber());
+    v.freeSpace();
+
+    char buf[64];
+    size_t sink = 0;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        std::ostringstream os;
+        for (double d : values)
+            os << d << ',';
+        sink += os.str().size();
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (double d : values)
+            sink += snprintf(buf, sizeof(buf), "%.17g", d);
+    }
+    auto t2 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (double d : values)
+            sink += writeDouble(d, buf) - buf;
+    }
+    auto t3 = bench_clock::now();
+    const double count = double(values.size()) * rounds;
+    printf("== double formatting (%zu values, %d rounds) ==\n", values.size(), rounds);
+    printf("%-16s %14s %14s %14s\n", "", "ostream(ns)", "%.17g(ns)", "writeDouble(ns)");
+    printf("%-16s %14.1f %14.1f %14.1f\n", "doubles", elapsed_us(t0, t1) * 1000 / count,
+           elapsed_us(t1, t2) * 1000 / count, elapsed_us(t2, t3) * 1000 / count);
+    printf("\n");
+    if (sink == 1)
+        printf("unreachable\n");
+}
+
+/**
+ * 对比普通堆分配与 Document(Arena) 两种模式下的分配次数与耗时
+ */
+static void bench_arena(const std::string& json, int rounds) {
+    printf("== arena vs heap (%zu bytes, %d rounds) ==\n", json.size(), rounds);
+    printf("%-16s %14s %14s %14s\n", "mode", "allocs/parse", "parse(us)", "release(us)");
+
+    size_t allocs = 0;
+    double parse_us = 0, release_us = 0;
+    for (int i = 0; i < rounds; ++i) {
+        FieldValue v;
+        const size_t before = alloc_count;
+        auto t0 = bench_clock::now();
+        json_parse(&v, json.c_str());
+        auto t1 = bench_clock::now();
+        allocs += alloc_count - before;
+        v.freeSpace();
+        auto t2 = bench_clock::now();
+        parse_us += elapsed_us(t0, t1);
+        release_us += elapsed_us(t1, t2);
+    }
+    printf("%-16s %14zu %14.1f %14.1f\n", "heap", allocs / rounds, parse_us / rounds, release_us / rounds);
+
+    allocs = 0, parse_us = 0, release_us = 0;
+    for (int i = 0; i < rounds; ++i) {
+        const size_t before = alloc_count;
+        auto t0 = bench_clock::now();
+        auto doc = new Document();
+        json_parse(doc, json.c_str());
+        auto t1 = bench_clock::now();
+        allocs += alloc_count - before;
+        delete doc;
+        auto t2 = bench_clock::now();
+        parse_us += elapsed_us(t0, t1);
+        release_us += elapsed_us(t1, t2);
+    }
+    printf("%-16s %14zu %14.1f %14.1f\n", "document", allocs / rounds, parse_us / rounds, release_us / rounds);
+
+    allocs = 0, parse_us = 0, release_us = 0;
+    Document reused;
+    json_parse(&reused, json.c_str());
+    for (int i = 0; i < rounds; ++i) {
+        const size_t before = alloc_count;
+        auto t0 = bench_clock::now();
+        json_parse(&reused, json.c_str());
+        auto t1 = bench_clock::now();
+        allocs += alloc_count - before;
+        reused.clear();
+        auto t2 = bench_clock::now();
+        parse_us += elapsed_us(t0, t1);
+        release_us += elapsed_us(t1, t2);
+    }
+    printf("%-16s %14zu %14.1f %14.1f\n", "document(reuse)", allocs / rounds, parse_us / rounds, release_us / rounds);
+    printf("\n");
+}
+
+static void bench_stringify(const std::string& json, int rounds) {
+    FieldValue v;
+    json_parse(&v, json.c_str());
+
+    size_t sink = 0;
+    auto t0 = bench_clock::now();
+    size_t a0 = alloc_count;
+    for (int r = 0; r < rounds; ++r)
+        sink += jsonStringify(&v).size();
+    size_t a1 = alloc_count;
+    auto t1 = bench_clock::now();
+    std::string out;
+    for (int r = 0; r < rounds; ++r) {
+        out.clear();
+        jsonStringify(&v, &out);
+        sink += out.size();
+    }
+    size_t a2 = alloc_count;
+    auto t2 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        out.clear();
+        jsonStringify(&v, &out, StringifyStyle::PRETTY);
+        sink += out.size();
+    }
+    auto t3 = bench_clock::now();
+    const double mb = double(jsonStringify(&v).size()) * rounds / (1024 * 1024);
+    printf("== stringify (%zu bytes compact, %d rounds) ==\n", jsonStringify(&v).size(), rounds);
+    printf("%-16s %14s %14s\n", "", "MB/s", "allocs/round");
+    printf("%-16s %14.1f %14.1f\n", "new string", mb / (elapsed_us(t0, t1) / 1e6), double(a1 - a0) / rounds);
+    printf("%-16s %14.1f %14.1f\n", "reused buffer", mb / (elapsed_us(t1, t2) / 1e6), double(a2 - a1) / rounds);
+    printf("%-16s %14.1f\n", "pretty", mb / (elapsed_us(t2, t3) / 1e6));
+    printf("\n");
+    v.freeSpace();
+    if (sink == 1)
+        printf("unreachable\n");
+}
+
+/**
+ * 生成 count 个对象组成的数组，每个对象有 width 个键
+ */
+static std::string make_objects(int count, int width) {
+    std::string json = "[";
+    for (int i = 0; i < count; ++i) {
+        json += i == 0 ? "{" : ",{";
+        for (int k = 0; k < width; ++k) {
+            if (k != 0)
+                json += ",";
+            json += "\"field_" + std::to_string(k) + "\":" + std::to_string(i + k);
+        }
+        json += "}";
+    }
+    json += "]";
+    return json;
+}
+
+static void bench_objects(const char* name, int count, int width, int rounds) {
+    const std::string json = make_objects(count, width);
+    std::vector<std::string> keys;
+    for (int k = 0; k < width; ++k)
+        keys.push_back("field_" + std::to_string(k));
+
+    const double parseMbs = parse_throughput(json, rounds);
+
+    FieldValue v;
+    json_parse(&v, json.c_str());
+    // 对照：同样的数据放进 std::multimap<std::string, FieldValue>
+    std::vector<std::multimap<std::string, FieldValue>> maps(count);
+    for (int i = 0; i < count; ++i) {
+        for (auto& item : *(*v.getArray())[i].getObj()) {
+            auto it = maps[i].emplace(std::string(item.first.s, item.first.len), FieldValue(JsonFieldType::J_INT64));
+            it->second.setInt64(item.second.getInt64());
+        }
+    }
+
+    int64_t sink = 0;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (int i = 0; i < count; ++i) {
+            for (auto& key : keys)
+                sink += maps[i].find(key)->second.getInt64();
+        }
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (auto& e : *v.getArray()) {
+            for (auto& key : keys)
+                sink += e.getObj()->find(key)->second.getInt64();
+        }
+    }
+    auto t2 = bench_clock::now();
+    const double lookups = double(count) * width * rounds;
+    printf("%-16s %14.1f %14.1f %14.1f\n", name, parseMbs,
+           elapsed_us(t0, t1) * 1000 / lookups, elapsed_us(t1, t2) * 1000 / lookups);
+    v.freeSpace();
+    if (sink == 1)
+        printf("unreachable\n");
+}
+
+static void bench_key_pool(const std::string& json, int rounds) {
+    KeyPool pool;
+    ParseOptions options;
+    options.keyPool = &pool;
+    FieldValue warm;
+    json_parse(&warm, json.c_str(), options);
+    warm.freeSpace();
+
+    printf("== key interning (%zu bytes, %d rounds) ==\n", json.size(), rounds);
+    printf("%-16s %14s %14s\n", "mode", "allocs/parse", "parse MB/s");
+    const ParseOptions modes[] = { ParseOptions(), options };
+    const char* names[] = { "heap keys", "key pool" };
+    for (int m = 0; m < 2; ++m) {
+        double parse_us = 0;
+        size_t allocs = 0;
+        for (int r = 0; r < rounds; ++r) {
+            FieldValue v;
+            size_t a0 = alloc_count;
+            auto t0 = bench_clock::now();
+            json_parse(&v, json.c_str(), modes[m]);
+            auto t1 = bench_clock::now();
+            allocs += alloc_count - a0;
+            v.freeSpace();
+            parse_us += elapsed_us(t0, t1);
+        }
+        printf("%-16s %14zu %14.1f\n", names[m], allocs / rounds, json.size() * rounds / parse_us);
+    }
+    printf("\n");
+}
+
+static void bench_lazy(const std::string& json, int rounds) {
+    // 只读取第一条记录的三个字段，以及遍历所有记录累加一个字段
+    double sink = 0;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue v;
+        json_parse(&v, json.c_str());
+        const FieldObject* first = (*v.getArray())[0].getObj();
+        sink += first->find("id")->second.getNumber() + first->find("score")->second.getNumber()
+                + first->find("name")->second.getJStr()->len;
+        v.freeSpace();
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        LazyDocument doc(json.c_str());
+        LazyValue root, e, field;
+        LazyArray records;
+        LazyObject first;
+        doc.getRoot(&root);
+        root.getArray(&records);
+        records.next(&e);
+        e.getObject(&first);
+        double n = 0;
+        std::string name;
+        first.findField("id", &field);
+        field.getNumber(&n);
+        sink += n;
+        first.findField("score", &field);
+        field.getNumber(&n);
+        sink += n;
+        first.findField("name", &field);
+        field.getString(&name);
+        sink += name.size();
+    }
+    auto t2 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue v;
+        json_parse(&v, json.c_str());
+        for (auto& e : *v.getArray())
+            sink += e.getObj()->find("score")->second.getNumber();
+        v.freeSpace();
+    }
+    auto t3 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        LazyDocument doc(json.c_str());
+        LazyValue root, e, field;
+        LazyArray records;
+        doc.getRoot(&root);
+        root.getArray(&records);
+        while (records.next(&e)) {
+            LazyObject obj;
+            e.getObject(&obj);
+            double n = 0;
+            obj.findField("score", &field);
+            field.getNumber(&n);
+            sink += n;
+        }
+    }
+    auto t4 = bench_clock::now();
+    printf("== on-demand access (%zu bytes, %d rounds) ==\n", json.size(), rounds);
+    printf("%-16s %14s %14s\n", "query", "dom(us)", "lazy(us)");
+    printf("%-16s %14.1f %14.1f\n", "3 fields", elapsed_us(t0, t1) / rounds, elapsed_us(t1, t2) / rounds);
+    printf("%-16s %14.1f %14.1f\n", "sum all scores", elapsed_us(t2, t3) / rounds, elapsed_us(t3, t4) / rounds);
+    printf("\n");
+    if (sink == 1)
+        printf("unreachable\n");
+}
+
+static void bench_indexed(const std::string& json, const char* name, int rounds) {
+    StructuralIndex index;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        index.build(json.data(), json.size());
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        Document doc;
+        json_parse(&doc, json.c_str());
+    }
+    auto t2 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        Document doc;
+        json_parse_indexed(&doc, json.c_str());
+    }
+    auto t3 = bench_clock::now();
+    const double mb = double(json.size()) * rounds / (1024 * 1024);
+    printf("%-16s %14.1f %14.1f %14.1f\n", name, mb / (elapsed_us(t0, t1) / 1e6),
+           mb / (elapsed_us(t1, t2) / 1e6), mb / (elapsed_us(t2, t3) / 1e6));
+}
+
+static double sum_numbers(const FieldValue* v) {
+    switch (v->getType()) {
+        case JsonFieldType::J_NUMBER:
+        case JsonFieldType::J_INT64:
+        case JsonFieldType::J_UINT64:
+            return v->getNumber();
+        case JsonFieldType::J_STRING:
+            return double(v->getJStr()->len);
+        case JsonFieldType::J_ARRAY: {
+            double sum = 0;
+            for (auto& e : *v->getArray())
+                sum += sum_numbers(&e);
+            return sum;
+        }
+        case JsonFieldType::J_OBJECT: {
+            double sum = 0;
+            for (auto& m : *v->getObj())
+                sum += sum_numbers(&m.second);
+            return sum;
+        }
+        default:
+            return 0;
+    }
+}
+
+static double sum_numbers(TapeRef v) {
+    switch (v.getType()) {
+        case JsonFieldType::J_NUMBER:
+        case JsonFieldType::J_INT64:
+        case JsonFieldType::J_UINT64:
+            return v.getNumber();
+        case JsonFieldType::J_STRING:
+            return double(v.getJStr().len);
+        case JsonFieldType::J_ARRAY:
+        case JsonFieldType::J_OBJECT: {
+            double sum = 0;
+            for (auto it = v.begin(), end = v.end(); it != end; ++it)
+                sum += sum_numbers(*it);
+            return sum;
+        }
+        default:
+            return 0;
+    }
+}
+
+static void bench_tape(const std::string& json, int rounds) {
+    // 内存占用按解析过程中从堆上申请的字节数计算
+    FieldValue v;
+    size_t before = alloc_bytes;
+    json_parse(&v, json.c_str());
+    const size_t domBytes = alloc_bytes - before;
+    TapeDocument tape;
+    json_parse(&tape, json.c_str());
+    const size_t tapeBytes = tape.memoryUsage();
+
+    double sink = 0;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue dom;
+        json_parse(&dom, json.c_str());
+        dom.freeSpace();
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        json_parse(&tape, json.c_str());
+    auto t2 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        sink += sum_numbers(&v);
+    auto t3 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r)
+        sink += sum_numbers(tape.getRoot());
+    auto t4 = bench_clock::now();
+    v.freeSpace();
+    const double mb = double(json.size()) * rounds / (1024 * 1024);
+    printf("== tape vs FieldValue (%zu bytes, %d rounds) ==\n", json.size(), rounds);
+    printf("%-16s %14s %14s\n", "", "FieldValue", "tape");
+    printf("%-16s %14zu %14zu\n", "memory(bytes)", domBytes, tapeBytes);
+    printf("%-16s %14.1f %14.1f\n", "parse MB/s", mb / (elapsed_us(t0, t1) / 1e6), mb / (elapsed_us(t1, t2) / 1e6));
+    printf("%-16s %14.1f %14.1f\n", "traverse(us)", elapsed_us(t2, t3) / rounds, elapsed_us(t3, t4) / rounds);
+    printf("\n");
+    if (sink == 1)
+        printf("unreachable\n");
+}
+
+class ScoreSumHandler : public BaseSaxHandler<ScoreSumHandler> {
+public:
+    bool key(const char* s, size_t len) {
+        inScore = len == 5 && memcmp(s, "score", 5) == 0;
+        return true;
+    }
+
+    bool number(double d) {
+        if (inScore)
+            sum += d;
+        return true;
+    }
+
+    bool inScore = false;
+    double sum = 0;
+};
+
+static void bench_sax(const std::string& json, int rounds) {
+    // 累加所有记录的 score 字段
+    double sink = 0;
+    size_t allocs = 0;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue v;
+        json_parse(&v, json.c_str());
+        for (auto& e : *v.getArray())
+            sink += e.getObj()->find("score")->second.getNumber();
+        v.freeSpace();
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        ScoreSumHandler h;
+        const size_t before = alloc_count;
+        json_parse_sax(json.c_str(), h);
+        allocs += alloc_count - before;
+        sink += h.sum;
+    }
+    auto t2 = bench_clock::now();
+    const double mb = double(json.size()) * rounds / (1024 * 1024);
+    printf("== SAX aggregation (%zu bytes, %d rounds) ==\n", json.size(), rounds);
+    printf("%-16s %14.1f MB/s\n", "dom + sum", mb / (elapsed_us(t0, t1) / 1e6));
+    printf("%-16s %14.1f MB/s  %zu allocs/parse\n", "sax sum", mb / (elapsed_us(t1, t2) / 1e6), allocs / rounds);
+    printf("\n");
+    if (sink == 1)
+        printf("unreachable\n");
+}
+
+static void bench_incremental(const std::string& json, size_t chunkSize, int rounds) {
+    // 模拟按块到达的网络输入：先拼接再解析，或者逐块送入增量解析器
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        std::string whole;
+        for (size_t i = 0; i < json.size(); i += chunkSize)
+            whole.append(json, i, chunkSize);
+        FieldValue v;
+        json_parse(&v, whole.c_str());
+        v.freeSpace();
+    }
+    auto t1 = bench_clock::now();
+    IncrementalParser parser;
+    for (int r = 0; r < rounds; ++r) {
+        for (size_t i = 0; i < json.size(); i += chunkSize)
+            parser.feed(json.data() + i, std::min(chunkSize, json.size() - i));
+        FieldValue v;
+        parser.finish(&v);
+        v.freeSpace();
+    }
+    auto t2 = bench_clock::now();
+    const double mb = double(json.size()) * rounds / (1024 * 1024);
+    printf("%-16zu %14.1f %14.1f\n", chunkSize, mb / (elapsed_us(t0, t1) / 1e6), mb / (elapsed_us(t1, t2) / 1e6));
+}
+
+/**
+ * 生成 n 行 NDJSON 日志记录
+ */
+static std::string make_ndjson(int n) {
+    std::string out;
+    char buf[512];
+    for (int i = 0; i < n; ++i) {
+        snprintf(buf, sizeof(buf),
+                 "{\"ts\": %d, \"level\": \"%s\", \"host\": \"web-%02d\", \"latency_ms\": %d.%d, "
+                 "\"path\": \"/api/v1/items/%d\", \"tags\": [\"a\", \"b\"]}\n",
+                 1600000000 + i, i % 10 ? "info" : "error", i % 32, i % 500, i % 10, i);
+        out += buf;
+    }
+    return out;
+}
+
+static void bench_ndjson(const std::string& input, int rounds) {
+    // 逐行调用 json_parse 与多线程批量解析，两者都保留所有记录的解析结果
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        std::vector<FieldValue> values;
+        std::string line;
+        size_t begin = 0;
+        while (begin < input.size()) {
+            size_t nl = input.find('\n', begin);
+            if (nl == std::string::npos)
+                nl = input.size();
+            line.assign(input, begin, nl - begin);
+            values.emplace_back();
+            json_parse(&values.back(), line.c_str());
+            begin = nl + 1;
+        }
+        for (auto& v : values)
+            v.freeSpace();
+    }
+    auto t1 = bench_clock::now();
+    std::vector<NdjsonRecord> records;
+    NdjsonParser single(1);
+    for (int r = 0; r < rounds; ++r) {
+        single.parse(input.data(), input.size(), &records);
+        for (auto& record : records)
+            record.value.freeSpace();
+    }
+    auto t2 = bench_clock::now();
+    NdjsonParser parallel;
+    for (int r = 0; r < rounds; ++r) {
+        parallel.parse(input.data(), input.size(), &records);
+        for (auto& record : records)
+            record.value.freeSpace();
+    }
+    auto t3 = bench_clock::now();
+    const double mb = double(input.size()) * rounds / (1024 * 1024);
+    printf("== NDJSON (%zu bytes, %d rounds, MB/s) ==\n", input.size(), rounds);
+    printf("%-16s %14.1f\n", "json_parse loop", mb / (elapsed_us(t0, t1) / 1e6));
+    printf("%-16s %14.1f\n", "1 thread", mb / (elapsed_us(t1, t2) / 1e6));
+    printf("%-13s%3u %14.1f\n", "threads x", parallel.getThreads(), mb / (elapsed_us(t2, t3) / 1e6));
+    printf("\n");
+}
+
+static void bench_parallel(const std::string& json, int rounds) {
+    const unsigned threadCounts[] = { 1, 2, 4 };
+    printf("== parallel top-level array (%zu bytes, %d rounds, MB/s) ==\n", json.size(), rounds);
+    printf("%-16s %14s\n", "threads", "parse");
+    const double mb = double(json.size()) * rounds / (1024 * 1024);
+    for (auto threads : threadCounts) {
+        auto t0 = bench_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            FieldValue v;
+            json_parse_parallel(&v, json.c_str(), threads);
+            v.freeSpace();
+        }
+        auto t1 = bench_clock::now();
+        printf("%-16u %14.1f\n", threads, mb / (elapsed_us(t0, t1) / 1e6));
+    }
+    printf("\n");
+}
+
+static void bench_file(const std::string& json, int rounds) {
+    const char* path = "fairyjson_bench.json";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << json;
+    }
+    // 先把文件读进 std::string 再解析，与直接从内存映射解析
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        std::ifstream in(path, std::ios::binary);
+        std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        FieldValue v;
+        json_parse(&v, content.c_str());
+        v.freeSpace();
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue v;
+        json_parse_file(&v, path);
+        v.freeSpace();
+    }
+    auto t2 = bench_clock::now();
+    remove(path);
+    const double mb = double(json.size()) * rounds / (1024 * 1024);
+    printf("== file (%zu bytes, %d rounds, MB/s) ==\n", json.size(), rounds);
+    printf("%-16s %14.1f\n", "read + parse", mb / (elapsed_us(t0, t1) / 1e6));
+    printf("%-16s %14.1f\n", "json_parse_file", mb / (elapsed_us(t1, t2) / 1e6));
+    printf("\n");
+}
+
+static void bench_length(const std::string& json, int rounds) {
+    // 不以 '\0' 结尾的接收缓冲区：先拷贝成 std::string 再解析、按长度有界地解析；以及带填充的输入
+    const std::vector<char> received(json.begin(), json.end());
+    ParseOptions padded;
+    padded.padded = true;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        const std::string copy(received.data(), received.size());
+        FieldValue v;
+        json_parse(&v, copy.c_str());
+        v.freeSpace();
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue v;
+        json_parse(&v, received.data(), received.size());
+        v.freeSpace();
+    }
+    auto t2 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue v;
+        json_parse(&v, json.c_str(), json.size(), padded);
+        v.freeSpace();
+    }
+    auto t3 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue v;
+        json_parse(&v, json.c_str());
+        v.freeSpace();
+    }
+    auto t4 = bench_clock::now();
+    const double mb = double(json.size()) * rounds / (1024 * 1024);
+    printf("== length-bounded input (%zu bytes, %d rounds, MB/s) ==\n", json.size(), rounds);
+    printf("%-16s %14.1f\n", "copy + parse", mb / (elapsed_us(t0, t1) / 1e6));
+    printf("%-16s %14.1f\n", "bounded", mb / (elapsed_us(t1, t2) / 1e6));
+    printf("%-16s %14.1f\n", "padded", mb / (elapsed_us(t2, t3) / 1e6));
+    printf("%-16s %14.1f\n", "'\\0' terminated", mb / (elapsed_us(t3, t4) / 1e6));
+    printf("\n");
+}
+
+static void bench_depth(const std::string& records, size_t depth, int rounds) {
+    // 常规文档，以及会让递归的解析器耗尽线程栈的深层嵌套
+    const std::string nested = std::string(depth, '[') + "1" + std::string(depth, ']');
+    ParseOptions unlimited;
+    unlimited.maxDepth = depth;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        Document doc;
+        json_parse(&doc, records.c_str());
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        Document doc;
+        json_parse(&doc, nested.c_str(), unlimited);
+    }
+    auto t2 = bench_clock::now();
+    printf("== iterative container parsing (MB/s) ==\n");
+    printf("%-16s %14.1f\n", "records", double(records.size()) * rounds / (1024 * 1024) / (elapsed_us(t0, t1) / 1e6));
+    printf("%-16s %14.1f\n", ("depth " + std::to_string(depth)).c_str(),
+           double(nested.size()) * rounds / (1024 * 1024) / (elapsed_us(t1, t2) / 1e6));
+    printf("\n");
+}
+
+static void bench_json_path(const std::string& input, int rounds) {
+    // 逐条消息按一组路径取值：完整解析后在树上求值、每条路径各自在文本上求值、整组路径在文本上一次求值
+    std::vector<std::string> messages;
+    size_t begin = 0;
+    while (begin < input.size()) {
+        size_t nl = input.find('\n', begin);
+        if (nl == std::string::npos)
+            nl = input.size();
+        messages.emplace_back(input, begin, nl - begin);
+        begin = nl + 1;
+    }
+    const std::vector<std::vector<std::string>> queries = {
+        {"/ts", "/level"},
+        {"/tags/1"},
+        {"/ts", "/level", "/host", "/latency_ms", "/path", "/tags/0", "/tags/1", "/missing"}
+    };
+    const char* names[] = {"first 2 fields", "last field", "8 paths"};
+    printf("== path queries (%zu messages, ms per round) ==\n", messages.size());
+    printf("%-16s %14s %14s %14s\n", "query", "parse+set", "lazy paths", "lazy set");
+    size_t sink = 0;
+    for (size_t q = 0; q < queries.size(); ++q) {
+        std::vector<JsonPath> paths(queries[q].size());
+        JsonPathSet set;
+        size_t id = 0;
+        for (size_t i = 0; i < paths.size(); ++i) {
+            paths[i].compile(queries[q][i]);
+            set.add(queries[q][i], &id);
+        }
+        std::vector<const FieldValue*> found;
+        std::vector<LazyValue> values;
+        auto t0 = bench_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (auto& m : messages) {
+                FieldValue v;
+                json_parse(&v, m.c_str());
+                set.evaluate(&v, &found);
+                sink += found[0] != nullptr;
+            }
+        }
+        auto t1 = bench_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (auto& m : messages) {
+                LazyDocument doc(m.c_str());
+                LazyValue root;
+                doc.getRoot(&root);
+                for (auto& path : paths) {
+                    values.clear();
+                    path.evaluate(root, &values);
+                    sink += values.size();
+                }
+            }
+        }
+        auto t2 = bench_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            for (auto& m : messages) {
+                LazyDocument doc(m.c_str());
+                LazyValue root;
+                doc.getRoot(&root);
+                set.evaluate(root, &values);
+                sink += values[0].exists();
+            }
+        }
+        auto t3 = bench_clock::now();
+        printf("%-16s %14.2f %14.2f %14.2f\n", names[q], elapsed_us(t0, t1) / rounds / 1000,
+               elapsed_us(t1, t2) / rounds / 1000, elapsed_us(t2, t3) / rounds / 1000);
+    }
+    printf("\n");
+    if (sink == 1)
+        printf("unreachable\n");
+}
+
+/**
+ * 生成一条宽事件：width 个字段，字符串、数字、数组与嵌套对象轮流出现
+ */
+static std::string make_wide_event(int seq, int width) {
+    std::string json = "{";
+    char buf[256];
+    for (int k = 0; k < width; ++k) {
+        switch (k % 4) {
+            case 0:
+                snprintf(buf, sizeof(buf), "\"attr_%d\": \"value %d of event %d\"", k, k, seq);
+                break;
+            case 1:
+                snprintf(buf, sizeof(buf), "\"attr_%d\": %d.5", k, seq * k);
+                break;
+            case 2:
+                snprintf(buf, sizeof(buf), "\"attr_%d\": [\"x%d\", \"y\", %d]", k, k, seq);
+                break;
+            default:
+                snprintf(buf, sizeof(buf), "\"attr_%d\": {\"id\": %d, \"label\": \"nested %d\"}", k, seq, k);
+                break;
+        }
+        json += k == 0 ? "" : ", ";
+        json += buf;
+    }
+    json += "}";
+    return json;
+}
+
+static void bench_projection(int count, int width, int rounds) {
+    // 宽事件中只取 5% 的字段：完整解析与按投影解析
+    std::vector<std::string> events;
+    size_t bytes = 0;
+    for (int i = 0; i < count; ++i) {
+        events.push_back(make_wide_event(i, width));
+        bytes += events.back().size();
+    }
+    Projection projection;
+    for (int k = 0; k < width; k += 20) {
+        projection.add("/attr_" + std::to_string(k));
+        projection.add("/attr_" + std::to_string(k + 3) + "/id");
+    }
+    size_t allocs[2] = {0, 0};
+    size_t sink = 0;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (auto& e : events) {
+            const size_t before = alloc_count;
+            FieldValue v;
+            json_parse(&v, e.c_str());
+            sink += v.getObj()->size();
+            v.freeSpace();
+            allocs[0] += alloc_count - before;
+        }
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (auto& e : events) {
+            const size_t before = alloc_count;
+            FieldValue v;
+            json_parse(&v, e.c_str(), projection);
+            sink += v.getObj()->size();
+            v.freeSpace();
+            allocs[1] += alloc_count - before;
+        }
+    }
+    auto t2 = bench_clock::now();
+    const double parses = double(count) * rounds;
+    printf("== projection parsing (%d events x %d fields, %zu bytes, %d rounds) ==\n", count, width, bytes, rounds);
+    printf("%-16s %14s %14s\n", "mode", "allocs/event", "MB/s");
+    printf("%-16s %14.1f %14.1f\n", "full", allocs[0] / parses, double(bytes) * rounds / (1024 * 1024) / (elapsed_us(t0, t1) / 1e6));
+    printf("%-16s %14.1f %14.1f\n", "projected", allocs[1] / parses, double(bytes) * rounds / (1024 * 1024) / (elapsed_us(t1, t2) / 1e6));
+    printf("\n");
+    if (sink == 1)
+        printf("unreachable\n");
+}
+
+static void bench_msgpack(const std::string& json, const char* name, int rounds) {
+    // 缓存命中时的两种还原方式：重新解析文本，或者解码 MessagePack
+    FieldValue v;
+    json_parse(&v, json.c_str());
+    const std::string packed = msgpackEncode(&v);
+    size_t sink = 0;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue parsed;
+        json_parse(&parsed, json.data(), json.size());
+        sink += parsed.getType() == JsonFieldType::J_ARRAY;
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue decoded;
+        msgpack_decode(&decoded, packed);
+        sink += decoded.getType() == JsonFieldType::J_ARRAY;
+    }
+    auto t2 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        Document doc;
+        json_parse(&doc, json.data(), json.size());
+        sink += doc.getRoot()->getType() == JsonFieldType::J_ARRAY;
+    }
+    auto t3 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        Document doc;
+        msgpack_decode(&doc, packed);
+        sink += doc.getRoot()->getType() == JsonFieldType::J_ARRAY;
+    }
+    auto t4 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        std::string out;
+        msgpackEncode(&v, &out);
+        sink += out.size();
+    }
+    auto t5 = bench_clock::now();
+    printf("== MessagePack vs text (%s: %zu bytes json, %zu bytes msgpack, us per document) ==\n",
+           name, json.size(), packed.size());
+    printf("%-16s %14s %14s\n", "mode", "FieldValue", "Document");
+    printf("%-16s %14.1f %14.1f\n", "json_parse", elapsed_us(t0, t1) / rounds, elapsed_us(t2, t3) / rounds);
+    printf("%-16s %14.1f %14.1f\n", "msgpack_decode", elapsed_us(t1, t2) / rounds, elapsed_us(t3, t4) / rounds);
+    printf("%-16s %14.1f\n", "msgpackEncode", elapsed_us(t4, t5) / rounds);
+    printf("\n");
+    if (sink == 1)
+        printf("unreachable\n");
+}
+
+struct BenchAddress {
+    std::string city;
+    std::string street;
+    std::string zip;
+};
+FAIRY_JSON_BIND(BenchAddress, city, street, zip)
+
+struct BenchRecord {
+    int64_t id = 0;
+    std::string name;
+    std::string email;
+    std::vector<std::string> tags;
+    double score = 0.0;
+    bool active = false;
+    BenchAddress address;
+};
+FAIRY_JSON_BIND(BenchRecord, id, name, email, tags, score, active, address)
+
+static std::string bench_member_string(const FieldObject* obj, const char* key) {
+    auto it = obj->find(key);
+    if (it == obj->end() || it->second.getType() != JsonFieldType::J_STRING)
+        return std::string();
+    return std::string(it->second.getJStr()->s, it->second.getJStr()->len);
+}
+
+/**
+ * 不使用绑定时的写法：先建立 FieldValue 树，再逐个成员查找、拷贝到结构体中
+ */
+static void bench_tree_to_records(const FieldValue* v, std::vector<BenchRecord>* out) {
+    out->clear();
+    for (auto& e : *v->getArray()) {
+        const FieldObject* obj = e.getObj();
+        out->emplace_back();
+        BenchRecord& record = out->back();
+        auto it = obj->find("id");
+        if (it != obj->end() && it->second.getType() == JsonFieldType::J_INT64)
+            record.id = it->second.getInt64();
+        record.name = bench_member_string(obj, "name");
+        record.email = bench_member_string(obj, "email");
+        it = obj->find("tags");
+        if (it != obj->end() && it->second.getType() == JsonFieldType::J_ARRAY) {
+            for (auto& tag : *it->second.getArray())
+                record.tags.emplace_back(tag.getJStr()->s, tag.getJStr()->len);
+        }
+        it = obj->find("score");
+        if (it != obj->end() && it->second.isNumber())
+            record.score = it->second.getNumber();
+        it = obj->find("active");
+        record.active = it != obj->end() && it->second.getType() == JsonFieldType::J_TRUE;
+        it = obj->find("address");
+        if (it != obj->end() && it->second.getType() == JsonFieldType::J_OBJECT) {
+            const FieldObject* address = it->second.getObj();
+            record.address.city = bench_member_string(address, "city");
+            record.address.street = bench_member_string(address, "street");
+            record.address.zip = bench_member_string(address, "zip");
+        }
+    }
+}
+
+static FieldValue bench_string_value(const std::string& s) {
+    char* copy = new char[s.size() + 1];
+    memcpy(copy, s.data(), s.size());
+    copy[s.size()] = '\0';
+    FieldValue v(JsonFieldType::J_STRING);
+    v.setJStr(copy, s.size());
+    return v;
+}
+
+static void bench_append_member(FieldObject* obj, const char* key, FieldValue&& value) {
+    const size_t len = strlen(key);
+    char* copy = new char[len + 1];
+    memcpy(copy, key, len + 1);
+    obj->append({copy, len}, std::move(value));
+}
+
+static void bench_records_to_tree(const std::vector<BenchRecord>& records, FieldValue* v) {
+    FieldArray* array = new FieldArray();
+    v->setType(JsonFieldType::J_ARRAY);
+    v->setArray(array);
+    array->reserve(records.size());
+    for (auto& record : records) {
+        FieldObject* obj = new FieldObject();
+        FieldValue id(JsonFieldType::J_INT64);
+        id.setInt64(record.id);
+        bench_append_member(obj, "id", std::move(id));
+        bench_append_member(obj, "name", bench_string_value(record.name));
+        bench_append_member(obj, "email", bench_string_value(record.email));
+        FieldArray* tags = new FieldArray();
+        for (auto& tag : record.tags)
+            tags->push_back(bench_string_value(tag));
+        FieldValue tagsValue(JsonFieldType::J_ARRAY);
+        tagsValue.setArray(tags);
+        bench_append_member(obj, "tags", std::move(tagsValue));
+        FieldValue score(JsonFieldType::J_NUMBER);
+        score.setNumber(record.score);
+        bench_append_member(obj, "score", std::move(score));
+        bench_append_member(obj, "active", FieldValue(record.active ? JsonFieldType::J_TRUE : JsonFieldType::J_FALSE));
+        FieldObject* address = new FieldObject();
+        bench_append_member(address, "city", bench_string_value(record.address.city));
+        bench_append_member(address, "street", bench_string_value(record.address.street));
+        bench_append_member(address, "zip", bench_string_value(record.address.zip));
+        FieldValue addressValue(JsonFieldType::J_OBJECT);
+        addressValue.setObj(address);
+        bench_append_member(obj, "address", std::move(addressValue));
+        FieldValue objValue(JsonFieldType::J_OBJECT);
+        objValue.setObj(obj);
+        array->push_back(std::move(objValue));
+    }
+}
+
+static void bench_bind(const std::string& json, int rounds) {
+    std::vector<BenchRecord> records;
+    size_t sink = 0;
+    auto t0 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue v;
+        json_parse(&v, json.data(), json.size());
+        bench_tree_to_records(&v, &records);
+        sink += records.size();
+    }
+    auto t1 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        Document doc;
+        json_parse(&doc, json.data(), json.size());
+        bench_tree_to_records(doc.getRoot(), &records);
+        sink += records.size();
+    }
+    auto t2 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        json_read(&records, json);
+        sink += records.size();
+    }
+    auto t3 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        FieldValue v;
+        bench_records_to_tree(records, &v);
+        std::string out;
+        jsonStringify(&v, &out);
+        sink += out.size();
+    }
+    auto t4 = bench_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        std::string out;
+        json_write(records, &out);
+        sink += out.size();
+    }
+    auto t5 = bench_clock::now();
+    printf("== struct binding (%zu records, us per document) ==\n", records.size());
+    printf("%-28s %14s\n", "mode", "us");
+    printf("%-28s %14.1f\n", "json_parse + copy", elapsed_us(t0, t1) / rounds);
+    printf("%-28s %14.1f\n", "Document + copy", elapsed_us(t1, t2) / rounds);
+    printf("%-28s %14.1f\n", "json_read", elapsed_us(t2, t3) / rounds);
+    printf("%-28s %14.1f\n", "build tree + jsonStringify", elapsed_us(t3, t4) / rounds);
+    printf("%-28s %14.1f\n", "json_write", elapsed_us(t4, t5) / rounds);
+    printf("\n");
+    if (sink == 1)
+        printf("unreachable\n");
+}
+
+int main() {
+    const std::string records = make_records(2000);
+    const std::string logs = make_log_lines(20000);
+    bench_arena(records, 50);
+    bench_key_pool(records, 50);
+    bench_lazy(records, 50);
+    bench_tape(records, 50);
+    bench_sax(records, 50);
+    printf("== chunked input (MB/s) ==\n");
+    printf("%-16s %14s %14s\n", "chunk bytes", "concat+parse", "incremental");
+    bench_incremental(records, 4096, 50);
+    bench_incremental(records, 16384, 50);
+    printf("\n");
+    bench_ndjson(make_ndjson(100000), 5);
+    bench_parallel(make_records(20000), 5);
+    bench_file(make_records(20000), 5);
+    bench_length(records, 50);
+    bench_depth(records, 1000000, 5);
+    bench_json_path(make_ndjson(20000), 5);
+    bench_projection(5000, 200, 5);
+    bench_msgpack(records, "records", 50);
+    bench_msgpack(logs, "log lines", 20);
+    bench_bind(records, 50);
+    printf("== two-stage parse into Document (MB/s) ==\n");
+    printf("%-16s %14s %14s %14s\n", "input", "stage 1", "recursive", "two-stage");
+    bench_indexed(records, "records", 50);
+    bench_indexed(logs, "log lines", 20);
+    bench_indexed(minify(records), "records (min)", 50);
+    printf("\n");
+    bench_strings(logs, 50);
+    bench_whitespace(records, 50);
+    printf("== numbers ==\n");
+    printf("%-16s %14s %14s %14s\n", "input", "strtod(ns)", "readNumber(ns)", "parse MB/s");
+    const std::string doubles = make_numbers(100000, false);
+    bench_numbers(make_numbers(100000, true), "integers", 20);
+    bench_numbers(doubles, "doubles", 20);
+    printf("\n");
+    bench_write_doubles(doubles, 20);
+    printf("== objects ==\n");
+    printf("%-16s %14s %14s %14s\n", "shape", "parse MB/s", "multimap(ns)", "find(ns)");
+    bench_objects("narrow (5 keys)", 20000, 5, 20);
+    bench_objects("wide (1000 keys)", 100, 1000, 20);
+    printf("\n");
+    bench_stringify(records, 50);
+    bench_stringify(logs, 20);
+    return 0;
+}
@@ -0,0 +1,151 @@
+//
+// Created by yubin on 2021/5/17.
+//
+
+#include "bind.h"
+#include <cmath>
+#include "number.h"
+#include "utils.h"
+#include "simd.h"
+
+namespace fairy {
+
+    BindReader::BindReader(const char* json, const ParseOptions& options) {
+        this->context.json = skipWhitespace(json);
+        this->context.maxDepth = options.depthLimit();
+    }
+
+    JsonParseStatus BindReader::readNull() {
+        if (peek() != 'n')
+            return mismatch();
+        FieldValue v;
+        return parseValue(&this->context, &v);
+    }
+
+    JsonParseStatus BindReader::readBool(bool* b) {
+        const char ch = peek();
+        if (ch != 't' && ch != 'f')
+            return mismatch();
+        FieldValue v;
+        const auto retStatus = parseValue(&this->context, &v);
+        if (retStatus == JsonParseStatus::PARSE_OK)
+            *b = v.getType() == JsonFieldType::J_TRUE;
+        return retStatus;
+    }
+
+    JsonParseStatus BindReader::readNumber(FieldValue* n) {
+        const char ch = peek();
+        if (ch != '-' && (ch < '0' || ch > '9'))
+            return mismatch();
+        return parseNumber(&this->context, n);
+    }
+
+    JsonParseStatus BindReader::readString(std::string* s) {
+        if (peek() != '\"')
+            return mismatch();
+        const char* str = nullptr;
+        size_t len = 0;
+        this->context.strBuf.clear();
+        const auto retStatus = decodeStringRaw(&this->context, &str, &len);
+        if (retStatus == JsonParseStatus::PARSE_OK)
+            s->assign(str, len);
+        return retStatus;
+    }
+
+    JsonParseStatus BindReader::skip() {
+        return skipValue(&this->context, &this->open);
+    }
+
+    JsonParseStatus BindReader::mismatch() {
+        const auto retStatus = skip();
+        return retStatus == JsonParseStatus::PARSE_OK ? JsonParseStatus::PARSE_TYPE_MISMATCH : retStatus;
+    }
+
+    JsonParseStatus BindReader::beginArray() {
+        if (peek() != '[')
+            return mismatch();
+        if (this->context.depth >= this->context.maxDepth)
+            return JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+        ++this->context.depth;
+        this->context.json = skipWhitespace(this->context.json + 1);
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    JsonParseStatus BindReader::nextElement(size_t i, bool* more) {
+        ParseContext* c = &this->context;
+        c->json = skipWhitespace(c->json);
+        if (*c->json == ']') {
+            ++c->json;
+            --c->depth;
+            *more = false;
+            return JsonParseStatus::PARSE_OK;
+        }
+        if (i > 0) {
+            // "[1,]" 中 ',' 之后的 ']' 留给读取元素的函数报告 PARSE_INVALID_VALUE，与 json_parse 一致
+            if (*c->json != ',')
+                return JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            c->json = skipWhitespace(c->json + 1);
+        }
+        *more = true;
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    JsonParseStatus BindReader::beginObject() {
+        if (peek() != '{')
+            return mismatch();
+        if (this->context.depth >= this->context.maxDepth)
+            return JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+        ++this->context.depth;
+        this->context.json = skipWhitespace(this->context.json + 1);
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    JsonParseStatus BindReader::nextMember(size_t i, const char** key, size_t* len, bool* more) {
+        ParseContext* c = &this->context;
+        c->json = skipWhitespace(c->json);
+        if (*c->json == '}') {
+            ++c->json;
+            --c->depth;
+            *more = false;
+            return JsonParseStatus::PARSE_OK;
+        }
+        if (i > 0) {
+            if (*c->json != ',')
+                return JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            c->json = skipWhitespace(c->json + 1);
+        }
+        const auto retStatus = readMemberKey(c, key, len);
+        if (retStatus == JsonParseStatus::PARSE_OK)
+            *more = true;
+        return retStatus;
+    }
+
+    JsonParseStatus BindReader::finish() {
+        if (*skipWhitespace(this->context.json) != '\0')
+            return JsonParseStatus::PARSE_ROOT_NOT_SINGULAR;
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    void BindWriter::int64(int64_t i) {
+        char buffer[NUMBER_BUFFER_SIZE];
+        this->out->append(buffer, writeInt64(i, buffer) - buffer);
+    }
+
+    void BindWriter::uint64(uint64_t u) {
+        char buffer[NUMBER_BUFFER_SIZE];
+        this->out->append(buffer, writeUint64(u, buffer) - buffer);
+    }
+
+    void BindWriter::number(double d) {
+        if (!std::isfinite(d)) {
+            null();
+            return;
+        }
+        char buffer[NUMBER_BUFFER_SIZE];
+        this->out->append(buffer, writeDouble(d, buffer) - buffer);
+    }
+
+    void BindWriter::string(const char* s, size_t len) {
+        appendQuotedString(this->out, s, len);
+    }
+}
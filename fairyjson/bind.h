@@ -0,0 +1,476 @@
+//
+// Created by yubin on 2021/5/17.
+//
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "fairy_json.h"
+
+namespace fairy {
+
+    /**
+     * 结构体绑定时从 json 文本中读取值的游标，直接在输入上解析，不建立 FieldValue 树
+     * 每个读取函数要求当前位置是值的第一个字符，成功后移动到值之后；
+     * 值的类型与要求不符时整个值被跳过并返回 PARSE_TYPE_MISMATCH，值本身有语法错误时返回对应的错误
+     */
+    class BindReader {
+    public:
+        BindReader(const char* json, const ParseOptions& options);
+
+        BindReader(const BindReader&) = delete;
+        BindReader& operator=(const BindReader&) = delete;
+
+        /**
+         * @return 当前值的第一个字符
+         */
+        char peek() const {
+            return *this->context.json;
+        }
+
+        JsonParseStatus readNull();
+
+        JsonParseStatus readBool(bool* b);
+
+        /**
+         * 读取数字，结果是 J_NUMBER、J_INT64 或 J_UINT64，不分配内存
+         */
+        JsonParseStatus readNumber(FieldValue* n);
+
+        JsonParseStatus readString(std::string* s);
+
+        /**
+         * 校验并跳过当前值
+         */
+        JsonParseStatus skip();
+
+        /**
+         * 进入数组，之后反复调用 nextElement
+         */
+        JsonParseStatus beginArray();
+
+        /**
+         * 移动到数组的第 i 个元素
+         * @param more 存在这个元素时为 true；遇到 ']' 时为 false，数组已经离开
+         */
+        JsonParseStatus nextElement(size_t i, bool* more);
+
+        JsonParseStatus beginObject();
+
+        /**
+         * 移动到对象的第 i 个成员的值
+         * @param key 解码后的键，不以 '\0' 结尾，在读取值之前有效
+         * @param more 存在这个成员时为 true；遇到 '}' 时为 false，对象已经离开
+         */
+        JsonParseStatus nextMember(size_t i, const char** key, size_t* len, bool* more);
+
+        /**
+         * 根元素之后只允许空白
+         */
+        JsonParseStatus finish();
+
+    private:
+        /**
+         * 当前值的类型不符：跳过它，没有语法错误时返回 PARSE_TYPE_MISMATCH
+         */
+        JsonParseStatus mismatch();
+
+        ParseContext context;
+        std::string open;   // skipValue 中尚未闭合的括号
+    };
+
+    /**
+     * 结构体序列化时的输出，结果追加到 out 的末尾，格式与 jsonStringify 的 COMPACT 相同
+     */
+    class BindWriter {
+    public:
+        explicit BindWriter(std::string* out) :
+            out(out)
+        {}
+
+        void null() {
+            this->out->append("null", 4);
+        }
+
+        void boolean(bool b) {
+            if (b)
+                this->out->append("true", 4);
+            else
+                this->out->append("false", 5);
+        }
+
+        void int64(int64_t i);
+
+        void uint64(uint64_t u);
+
+        /**
+         * NaN 与无穷大在 json 中无法表示，写成 null
+         */
+        void number(double d);
+
+        void string(const char* s, size_t len);
+
+        void put(char ch) {
+            this->out->push_back(ch);
+        }
+
+    private:
+        std::string* out;
+    };
+
+    /**
+     * C++ 类型与 json 之间的转换，每个可绑定的类型提供
+     *     static JsonParseStatus read(BindReader* r, T* out);
+     *     static void write(BindWriter* w, const T& value);
+     * 内置支持 bool、整数、浮点数、std::string、std::vector、std::optional 以及用 FAIRY_JSON_BIND 声明的结构体，
+     * 其他类型（例如枚举）可以特化 JsonBinder
+     */
+    template <typename T, typename Enable = void>
+    struct JsonBinder;
+
+    /**
+     * 结构体中的一个成员：json 中的键以及成员指针
+     */
+    template <typename C, typename M>
+    struct JsonField {
+        typedef M MemberType;
+
+        const char* name;
+        size_t len;
+        M C::* member;
+    };
+
+    template <typename C, typename M, size_t N>
+    constexpr JsonField<C, M> makeJsonField(const char (&name)[N], M C::* member) {
+        return {name, N - 1, member};
+    }
+
+    /**
+     * 类型是否用 FAIRY_JSON_BIND 声明过成员，通过实参依赖查找找到 fairyJsonFields
+     */
+    template <typename T, typename = void>
+    struct HasJsonFields : std::false_type {};
+
+    template <typename T>
+    struct HasJsonFields<T, std::void_t<decltype(fairyJsonFields(static_cast<const T*>(nullptr)))>> : std::true_type {};
+
+    template <>
+    struct JsonBinder<bool> {
+        static JsonParseStatus read(BindReader* r, bool* out) {
+            return r->readBool(out);
+        }
+
+        static void write(BindWriter* w, bool value) {
+            w->boolean(value);
+        }
+    };
+
+    /**
+     * 整数只接受 json 中的整数，超出目标类型的范围时返回 PARSE_TYPE_MISMATCH
+     */
+    template <typename T>
+    struct JsonBinder<T, std::enable_if_t<std::is_integral<T>::value && !std::is_same<T, bool>::value>> {
+        static JsonParseStatus read(BindReader* r, T* out) {
+            FieldValue n;
+            const auto retStatus = r->readNumber(&n);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            if (n.getType() == JsonFieldType::J_INT64) {
+                const int64_t i = n.getInt64();
+                const bool inRange = std::is_signed<T>::value
+                    ? i >= static_cast<int64_t>(std::numeric_limits<T>::min()) && i <= static_cast<int64_t>(std::numeric_limits<T>::max())
+                    : i >= 0 && static_cast<uint64_t>(i) <= static_cast<uint64_t>(std::numeric_limits<T>::max());
+                if (!inRange)
+                    return JsonParseStatus::PARSE_TYPE_MISMATCH;
+                *out = static_cast<T>(i);
+                return JsonParseStatus::PARSE_OK;
+            }
+            if (n.getType() == JsonFieldType::J_UINT64 && n.getUint64() <= static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+                *out = static_cast<T>(n.getUint64());
+                return JsonParseStatus::PARSE_OK;
+            }
+            return JsonParseStatus::PARSE_TYPE_MISMATCH;
+        }
+
+        static void write(BindWriter* w, T value) {
+            if (std::is_signed<T>::value)
+                w->int64(static_cast<int64_t>(value));
+            else
+                w->uint64(static_cast<uint64_t>(value));
+        }
+    };
+
+    /**
+     * 浮点数接受任意 json 数字；超出 float 等较窄类型的范围时与整数一样返回 PARSE_TYPE_MISMATCH，而不是变成无穷大
+     */
+    template <typename T>
+    struct JsonBinder<T, std::enable_if_t<std::is_floating_point<T>::value>> {
+        static JsonParseStatus read(BindReader* r, T* out) {
+            FieldValue n;
+            const auto retStatus = r->readNumber(&n);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            switch (n.getType()) {
+                case JsonFieldType::J_INT64:  *out = static_cast<T>(n.getInt64()); break;
+                case JsonFieldType::J_UINT64: *out = static_cast<T>(n.getUint64()); break;
+                default: {
+                    const double d = n.getNumber();
+                    if (std::numeric_limits<T>::max() < std::numeric_limits<double>::max()
+                        && std::fabs(d) > static_cast<double>(std::numeric_limits<T>::max()))
+                        return JsonParseStatus::PARSE_TYPE_MISMATCH;
+                    *out = static_cast<T>(d);
+                    break;
+                }
+            }
+            return JsonParseStatus::PARSE_OK;
+        }
+
+        static void write(BindWriter* w, T value) {
+            w->number(static_cast<double>(value));
+        }
+    };
+
+    template <>
+    struct JsonBinder<std::string> {
+        static JsonParseStatus read(BindReader* r, std::string* out) {
+            return r->readString(out);
+        }
+
+        static void write(BindWriter* w, const std::string& value) {
+            w->string(value.data(), value.size());
+        }
+    };
+
+    /**
+     * 元素直接解码到 vector 的末尾；原有的元素会先被清除
+     */
+    template <typename T, typename A>
+    struct JsonBinder<std::vector<T, A>> {
+        static JsonParseStatus read(BindReader* r, std::vector<T, A>* out) {
+            auto retStatus = r->beginArray();
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            out->clear();
+            for (size_t i = 0; ; ++i) {
+                bool more = false;
+                retStatus = r->nextElement(i, &more);
+                if (retStatus != JsonParseStatus::PARSE_OK || !more)
+                    return retStatus;
+                if constexpr (std::is_same<T, bool>::value) {
+                    // vector<bool> 的元素不能取地址
+                    bool b = false;
+                    retStatus = JsonBinder<bool>::read(r, &b);
+                    out->push_back(b);
+                } else {
+                    out->emplace_back();
+                    retStatus = JsonBinder<T>::read(r, &out->back());
+                }
+                if (retStatus != JsonParseStatus::PARSE_OK)
+                    return retStatus;
+            }
+        }
+
+        static void write(BindWriter* w, const std::vector<T, A>& value) {
+            w->put('[');
+            for (size_t i = 0; i < value.size(); ++i) {
+                if (i > 0)
+                    w->put(',');
+                JsonBinder<T>::write(w, value[i]);
+            }
+            w->put(']');
+        }
+    };
+
+    /**
+     * null 对应空的 optional；结构体中空的 optional 成员在序列化时省略
+     */
+    template <typename T>
+    struct JsonBinder<std::optional<T>> {
+        static JsonParseStatus read(BindReader* r, std::optional<T>* out) {
+            if (r->peek() == 'n') {
+                out->reset();
+                return r->readNull();
+            }
+            out->emplace();
+            return JsonBinder<T>::read(r, &**out);
+        }
+
+        static void write(BindWriter* w, const std::optional<T>& value) {
+            if (value)
+                JsonBinder<T>::write(w, *value);
+            else
+                w->null();
+        }
+    };
+
+    /**
+     * @return 结构体的成员在序列化时是否省略
+     */
+    template <typename M>
+    bool isAbsentJsonField(const M&) {
+        return false;
+    }
+
+    template <typename M>
+    bool isAbsentJsonField(const std::optional<M>& value) {
+        return !value;
+    }
+
+    /**
+     * 用 FAIRY_JSON_BIND 声明过的结构体对应 json 对象
+     * 读取时按键找到成员，没有出现的成员保持原值，未声明的键被校验后跳过，重复的键以最后一个为准；
+     * 写出时按声明的顺序输出成员
+     */
+    template <typename T>
+    struct JsonBinder<T, std::enable_if_t<HasJsonFields<T>::value>> {
+        static JsonParseStatus read(BindReader* r, T* out) {
+            const auto fields = fairyJsonFields(static_cast<const T*>(nullptr));
+            auto retStatus = r->beginObject();
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            for (size_t i = 0; ; ++i) {
+                const char* key = nullptr;
+                size_t len = 0;
+                bool more = false;
+                retStatus = r->nextMember(i, &key, &len, &more);
+                if (retStatus != JsonParseStatus::PARSE_OK || !more)
+                    return retStatus;
+                const bool found = std::apply([&](const auto&... field) {
+                    return (readField(r, out, field, key, len, &retStatus) || ...);
+                }, fields);
+                if (!found)
+                    retStatus = r->skip();
+                if (retStatus != JsonParseStatus::PARSE_OK)
+                    return retStatus;
+            }
+        }
+
+        static void write(BindWriter* w, const T& value) {
+            const auto fields = fairyJsonFields(static_cast<const T*>(nullptr));
+            bool first = true;
+            w->put('{');
+            std::apply([&](const auto&... field) {
+                (writeField(w, value, field, &first), ...);
+            }, fields);
+            w->put('}');
+        }
+
+    private:
+        /**
+         * @return 键是否属于这个成员；是时读取成员的值并把结果存到 status
+         */
+        template <typename Field>
+        static bool readField(BindReader* r, T* out, const Field& field, const char* key, size_t len,
+                              JsonParseStatus* status) {
+            if (field.len != len || memcmp(field.name, key, len) != 0)
+                return false;
+            *status = JsonBinder<typename Field::MemberType>::read(r, &(out->*field.member));
+            return true;
+        }
+
+        template <typename Field>
+        static void writeField(BindWriter* w, const T& value, const Field& field, bool* first) {
+            const auto& member = value.*field.member;
+            if (isAbsentJsonField(member))
+                return;
+            if (!*first)
+                w->put(',');
+            *first = false;
+            w->string(field.name, field.len);
+            w->put(':');
+            JsonBinder<typename Field::MemberType>::write(w, member);
+        }
+    };
+
+    /**
+     * 把 json 直接解析到 C++ 对象中，不建立 FieldValue 树
+     * @param out 解析结果；失败时可能只有一部分成员被赋值
+     * @param json_str 以 '\0' 结尾的 json 字符串
+     * @param options 解析选项，只有 maxDepth 起作用
+     * @return 解析结果状态，类型不符时为 PARSE_TYPE_MISMATCH
+     */
+    template <typename T>
+    JsonParseStatus json_read(T* out, const char* json_str, const ParseOptions& options = ParseOptions()) {
+        BindReader reader(json_str, options);
+        const auto retStatus = JsonBinder<T>::read(&reader, out);
+        return retStatus == JsonParseStatus::PARSE_OK ? reader.finish() : retStatus;
+    }
+
+    template <typename T>
+    JsonParseStatus json_read(T* out, const std::string& json_str, const ParseOptions& options = ParseOptions()) {
+        return json_read(out, json_str.c_str(), options);
+    }
+
+    /**
+     * 把 C++ 对象写成紧凑格式的 json，结果追加到 out 的末尾
+     */
+    template <typename T>
+    void json_write(const T& value, std::string* out) {
+        BindWriter writer(out);
+        JsonBinder<T>::write(&writer, value);
+    }
+
+    template <typename T>
+    std::string json_write(const T& value) {
+        std::string out;
+        json_write(value, &out);
+        return out;
+    }
+}
+
+/*
+ * 声明结构体与 json 对象之间的对应关系，json 中的键即成员名，最多 32 个成员：
+ *     struct User { int64_t id; std::string name; std::optional<std::string> email; };
+ *     FAIRY_JSON_BIND(User, id, name, email)
+ * 写在结构体所在的命名空间中，不需要修改结构体本身
+ */
+#define FAIRY_JSON_BIND(Type, ...) \
+    inline auto fairyJsonFields(const Type*) { \
+        return std::make_tuple(FAIRY_JSON_EXPAND(FAIRY_JSON_CAT(FAIRY_JSON_F, FAIRY_JSON_COUNT(__VA_ARGS__))(Type, __VA_ARGS__))); \
+    }
+
+#define FAIRY_JSON_EXPAND(x) x
+#define FAIRY_JSON_CAT(a, b) FAIRY_JSON_CAT_I(a, b)
+#define FAIRY_JSON_CAT_I(a, b) a##b
+#define FAIRY_JSON_COUNT(...) FAIRY_JSON_EXPAND(FAIRY_JSON_COUNT_N(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define FAIRY_JSON_COUNT_N(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, N, ...) N
+#define FAIRY_JSON_FIELD(T, m) ::fairy::makeJsonField(#m, &T::m)
+#define FAIRY_JSON_F1(T, m) FAIRY_JSON_FIELD(T, m)
+#define FAIRY_JSON_F2(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F1(T, __VA_ARGS__))
+#define FAIRY_JSON_F3(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F2(T, __VA_ARGS__))
+#define FAIRY_JSON_F4(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F3(T, __VA_ARGS__))
+#define FAIRY_JSON_F5(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F4(T, __VA_ARGS__))
+#define FAIRY_JSON_F6(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F5(T, __VA_ARGS__))
+#define FAIRY_JSON_F7(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F6(T, __VA_ARGS__))
+#define FAIRY_JSON_F8(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F7(T, __VA_ARGS__))
+#define FAIRY_JSON_F9(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F8(T, __VA_ARGS__))
+#define FAIRY_JSON_F10(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F9(T, __VA_ARGS__))
+#define FAIRY_JSON_F11(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F10(T, __VA_ARGS__))
+#define FAIRY_JSON_F12(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F11(T, __VA_ARGS__))
+#define FAIRY_JSON_F13(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F12(T, __VA_ARGS__))
+#define FAIRY_JSON_F14(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F13(T, __VA_ARGS__))
+#define FAIRY_JSON_F15(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F14(T, __VA_ARGS__))
+#define FAIRY_JSON_F16(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F15(T, __VA_ARGS__))
+#define FAIRY_JSON_F17(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F16(T, __VA_ARGS__))
+#define FAIRY_JSON_F18(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F17(T, __VA_ARGS__))
+#define FAIRY_JSON_F19(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F18(T, __VA_ARGS__))
+#define FAIRY_JSON_F20(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F19(T, __VA_ARGS__))
+#define FAIRY_JSON_F21(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F20(T, __VA_ARGS__))
+#define FAIRY_JSON_F22(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F21(T, __VA_ARGS__))
+#define FAIRY_JSON_F23(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F22(T, __VA_ARGS__))
+#define FAIRY_JSON_F24(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F23(T, __VA_ARGS__))
+#define FAIRY_JSON_F25(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F24(T, __VA_ARGS__))
+#define FAIRY_JSON_F26(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F25(T, __VA_ARGS__))
+#define FAIRY_JSON_F27(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F26(T, __VA_ARGS__))
+#define FAIRY_JSON_F28(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F27(T, __VA_ARGS__))
+#define FAIRY_JSON_F29(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F28(T, __VA_ARGS__))
+#define FAIRY_JSON_F30(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F29(T, __VA_ARGS__))
+#define FAIRY_JSON_F31(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F30(T, __VA_ARGS__))
+#define FAIRY_JSON_F32(T, m, ...) FAIRY_JSON_FIELD(T, m), FAIRY_JSON_EXPAND(FAIRY_JSON_F31(T, __VA_ARGS__))
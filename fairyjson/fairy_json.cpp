@@ -5,11 +5,15 @@
 #include "fairy_json.h"
 #include <cassert>
 #include <cmath>
-#include <stack>
 #include <vector>
 #include <algorithm>
-#include <sstream>
+#include <cstring>
 #include "utils.h"
+#include "simd.h"
+#include "number.h"
+#include "key_pool.h"
+#include "structural.h"
+#include "mapped_file.h"
 
 
 #define EXPECT(c, ch)       do { assert(*c->json == (ch)); c->json++; } while(0)
@@ -24,10 +28,14 @@ namespace fairy {
      * @param c 解析上下文
      */
     static void parseWhitespace(ParseContext* c) {
-        const char *p = c->json;
-        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')
-            p++;
-        c->json = p;
+        c->json = c->bounded ? skipWhitespace(c->json, c->end) : skipWhitespace(c->json);
+    }
+
+    /**
+     * @return 输入中剩余的字节是否不少于 n 个；输入以 '\0' 结尾时不需要检查，比较会在 '\0' 处失败
+     */
+    static bool hasBytes(const ParseContext* c, size_t n) {
+        return !c->bounded || static_cast<size_t>(c->end - c->json) >= n;
     }
 
     /**
@@ -38,6 +46,8 @@ namespace fairy {
      * @return
      */
     static JsonParseStatus parseNull(ParseContext* c, FieldValue* v) {
+        if (!hasBytes(c, 4))
+            return JsonParseStatus::PARSE_INVALID_VALUE;
         EXPECT(c, 'n');
         if (c->json[0] != 'u' || c->json[1] != 'l' || c->json[2] != 'l')
             return JsonParseStatus::PARSE_INVALID_VALUE;
@@ -54,6 +64,8 @@ namespace fairy {
      * @return
      */
     static JsonParseStatus parseTrue(ParseContext* c, FieldValue* v) {
+        if (!hasBytes(c, 4))
+            return JsonParseStatus::PARSE_INVALID_VALUE;
         EXPECT(c, 't');
         if (c->json[0] != 'r' || c->json[1] != 'u' || c->json[2] != 'e') {
             return JsonParseStatus::PARSE_INVALID_VALUE;
@@ -70,6 +82,8 @@ namespace fairy {
      * @return
      */
     static JsonParseStatus parseFalse(ParseContext* c, FieldValue* v) {
+        if (!hasBytes(c, 5))
+            return JsonParseStatus::PARSE_INVALID_VALUE;
         EXPECT(c, 'f');
         if (c->json[0] != 'a' || c->json[1] != 'l' || c->json[2] != 's' || c->json[3] != 'e') {
             return JsonParseStatus::PARSE_INVALID_VALUE;
@@ -79,76 +93,127 @@ namespace fairy {
         return JsonParseStatus::PARSE_OK;
     }
 
-    static JsonParseStatus parseNumber(ParseContext* c, FieldValue* v) {
-        // 校验数字
-        const char* p = c->json;
-        if (*p == '-') p++;
-        if (*p == '0') p++;
-        else {
-            if (!isDigitFrom1To9(*p))
-                return JsonParseStatus::PARSE_INVALID_VALUE;
-            for (p++; isDigit(*p); p++);
-        }
-        if (*p == '.') {
-            p++;
-            if (!isDigit(*p))
-                return JsonParseStatus::PARSE_INVALID_VALUE;
-            for (p++; isDigit(*p); p++);
-        }
-        if (*p == 'e' || *p == 'E') {
-            p++;
-            if (*p == '+' || *p == '-') p++;
-            if (!isDigit(*p))
-                return JsonParseStatus::PARSE_INVALID_VALUE;
-            for (p++; isDigit(*p); p++);
-        }
-        errno = 0;
-        v->data.n = std::strtod(c->json, nullptr);
-        if (errno == ERANGE && (v->data.n == HUGE_VAL || v->data.n == -HUGE_VAL))
-            return JsonParseStatus::PARSE_NUMBER_OVERFLOW;
-        v->type = JsonFieldType::J_NUMBER;
-        c->json = p;
-        return JsonParseStatus::PARSE_OK;
+    /**
+     * 数字中可能出现的字符，readNumber 不会越过第一个不属于其中的字符
+     */
+    static bool isNumberChar(char ch) {
+        return isDigit(ch) || ch == '-' || ch == '+' || ch == '.' || ch == 'e' || ch == 'E';
     }
 
-    static JsonParseStatus parseStringRaw(ParseContext* c, char** pStr, size_t* pLen) {
+    /**
+     * 在有界的输入中解析数字
+     * 数字之后还有其他字符时直接解析；一直延续到输入末尾时，先拷贝进缓冲区补上 '\0'，这只会发生在文档的最后
+     */
+    static JsonParseStatus parseNumberBounded(ParseContext* c, FieldValue* v) {
+        const char* q = c->json;
+        while (q != c->end && isNumberChar(*q))
+            ++q;
+        const char* end = nullptr;
+        if (q != c->end) {
+            const auto retStatus = readNumber(c->json, &end, v);
+            if (retStatus == JsonParseStatus::PARSE_OK)
+                c->json = end;
+            return retStatus;
+        }
+        const size_t head = c->strBuf.size();
+        c->strBuf.insert(c->strBuf.end(), c->json, q);
+        c->strBuf.push_back('\0');
+        const char* copy = c->strBuf.data() + head;
+        const auto retStatus = readNumber(copy, &end, v);
+        if (retStatus == JsonParseStatus::PARSE_OK)
+            c->json += end - copy;
+        c->strBuf.resize(head);
+        return retStatus;
+    }
+
+    /**
+     * 解析数字，具体的语法校验与数值转换见 readNumber
+     * @param c
+     * @param v
+     * @return
+     */
+    JsonParseStatus parseNumber(ParseContext* c, FieldValue* v) {
+        if (c->bounded)
+            return parseNumberBounded(c, v);
+        const char* end = nullptr;
+        const auto retStatus = readNumber(c->json, &end, v);
+        if (retStatus == JsonParseStatus::PARSE_OK)
+            c->json = end;
+        return retStatus;
+    }
+
+    /**
+     * 把 [begin, end) 这段无需转义的原始字节整体拷贝进缓冲区
+     */
+    static void appendRun(ParseContext* c, const char* begin, const char* end) {
+        if (begin != end)
+            c->strBuf.insert(c->strBuf.end(), begin, end);
+    }
+
+    /**
+     * 解码一个字符串，但不为结果分配内存
+     * 没有转义时 *pStr 直接指向输入，否则指向 strBuf 中原有内容之后的部分，调用者用完后需要把 strBuf 截回原来的长度
+     */
+    JsonParseStatus decodeStringRaw(ParseContext* c, const char** pStr, size_t* pLen) {
         EXPECT(c, '\"');
-        size_t head = c->charStack.size();
+        size_t head = c->strBuf.size();
         const char* p = c->json;
-        size_t len;
+        const char* run = p;  // 尚未拷贝进缓冲区的无转义片段的起点
+        const char* const end = c->bounded ? c->end : nullptr;  // 为 nullptr 时不检查边界
         unsigned u = 0, u2 = 0;  // 存储码点
         while (true) {
+            // 整段跳过普通字符，只在 '"'、'\\' 和控制字符处停下
+            if (end == nullptr) {
+                p = scanStringSpecial(p);
+            } else {
+                p = scanStringSpecial(p, end);
+                if (p == end)
+                    return strParseError(c, head, JsonParseStatus::PARSE_MISS_QUOTATION_MARK);
+            }
             auto ch = *p++;
             switch (ch) {
                 case '\"':
-                    len = c->charStack.size() - head;
-                    *pStr = fetchStrFromCharStack(c->charStack, len);
-                    *pLen = len;
+                    if (c->strBuf.size() == head) {
+                        *pLen = p - 1 - run;
+                        *pStr = run;
+                    } else {
+                        appendRun(c, run, p - 1);
+                        *pLen = c->strBuf.size() - head;
+                        *pStr = c->strBuf.data() + head;
+                    }
                     c->json = p;
                     return JsonParseStatus::PARSE_OK;
                 case '\\':
+                    appendRun(c, run, p - 1);
+                    // 有界的输入中，转义序列被末尾截断时报告与 '\0' 结尾的输入相同的错误
+                    if (end != nullptr && p == end)
+                        return strParseError(c, head, JsonParseStatus::PARSE_INVALID_STRING_ESCAPE);
                     switch (*p++) {
-                        case '\"': c->charStack.push('\"'); break;
-                        case '\\': c->charStack.push('\\'); break;
-                        case '/':  c->charStack.push('/');  break;
-                        case 'b':  c->charStack.push('\b'); break;
-                        case 'f':  c->charStack.push('\f'); break;
-                        case 'n':  c->charStack.push('\n'); break;
-                        case 'r':  c->charStack.push('\r'); break;
-                        case 't':  c->charStack.push('\t'); break;
+                        case '\"': c->strBuf.push_back('\"'); break;
+                        case '\\': c->strBuf.push_back('\\'); break;
+                        case '/':  c->strBuf.push_back('/');  break;
+                        case 'b':  c->strBuf.push_back('\b'); break;
+                        case 'f':  c->strBuf.push_back('\f'); break;
+                        case 'n':  c->strBuf.push_back('\n'); break;
+                        case 'r':  c->strBuf.push_back('\r'); break;
+                        case 't':  c->strBuf.push_back('\t'); break;
                         case 'u':  // 对 Unicode 的处理
-                            if (!(p = parseHex4(p, &u)))
-                                strParseError(c, head, JsonParseStatus::PARSE_INVALID_UNICODE_HEX);
+                            if ((end != nullptr && end - p < 4) || !(p = parseHex4(p, &u)))
+                                return strParseError(c, head, JsonParseStatus::PARSE_INVALID_UNICODE_HEX);
                             // surrogate handling
                             if (u >= 0xD800 && u <= 0xDBFF) {
+                                if (end != nullptr && end - p < 6)
+                                    return strParseError(c, head, end - p >= 2 && p[0] == '\\' && p[1] == 'u'
+                                                                  ? JsonParseStatus::PARSE_INVALID_UNICODE_HEX
+                                                                  : JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE);
                                 if (*p++ != '\\')
-                                    strParseError(c, head, JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE);
+                                    return strParseError(c, head, JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE);
                                 if (*p++ != 'u')
-                                    strParseError(c, head, JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE);
+                                    return strParseError(c, head, JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE);
                                 if (!(p = parseHex4(p, &u2)))
-                                    strParseError(c, head, JsonParseStatus::PARSE_INVALID_UNICODE_HEX);
+                                    return strParseError(c, head, JsonParseStatus::PARSE_INVALID_UNICODE_HEX);
                                 if (u2 < 0xDC00 || u2 > 0xDFFF)
-                                    strParseError(c, head, JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE);
+                                    return strParseError(c, head, JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE);
                                 u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
                             }
                             encodeUtf8(c, u);
@@ -156,270 +221,1209 @@ namespace fairy {
                         default:
                             return strParseError(c, head, JsonParseStatus::PARSE_INVALID_STRING_ESCAPE);
                     }
+                    run = p;
                     break;
                 case '\0':
+                    if (c->end != nullptr && p - 1 != c->end)
+                        return strParseError(c, head, JsonParseStatus::PARSE_INVALID_STRING_CHAR);
                     return strParseError(c, head, JsonParseStatus::PARSE_MISS_QUOTATION_MARK);
                 default:
                     //  %x22 是双引号，%x5C 是反斜线，都已经处理。所以不合法的字符是 %x00 至 %x1F。我们简单地在 default 里处理：
                     if ((unsigned char)ch < 0x20) {
                         return strParseError(c, head, JsonParseStatus::PARSE_INVALID_STRING_CHAR);
                     }
-                    c->charStack.push(ch);
             }
         }
     }
 
+    JsonParseStatus parseStringRaw(ParseContext* c, char** pStr, size_t* pLen) {
+        const size_t head = c->strBuf.size();
+        const char* s = nullptr;
+        const auto retStatus = decodeStringRaw(c, &s, pLen);
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            return retStatus;
+        if (c->strBuf.size() == head)
+            *pStr = copyStr(s, *pLen, c->arena);  // 没有出现转义，直接从输入中拷贝，省去经过缓冲区的一次拷贝
+        else
+            *pStr = fetchStrFromBuffer(c->strBuf, head, c->arena);
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    /**
+     * 原地解析字符串：解码结果直接写回输入缓冲区，得到的字符串指向缓冲区内部
+     * 转义序列解码后不会比源文本更长，所以写指针永远不会越过读指针；
+     * 没有转义的字符串既不拷贝也不分配
+     */
+    static JsonParseStatus parseStringInsitu(ParseContext* c, char** pStr, size_t* pLen) {
+        EXPECT(c, '\"');
+        char* const begin = const_cast<char*>(c->json);
+        char* w = begin;        // 写指针
+        const char* p = begin;  // 读指针
+        const char* run = p;    // 尚未写回的无转义片段的起点
+        unsigned u = 0, u2 = 0;  // 存储码点
+        while (true) {
+            // 整段跳过普通字符，只在 '"'、'\\' 和控制字符处停下
+            p = scanStringSpecial(p);
+            auto ch = *p++;
+            switch (ch) {
+                case '\"':
+                    if (w != run)
+                        memmove(w, run, p - 1 - run);
+                    w += p - 1 - run;
+                    *w = '\0';
+                    *pStr = begin;
+                    *pLen = w - begin;
+                    c->json = p;
+                    return JsonParseStatus::PARSE_OK;
+                case '\\':
+                    if (w != run)
+                        memmove(w, run, p - 1 - run);
+                    w += p - 1 - run;
+                    switch (*p++) {
+                        case '\"': *w++ = '\"'; break;
+                        case '\\': *w++ = '\\'; break;
+                        case '/':  *w++ = '/';  break;
+                        case 'b':  *w++ = '\b'; break;
+                        case 'f':  *w++ = '\f'; break;
+                        case 'n':  *w++ = '\n'; break;
+                        case 'r':  *w++ = '\r'; break;
+                        case 't':  *w++ = '\t'; break;
+                        case 'u':
+                            if (!(p = parseHex4(p, &u)))
+                                return JsonParseStatus::PARSE_INVALID_UNICODE_HEX;
+                            if (u >= 0xD800 && u <= 0xDBFF) {
+                                if (*p++ != '\\')
+                                    return JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE;
+                                if (*p++ != 'u')
+                                    return JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE;
+                                if (!(p = parseHex4(p, &u2)))
+                                    return JsonParseStatus::PARSE_INVALID_UNICODE_HEX;
+                                if (u2 < 0xDC00 || u2 > 0xDFFF)
+                                    return JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE;
+                                u = (((u - 0xD800) << 10) | (u2 - 0xDC00)) + 0x10000;
+                            }
+                            w += encodeUtf8(w, u);
+                            break;
+                        default:
+                            return JsonParseStatus::PARSE_INVALID_STRING_ESCAPE;
+                    }
+                    run = p;
+                    break;
+                case '\0':
+                    return JsonParseStatus::PARSE_MISS_QUOTATION_MARK;
+                default:
+                    if ((unsigned char)ch < 0x20) {
+                        return JsonParseStatus::PARSE_INVALID_STRING_CHAR;
+                    }
+            }
+        }
+    }
+
+    /**
+     * 解析对象的键，存在 KeyPool 时优先使用池中的规范副本，池不接受时再退回与字符串值相同的存储方式
+     */
+    static JsonParseStatus parseKey(ParseContext* c, char** pStr, size_t* pLen) {
+        if (c->keyPool == nullptr)
+            return c->insitu ? parseStringInsitu(c, pStr, pLen) : parseStringRaw(c, pStr, pLen);
+        const size_t head = c->strBuf.size();
+        const char* s = nullptr;
+        const auto retStatus = decodeStringRaw(c, &s, pLen);
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            return retStatus;
+        // 池中的键只读，JString 的字段类型不带 const
+        *pStr = const_cast<char*>(c->keyPool->intern(s, *pLen));
+        if (*pStr == nullptr)
+            *pStr = c->strBuf.size() == head ? copyStr(s, *pLen, c->arena) : fetchStrFromBuffer(c->strBuf, head, c->arena);
+        else
+            c->strBuf.resize(head);
+        return JsonParseStatus::PARSE_OK;
+    }
+
     static JsonParseStatus parseString(ParseContext* c, FieldValue* v) {
         char* s = nullptr;
         size_t len = 0;
-        const auto parseRet = parseStringRaw(c, &s, &len);
+        const auto parseRet = c->insitu ? parseStringInsitu(c, &s, &len) : parseStringRaw(c, &s, &len);
         if (parseRet == JsonParseStatus::PARSE_OK) {
             v->setJStr(s, len);
             v->setType(JsonFieldType::J_STRING);
+            v->setBorrowed(c->arena != nullptr || c->insitu);
         }
         return parseRet;
     }
 
-    static JsonParseStatus parseValue(ParseContext* c, FieldValue* v);
+    FieldArray* newArray(ParseContext* c) {
+        if (c->arena != nullptr) {
+            void* mem = c->arena->allocate(sizeof(FieldArray), alignof(FieldArray));
+            return new (mem) FieldArray(ArenaAllocator<FieldValue>(c->arena));
+        }
+        return new FieldArray();
+    }
+
+    FieldObject* newObject(ParseContext* c) {
+        // 键由 parseStringRaw 用 new[] 申请时才归对象所有
+        const bool ownKeys = c->arena == nullptr && !c->insitu;
+        if (c->arena != nullptr) {
+            void* mem = c->arena->allocate(sizeof(FieldObject), alignof(FieldObject));
+            return new (mem) FieldObject(FieldObject::allocator_type(c->arena), ownKeys, c->keyPool);
+        }
+        return new FieldObject(FieldObject::allocator_type(), ownKeys, c->keyPool);
+    }
+
+    /**
+     * 解析数组与对象之外的 json 值
+     */
+    static JsonParseStatus parseScalar(ParseContext* c, FieldValue* v) {
+        switch (peekChar(c))
+        {
+            case 'n':   return parseNull(c, v);
+            case 't':   return parseTrue(c, v);
+            case 'f':   return parseFalse(c, v);
+            case '\"':  return parseString(c, v);
+            case '\0':  // 字符串结尾；指定了 end 时，之前的 '\0' 是非法字符
+                return atInputEnd(c) ? JsonParseStatus::PARSE_EXPECT_VALUE : JsonParseStatus::PARSE_INVALID_VALUE;
+            default:    return parseNumber(c, v);  // 包括 ']'、'}' 等，由 readNumber 报告 PARSE_INVALID_VALUE
+        }
+    }
+
+    /**
+     * 读取对象成员的键以及之后的 ':'，键暂存在容器的栈帧中，等值解析完成后再加入对象
+     * member = string ws %x3A ws value
+     */
+    static JsonParseStatus parseMemberKey(ParseContext* c, ParseFrame* frame) {
+        if (peekChar(c) != '"')
+            return JsonParseStatus::PARSE_MISS_KEY;
+        char* keyStr = nullptr;
+        size_t keyStrLen = 0;
+        const auto retStatus = parseKey(c, &keyStr, &keyStrLen);
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            return retStatus;
+        frame->key = {keyStr, keyStrLen};
+        parseWhitespace(c);
+        if (peekChar(c) != ':')
+            return JsonParseStatus::PARSE_MISS_COLON;
+        c->json++;
+        parseWhitespace(c);
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    /**
+     * 打开 c->json 处的数组或对象：空容器直接完成；否则入栈，c->json 移动到第一个元素（对象的第一个成员的值）处
+     * @param base 本次 parseNested 开始时的栈深度
+     * @param value 空容器
+     * @param opened 容器是否入栈
+     */
+    static JsonParseStatus openContainer(ParseContext* c, size_t base, FieldValue* value, bool* opened) {
+        if (c->frames.size() - base + c->depth >= c->maxDepth)
+            return JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+        const bool isArray = *c->json == '[';
+        c->json++;
+        parseWhitespace(c);
+        if (isArray) {
+            *opened = peekChar(c) != ']';
+            if (*opened) {
+                c->frames.push_back({FieldValue(), {nullptr, 0}, c->fieldStack.size(), true});
+                return JsonParseStatus::PARSE_OK;
+            }
+            c->json++;
+            value->setType(JsonFieldType::J_ARRAY);
+            value->setArray(newArray(c));
+            value->setBorrowed(c->arena != nullptr);
+            return JsonParseStatus::PARSE_OK;
+        }
+        value->setType(JsonFieldType::J_OBJECT);
+        value->setObj(newObject(c));
+        value->setBorrowed(c->arena != nullptr);
+        *opened = peekChar(c) != '}';
+        if (!*opened) {
+            c->json++;
+            return JsonParseStatus::PARSE_OK;
+        }
+        c->frames.push_back({std::move(*value), {nullptr, 0}, 0, false});
+        return parseMemberKey(c, &c->frames.back());
+    }
+
+    /**
+     * 数组闭合：把 fieldStack 末尾的 count 个元素按顺序移进新建的数组，并从栈中弹出
+     */
+    static void closeArray(ParseContext* c, size_t count, FieldValue* v) {
+        FieldArray* array = newArray(c);
+        // 按确切的大小一次性分配，从栈顶倒着移入后再翻转；只访问栈顶，避免 deque 按下标定位时的除法
+        array->reserve(count);
+        // 逐个弹出而不是 resize：整段截断会让 glibc 在每次解析后把堆顶归还给系统
+        for (size_t i = count; i > 0; --i) {
+            array->push_back(std::move(c->fieldStack.back()));
+            c->fieldStack.pop_back();
+        }
+        std::reverse(array->begin(), array->end());
+        v->setType(JsonFieldType::J_ARRAY);
+        v->setArray(array);
+        v->setBorrowed(c->arena != nullptr);
+    }
+
+    /**
+     * 继续解析栈顶的数组，标量元素直接在循环中完成
+     * @param value resume 为 true 时是刚刚闭合的子容器，作为下一个元素；数组闭合时为闭合后的数组
+     * @param closed 数组闭合并出栈时为 true；为 false 时遇到的子容器已经入栈
+     */
+    static JsonParseStatus continueArray(ParseContext* c, size_t base, FieldValue* value, bool resume, bool* closed) {
+        JsonParseStatus retStatus;
+        while (true) {
+            if (!resume) {
+                const char ch = peekChar(c);
+                if (ch == '[' || ch == '{') {
+                    bool opened = false;
+                    retStatus = openContainer(c, base, value, &opened);
+                    if (retStatus != JsonParseStatus::PARSE_OK || opened)
+                        return retStatus;
+                } else {
+                    retStatus = parseScalar(c, value);
+                    if (retStatus != JsonParseStatus::PARSE_OK)
+                        return retStatus;
+                }
+            }
+            resume = false;
+            c->fieldStack.push_back(std::move(*value));
+            parseWhitespace(c);
+            const char ch = peekChar(c);
+            if (ch == ',') {
+                c->json++;
+                parseWhitespace(c);
+            } else if (ch == ']') {
+                c->json++;
+                closeArray(c, c->fieldStack.size() - c->frames.back().stackBase, value);
+                c->frames.pop_back();
+                *closed = true;
+                return JsonParseStatus::PARSE_OK;
+            } else {
+                return JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            }
+        }
+    }
+
+    /**
+     * 继续解析栈顶的对象，参数与返回值同 continueArray
+     */
+    static JsonParseStatus continueObject(ParseContext* c, size_t base, FieldValue* value, bool resume, bool* closed) {
+        ParseFrame* top = &c->frames.back();
+        JsonParseStatus retStatus;
+        while (true) {
+            if (!resume) {
+                const char ch = peekChar(c);
+                if (ch == '[' || ch == '{') {
+                    bool opened = false;
+                    retStatus = openContainer(c, base, value, &opened);
+                    if (retStatus != JsonParseStatus::PARSE_OK || opened)
+                        return retStatus;
+                } else {
+                    retStatus = parseScalar(c, value);
+                    if (retStatus != JsonParseStatus::PARSE_OK)
+                        return retStatus;
+                }
+            }
+            resume = false;
+            // 完成一个键值对的解析
+            top->value.getObj()->append(top->key, std::move(*value));
+            top->key = {nullptr, 0};
+            parseWhitespace(c);
+            const char ch = peekChar(c);
+            if (ch == ',') {
+                c->json++;
+                parseWhitespace(c);
+                retStatus = parseMemberKey(c, top);
+                if (retStatus != JsonParseStatus::PARSE_OK)
+                    return retStatus;
+            } else if (ch == '}') {
+                c->json++;
+                *value = std::move(top->value);
+                c->frames.pop_back();
+                *closed = true;
+                return JsonParseStatus::PARSE_OK;
+            } else {
+                return JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            }
+        }
+    }
+
+    /**
+     * 出错时释放本次解析中尚未闭合的容器，以及其中已经解析出的元素与键
+     */
+    static void unwindFrames(ParseContext* c, size_t base, size_t stackBase) {
+        for (size_t i = stackBase; i < c->fieldStack.size(); ++i)
+            c->fieldStack[i].freeSpace();
+        c->fieldStack.resize(stackBase);
+        while (c->frames.size() > base) {
+            ParseFrame& top = c->frames.back();
+            if (!top.isArray) {
+                if (top.key.s != nullptr && top.value.getObj()->ownsKey(top.key))
+                    delete[] top.key.s;
+                top.value.freeSpace();
+            }
+            c->frames.pop_back();
+        }
+    }
+
+    /**
+     * 非递归地解析数组与对象
+     * 尚未闭合的容器保存在 c->frames 中，嵌套再深也不会耗尽线程的栈，层数受 c->maxDepth 限制；
+     * 每种容器在自己的循环中直接解析标量元素，只有进入与离开子容器时才经过栈
+     * array = [ ws value *( ws %x2C ws value ) ws ]
+     * object = { ws member *( ws %x2C ws member ) ws }
+     */
+    static JsonParseStatus parseNested(ParseContext* c, FieldValue* v) {
+        const size_t base = c->frames.size();
+        const size_t stackBase = c->fieldStack.size();
+        FieldValue value;
+        bool opened = false;
+        auto retStatus = openContainer(c, base, &value, &opened);
+        bool closed = !opened;
+        while (retStatus == JsonParseStatus::PARSE_OK) {
+            if (closed && c->frames.size() == base) {
+                *v = std::move(value);
+                return JsonParseStatus::PARSE_OK;
+            }
+            // 上一步闭合了一个子容器时，由外层容器接着把它作为元素
+            const bool resume = closed;
+            closed = false;
+            retStatus = c->frames.back().isArray ? continueArray(c, base, &value, resume, &closed)
+                                                 : continueObject(c, base, &value, resume, &closed);
+        }
+        unwindFrames(c, base, stackBase);
+        return retStatus;
+    }
+
+    /**
+     * 外层嵌套不超过这个层数时数组与对象递归地解析，更深的部分交给 parseNested。
+     * 常见的文档都在这个范围之内，递归调用的返回地址可以被准确预测，比按栈帧的类型分派更快；
+     * 每层递归只占用很少的线程栈，这个层数下的总量可以忽略
+     */
+    static const size_t MAX_RECURSIVE_DEPTH = 32;
+
+    static JsonParseStatus parseElement(ParseContext* c, FieldValue* v, size_t budget);
 
-    static JsonParseStatus parseArray(ParseContext* c, FieldValue* v) {
-        EXPECT(c, '[');
+    /**
+     * 递归地解析数组，元素直接解析在 fieldStack 的末尾，闭合时一次性移进数组
+     * @param budget 包括这一层在内还可以递归的层数，调用者保证不为 0
+     */
+    static JsonParseStatus parseArray(ParseContext* c, FieldValue* v, size_t budget) {
+        c->json++;
         parseWhitespace(c);
-        if (*c->json == ']') {
-            ++c->json;
+        if (peekChar(c) == ']') {
+            c->json++;
             v->setType(JsonFieldType::J_ARRAY);
-            v->setArray(new vector<FieldValue>());
+            v->setArray(newArray(c));
+            v->setBorrowed(c->arena != nullptr);
             return JsonParseStatus::PARSE_OK;
         }
-        size_t arraySize = 0;
-        JsonParseStatus parseRet;
+        size_t count = 0;
+        FieldValue e;   // 每个元素移进 fieldStack 之后重新变为 J_NULL，在循环中复用
+        JsonParseStatus retStatus;
         while (true) {
-            FieldValue e;
-            parseRet = parseValue(c, &e);
-            if (parseRet != JsonParseStatus::PARSE_OK)
+            retStatus = parseElement(c, &e, budget - 1);
+            if (retStatus != JsonParseStatus::PARSE_OK)
                 break;
-            c->fieldStack.push(e);
-            ++arraySize;
+            c->fieldStack.push_back(std::move(e));
+            ++count;
             parseWhitespace(c);
-            if (*c->json == ',') {
-                ++c->json;
+            const char ch = peekChar(c);
+            if (ch == ',') {
+                c->json++;
                 parseWhitespace(c);
-            } else if (*c->json == ']') {
-                ++c->json;
-                v->setType(JsonFieldType::J_ARRAY);
-                v->data.array = new vector<FieldValue>();
-                for (size_t i = 0; i < arraySize; ++i) {
-                    v->data.array->push_back(c->fieldStack.top());
-                    c->fieldStack.pop();
-                }
-                reverse(v->data.array->begin(), v->data.array->end());
+            } else if (ch == ']') {
+                c->json++;
+                closeArray(c, count, v);
                 return JsonParseStatus::PARSE_OK;
             } else {
-                parseRet = JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                retStatus = JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
                 break;
             }
         }
-        // Pop and free values on the stack
-        for (size_t i = 0; i < arraySize; ++i) {
-            auto tempValue = c->fieldStack.top();
-            c->fieldStack.pop();
-            tempValue.freeSpace();
+        for (; count > 0; --count) {
+            c->fieldStack.back().freeSpace();
+            c->fieldStack.pop_back();
         }
-        return parseRet;
+        return retStatus;
     }
 
-    static JsonParseStatus parseObject(ParseContext* c, FieldValue* v) {
-        EXPECT(c, '{');
-        JsonParseStatus retStatus;
+    /**
+     * 递归地解析对象，成员在值解析完成后直接加入对象
+     * @param budget 同 parseArray
+     */
+    static JsonParseStatus parseObject(ParseContext* c, FieldValue* v, size_t budget) {
+        c->json++;
         parseWhitespace(c);
-        v->data.obj = new multimap<string, FieldValue>();
-        if (*c->json == '}') {
-            ++c->json;
-            v->setType(JsonFieldType::J_OBJECT);
+        // 先设置类型，出错时 freeSpace 才能释放已经解析出的成员
+        FieldObject* obj = newObject(c);
+        v->setType(JsonFieldType::J_OBJECT);
+        v->setObj(obj);
+        v->setBorrowed(c->arena != nullptr);
+        if (peekChar(c) == '}') {
+            c->json++;
             return JsonParseStatus::PARSE_OK;
         }
+        JsonParseStatus retStatus;
         while (true) {
-            char* keyStr = nullptr;
-            size_t keyStrLen = 0;
-            FieldValue objValue;  // 对象的一个属性
-            // parse key
-            if (*c->json != '"') {
+            if (peekChar(c) != '"') {
                 retStatus = JsonParseStatus::PARSE_MISS_KEY;
                 break;
             }
-            retStatus = parseStringRaw(c, &keyStr, &keyStrLen);
+            char* keyStr = nullptr;
+            size_t keyStrLen = 0;
+            retStatus = parseKey(c, &keyStr, &keyStrLen);
             if (retStatus != JsonParseStatus::PARSE_OK)
                 break;
-            const string objKey = string(keyStr, keyStrLen);
-            // parse ws colon ws
             parseWhitespace(c);
-            if (*c->json != ':') {
+            if (peekChar(c) != ':') {
                 retStatus = JsonParseStatus::PARSE_MISS_COLON;
-                break;
+            } else {
+                c->json++;
+                parseWhitespace(c);
+                FieldValue member;
+                retStatus = parseElement(c, &member, budget - 1);
+                if (retStatus == JsonParseStatus::PARSE_OK)
+                    obj->append({keyStr, keyStrLen}, std::move(member));
             }
-            c->json++;
-            parseWhitespace(c);
-            // parse value
-            retStatus = parseValue(c, &objValue);
             if (retStatus != JsonParseStatus::PARSE_OK) {
+                if (obj->ownsKey({keyStr, keyStrLen}))
+                    delete[] keyStr;
                 break;
             }
-            // 完成一个键值对的解析
-            v->data.obj->insert({objKey, objValue});
-            // parse ws [comma | right-curly-brace] ws
             parseWhitespace(c);
-            if (*c->json == ',') {
+            const char ch = peekChar(c);
+            if (ch == ',') {
                 c->json++;
                 parseWhitespace(c);
-            }
-            else if (*c->json == '}') {
+            } else if (ch == '}') {
                 c->json++;
-                v->setType(JsonFieldType::J_OBJECT);
                 return JsonParseStatus::PARSE_OK;
-            }
-            else {
+            } else {
                 retStatus = JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
                 break;
             }
         }
-        // 清理已申请的空间
         v->freeSpace();
-        v->setType(JsonFieldType::J_NULL);
         return retStatus;
     }
 
+    /**
+     * 递归的层数用完时，从当前的层数开始交给 parseNested，由它检查 maxDepth；返回后恢复外层的计数
+     */
+    static JsonParseStatus parseNestedBelow(ParseContext* c, FieldValue* v) {
+        // 预算从 min(maxDepth, MAX_RECURSIVE_DEPTH) 开始倒数，用完时恰好位于这一层（入口已经更深时不变）
+        const size_t outer = c->depth;
+        c->depth = std::max(outer, std::min(c->maxDepth, MAX_RECURSIVE_DEPTH));
+        const auto retStatus = parseNested(c, v);
+        c->depth = outer;
+        return retStatus;
+    }
 
-        /**
-         * 解析 json 值
-         * @param c
-         * @param v
-         * @return
-         */
-    static JsonParseStatus parseValue(ParseContext* c, FieldValue* v) {
-        switch (*c->json)
-        {
+    /**
+     * 递归解析中的一个值。层数以倒数的预算作为参数传递，每层只需一次与 0 的比较，
+     * 不必在 ParseContext 中读写计数
+     */
+    static JsonParseStatus parseElement(ParseContext* c, FieldValue* v, size_t budget) {
+        switch (peekChar(c)) {
+            case '[':   return budget != 0 ? parseArray(c, v, budget) : parseNestedBelow(c, v);
+            case '{':   return budget != 0 ? parseObject(c, v, budget) : parseNestedBelow(c, v);
             case 'n':   return parseNull(c, v);
             case 't':   return parseTrue(c, v);
             case 'f':   return parseFalse(c, v);
             case '\"':  return parseString(c, v);
-            case '[':   return parseArray(c, v);
-            case '{':   return parseObject(c, v);
-            case '\0':  return JsonParseStatus::PARSE_EXPECT_VALUE;  // 字符串结尾
+            case '\0':  // 字符串结尾；指定了 end 时，之前的 '\0' 是非法字符
+                return atInputEnd(c) ? JsonParseStatus::PARSE_EXPECT_VALUE : JsonParseStatus::PARSE_INVALID_VALUE;
             default:    return parseNumber(c, v);
         }
     }
 
-    JsonParseStatus json_parse(FieldValue* v, const char* json) {
+    /**
+     * 解析 json 值
+     * @param c
+     * @param v
+     * @return
+     */
+    JsonParseStatus parseValue(ParseContext* c, FieldValue* v) {
+        const size_t limit = std::min(c->maxDepth, MAX_RECURSIVE_DEPTH);
+        return parseElement(c, v, c->depth < limit ? limit - c->depth : 0);
+    }
+
+    /**
+     * 解析整个 json 文本：ws value ws
+     * @param c
+     * @param v
+     * @return
+     */
+    JsonParseStatus parseRoot(ParseContext* c, FieldValue* v) {
+        v->freeSpace();
+        parseWhitespace(c);
+        auto retStatus = parseValue(c, v);
+        if (retStatus == JsonParseStatus::PARSE_OK) {
+            parseWhitespace(c);
+            if (!atInputEnd(c)) {
+                v->freeSpace();
+                retStatus = JsonParseStatus::PARSE_ROOT_NOT_SINGULAR;
+            }
+        }
+        return retStatus;
+    }
+
+    JsonParseStatus readMemberKey(ParseContext* c, const char** key, size_t* len) {
+        if (*c->json != '\"')
+            return JsonParseStatus::PARSE_MISS_KEY;
+        c->strBuf.clear();
+        const auto retStatus = decodeStringRaw(c, key, len);
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            return retStatus;
+        c->json = skipWhitespace(c->json);
+        if (*c->json != ':')
+            return JsonParseStatus::PARSE_MISS_COLON;
+        c->json = skipWhitespace(c->json + 1);
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    /**
+     * 容器用 open 记录尚未闭合的括号，不递归；检查的顺序与 json_parse 相同，因此报告同样的错误
+     */
+    JsonParseStatus skipValue(ParseContext* c, std::string* open) {
+        open->clear();
+        const char* key = nullptr;
+        size_t len = 0;
+        while (true) {
+            const char ch = *c->json;
+            JsonParseStatus retStatus = JsonParseStatus::PARSE_OK;
+            if (ch == '[' || ch == '{') {
+                if (c->depth + open->size() >= c->maxDepth)
+                    return JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+                c->json = skipWhitespace(c->json + 1);
+                if (*c->json != (ch == '[' ? ']' : '}')) {
+                    open->push_back(ch);
+                    if (ch == '{') {
+                        retStatus = readMemberKey(c, &key, &len);
+                        if (retStatus != JsonParseStatus::PARSE_OK)
+                            return retStatus;
+                    }
+                    continue;
+                }
+                ++c->json;
+            } else if (ch == '\"') {
+                c->strBuf.clear();
+                retStatus = decodeStringRaw(c, &key, &len);
+            } else {
+                // 数字与字面量的解析不会分配内存
+                FieldValue scalar;
+                retStatus = parseValue(c, &scalar);
+            }
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            // 一个值结束，依次闭合已经结束的容器，直到遇到下一个值
+            while (true) {
+                if (open->empty())
+                    return JsonParseStatus::PARSE_OK;
+                const bool isArray = open->back() == '[';
+                c->json = skipWhitespace(c->json);
+                if (*c->json == ',') {
+                    c->json = skipWhitespace(c->json + 1);
+                    if (!isArray) {
+                        retStatus = readMemberKey(c, &key, &len);
+                        if (retStatus != JsonParseStatus::PARSE_OK)
+                            return retStatus;
+                    }
+                    break;
+                }
+                if (*c->json != (isArray ? ']' : '}'))
+                    return isArray ? JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET
+                                   : JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                ++c->json;
+                open->pop_back();
+            }
+        }
+    }
+
+    /**
+     * 两阶段解析中第二阶段的游标，依次指向结构字符索引中的每一个记号
+     */
+    struct IndexCursor {
+        const char* json;
+        const char* jsonEnd;      // 输入末尾的 '\0'
+        const uint32_t* pos;
+        const uint32_t* end;
+        const char* stray;        // 上一个标量之后紧跟着的、没有进入索引的字节
+    };
+
+    /**
+     * @return 当前记号的位置，索引用完后指向输入末尾的 '\0'
+     */
+    static const char* tokenAt(const IndexCursor* t) {
+        return t->pos != t->end ? t->json + *t->pos : t->jsonEnd;
+    }
+
+    /**
+     * @return 当前记号的首字符；上一个标量之后有多余的字节时返回该字节，使调用者报告与递归下降相同的错误
+     */
+    static char peekToken(const IndexCursor* t) {
+        return t->stray != nullptr ? *t->stray : *tokenAt(t);
+    }
+
+    /**
+     * 标量已经从 c->json 处解析完，移动到下一个记号
+     */
+    static void consumeScalar(ParseContext* c, IndexCursor* t) {
+        ++t->pos;
+        const char* token = tokenAt(t);
+        if (c->json == token) {
+            t->stray = nullptr;  // 紧凑的输入中标量之后直接就是下一个记号
+            return;
+        }
+        const char* next = skipWhitespace(c->json);
+        t->stray = next != token ? next : nullptr;
+    }
+
+    static JsonParseStatus buildValue(ParseContext* c, IndexCursor* t, FieldValue* v);
+
+    static JsonParseStatus buildArray(ParseContext* c, IndexCursor* t, FieldValue* v) {
+        ++t->pos;
+        v->setType(JsonFieldType::J_ARRAY);
+        v->setArray(newArray(c));
+        v->setBorrowed(c->arena != nullptr);
+        if (peekToken(t) == ']') {
+            ++t->pos;
+            return JsonParseStatus::PARSE_OK;
+        }
+        JsonParseStatus retStatus;
+        while (true) {
+            FieldValue e;
+            retStatus = buildValue(c, t, &e);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                break;
+            v->getArray()->push_back(std::move(e));
+            const char ch = peekToken(t);
+            if (ch == ',') {
+                ++t->pos;
+            } else if (ch == ']') {
+                ++t->pos;
+                return JsonParseStatus::PARSE_OK;
+            } else {
+                retStatus = JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                break;
+            }
+        }
+        v->freeSpace();
+        return retStatus;
+    }
+
+    static JsonParseStatus buildObject(ParseContext* c, IndexCursor* t, FieldValue* v) {
+        ++t->pos;
+        v->setType(JsonFieldType::J_OBJECT);
+        v->setObj(newObject(c));
+        v->setBorrowed(c->arena != nullptr);
+        if (peekToken(t) == '}') {
+            ++t->pos;
+            return JsonParseStatus::PARSE_OK;
+        }
+        JsonParseStatus retStatus;
+        while (true) {
+            if (peekToken(t) != '\"') {
+                retStatus = JsonParseStatus::PARSE_MISS_KEY;
+                break;
+            }
+            char* keyStr = nullptr;
+            size_t keyStrLen = 0;
+            c->json = tokenAt(t);
+            retStatus = parseKey(c, &keyStr, &keyStrLen);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                break;
+            consumeScalar(c, t);
+            FieldValue objValue;
+            if (peekToken(t) != ':') {
+                retStatus = JsonParseStatus::PARSE_MISS_COLON;
+            } else {
+                ++t->pos;
+                retStatus = buildValue(c, t, &objValue);
+            }
+            if (retStatus != JsonParseStatus::PARSE_OK) {
+                if (v->getObj()->ownsKey({keyStr, keyStrLen}))
+                    delete[] keyStr;
+                break;
+            }
+            v->getObj()->append({keyStr, keyStrLen}, std::move(objValue));
+            const char ch = peekToken(t);
+            if (ch == ',') {
+                ++t->pos;
+            } else if (ch == '}') {
+                ++t->pos;
+                return JsonParseStatus::PARSE_OK;
+            } else {
+                retStatus = JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                break;
+            }
+        }
+        v->freeSpace();
+        return retStatus;
+    }
+
+    static JsonParseStatus buildValue(ParseContext* c, IndexCursor* t, FieldValue* v) {
+        switch (peekToken(t)) {
+            case '[':
+            case '{': {
+                if (c->depth >= c->maxDepth)
+                    return JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+                ++c->depth;
+                const auto retStatus = peekToken(t) == '[' ? buildArray(c, t, v) : buildObject(c, t, v);
+                --c->depth;
+                return retStatus;
+            }
+            case '\0':  return JsonParseStatus::PARSE_EXPECT_VALUE;
+            default: {
+                // 标量沿用递归下降的语法规则，其余的记号在这里会被报告为 PARSE_INVALID_VALUE
+                c->json = tokenAt(t);
+                const auto retStatus = parseValue(c, v);
+                if (retStatus == JsonParseStatus::PARSE_OK)
+                    consumeScalar(c, t);
+                return retStatus;
+            }
+        }
+    }
+
+    /**
+     * 线程内共享的索引在解析结束后最多保留的位置数（4MB），更大的输入用完即释放，
+     * 偶尔解析一次大文件的线程不会一直占着这块内存
+     */
+    static const size_t MAX_RETAINED_INDEX = size_t(1) << 20;
+
+    /**
+     * 两阶段解析：先建立结构字符索引，再沿着索引建立树
+     * @param index 调用者提供的索引，为 nullptr 时使用线程内共享的索引
+     */
+    static JsonParseStatus parseIndexedRoot(ParseContext* c, FieldValue* v, StructuralIndex* index) {
+        v->freeSpace();
+        const size_t len = strlen(c->json);
+        if (len > StructuralIndex::MAX_INPUT_SIZE)
+            return parseRoot(c, v);  // 超出索引能表示的范围，退回递归下降
+        // 索引的空间按线程复用，免去每次解析为大块内存缺页的开销
+        static thread_local StructuralIndex shared;
+        StructuralIndex* used = index != nullptr ? index : &shared;
+        // 未闭合的字符串由第二阶段在解码时报告，这样错误与递归下降一致地按文档顺序给出
+        used->build(c->json, len);
+        IndexCursor t = { c->json, c->json + len, used->begin(), used->end(), nullptr };
+        auto retStatus = buildValue(c, &t, v);
+        if (retStatus == JsonParseStatus::PARSE_OK && peekToken(&t) != '\0') {
+            v->freeSpace();
+            retStatus = JsonParseStatus::PARSE_ROOT_NOT_SINGULAR;
+        }
+        if (used == &shared)
+            shared.shrink(MAX_RETAINED_INDEX);
+        return retStatus;
+    }
+
+    static void applyOptions(ParseContext* c, const ParseOptions& options) {
+        c->keyPool = options.keyPool;
+        c->maxDepth = options.depthLimit();
+    }
+
+    JsonParseStatus json_parse(FieldValue* v, const char* json, const ParseOptions& options) {
         ParseContext c;
         c.json = json;
+        applyOptions(&c, options);
         if (v == nullptr) {
             return JsonParseStatus::PARSE_INVALID_VALUE;
         }
-        v->type = JsonFieldType::J_NULL;
-        parseWhitespace(&c);
-        auto retStatus = parseValue(&c, v);
-        if (retStatus == JsonParseStatus::PARSE_OK) {
-            parseWhitespace(&c);
-            if (*c.json != '\0') {
-                retStatus = JsonParseStatus::PARSE_ROOT_NOT_SINGULAR;
+        // 先释放原来的内容：原来的值可能借用了原地解析的输入或 Arena，清掉标记之后再释放会误删不属于它的内存
+        v->freeSpace();
+        v->setBorrowed(false);
+        return parseRoot(&c, v);
+    }
+
+    JsonParseStatus json_parse(Document* doc, const char* json, const ParseOptions& options) {
+        if (doc == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        doc->clear();
+        ParseContext c;
+        c.json = json;
+        applyOptions(&c, options);
+        c.arena = doc->getArena();
+        return parseRoot(&c, doc->getRoot());
+    }
+
+    /**
+     * 带长度的输入：有填充时只记录末尾，否则每次读取都检查边界
+     */
+    static void setInput(ParseContext* c, const char* data, size_t len, const ParseOptions& options) {
+        if (data == nullptr)
+            data = "";  // 空的 std::string_view
+        c->json = data;
+        c->end = data + len;
+        c->bounded = !options.padded;
+        applyOptions(c, options);
+    }
+
+    JsonParseStatus json_parse(FieldValue* v, const char* data, size_t len, const ParseOptions& options) {
+        if (v == nullptr || (data == nullptr && len != 0)) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        ParseContext c;
+        setInput(&c, data, len, options);
+        v->freeSpace();
+        v->setBorrowed(false);
+        return parseRoot(&c, v);
+    }
+
+    JsonParseStatus json_parse(Document* doc, const char* data, size_t len, const ParseOptions& options) {
+        if (doc == nullptr || (data == nullptr && len != 0)) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        doc->clear();
+        ParseContext c;
+        setInput(&c, data, len, options);
+        c.arena = doc->getArena();
+        return parseRoot(&c, doc->getRoot());
+    }
+
+    JsonParseStatus json_parse_insitu(FieldValue* v, char* json, const ParseOptions& options) {
+        ParseContext c;
+        c.json = json;
+        applyOptions(&c, options);
+        c.insitu = true;
+        if (v == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        v->freeSpace();
+        v->setBorrowed(false);
+        return parseRoot(&c, v);
+    }
+
+    JsonParseStatus json_parse_insitu(Document* doc, char* json, const ParseOptions& options) {
+        if (doc == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        doc->clear();
+        ParseContext c;
+        c.json = json;
+        applyOptions(&c, options);
+        c.arena = doc->getArena();
+        c.insitu = true;
+        return parseRoot(&c, doc->getRoot());
+    }
+
+    JsonParseStatus json_parse_indexed(FieldValue* v, const char* json, const ParseOptions& options) {
+        if (v == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        ParseContext c;
+        c.json = json;
+        applyOptions(&c, options);
+        v->freeSpace();
+        v->setBorrowed(false);
+        return parseIndexedRoot(&c, v, options.index);
+    }
+
+    JsonParseStatus json_parse_indexed(Document* doc, const char* json, const ParseOptions& options) {
+        if (doc == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        doc->clear();
+        ParseContext c;
+        c.json = json;
+        applyOptions(&c, options);
+        c.arena = doc->getArena();
+        return parseIndexedRoot(&c, doc->getRoot(), options.index);
+    }
+
+    /**
+     * 解析映射后的文件：映射区域在文件内容之后补满了 '\0'，按带填充的输入解析
+     */
+    static JsonParseStatus parseMappedFile(ParseContext* c, FieldValue* v, const MappedFile& file) {
+        c->json = file.data();
+        c->end = file.data() + file.size();
+        return parseRoot(c, v);
+    }
+
+    JsonParseStatus json_parse_file(FieldValue* v, const char* path, const ParseOptions& options) {
+        if (v == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        v->freeSpace();
+        v->setBorrowed(false);
+        MappedFile file;
+        if (!file.open(path))
+            return JsonParseStatus::PARSE_IO_ERROR;
+        ParseContext c;
+        applyOptions(&c, options);
+        return parseMappedFile(&c, v, file);
+    }
+
+    JsonParseStatus json_parse_file(Document* doc, const char* path, const ParseOptions& options) {
+        if (doc == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        doc->clear();
+        MappedFile file;
+        if (!file.open(path))
+            return JsonParseStatus::PARSE_IO_ERROR;
+        ParseContext c;
+        applyOptions(&c, options);
+        c.arena = doc->getArena();
+        return parseMappedFile(&c, doc->getRoot(), file);
+    }
+
+    /**
+     * 直接写入 std::string 的输出缓冲区
+     * 预先按估计的大小扩容，写入时只移动指针，空间不足时再成倍扩容，结束时截掉未用到的部分
+     */
+    struct JsonWriter {
+        std::string* out;
+        size_t base;      // 写入起始位置，之前的内容保持不变
+        char* cur = nullptr;
+        char* end = nullptr;
+        bool pretty;
+        int indent;
+        int depth = 0;
+
+        JsonWriter(std::string* o, size_t estimate, bool p, int ind) :
+            out(o), base(o->size()), pretty(p), indent(ind)
+        {
+            out->resize(base + estimate);
+            cur = &(*out)[0] + base;
+            end = &(*out)[0] + out->size();
+        }
+
+        /**
+         * 保证至少还有 n 个字节的可写空间
+         */
+        void reserve(size_t n) {
+            if (static_cast<size_t>(end - cur) >= n)
+                return;
+            const size_t used = cur - out->data();
+            out->resize(std::max(out->size() * 2, used + n));
+            cur = &(*out)[0] + used;
+            end = &(*out)[0] + out->size();
+        }
+
+        void put(char ch) {
+            reserve(1);
+            *cur++ = ch;
+        }
+
+        void write(const char* s, size_t len) {
+            reserve(len);
+            memcpy(cur, s, len);
+            cur += len;
+        }
+
+        void newline() {
+            reserve(1 + depth * indent);
+            *cur++ = '\n';
+            memset(cur, ' ', depth * indent);
+            cur += depth * indent;
+        }
+
+        void finish() {
+            out->resize(cur - out->data());
+        }
+    };
+
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+    /**
+     * 写出带引号并转义过的字符串，不需要转义的片段整段拷贝
+     */
+    static void writeString(JsonWriter* w, const char* s, size_t len) {
+        const char* const end = s + len;
+        w->reserve(len + 2);
+        *w->cur++ = '"';
+        while (true) {
+            const char* run = scanStringSpecial(s, end);
+            w->write(s, run - s);
+            if (run == end)
+                break;
+            const unsigned char ch = static_cast<unsigned char>(*run);
+            w->reserve(6);
+            *w->cur++ = '\\';
+            switch (ch) {
+                case '\"':  *w->cur++ = '\"'; break;
+                case '\\': *w->cur++ = '\\'; break;
+                case '\b': *w->cur++ = 'b'; break;
+                case '\f': *w->cur++ = 'f'; break;
+                case '\n': *w->cur++ = 'n'; break;
+                case '\r': *w->cur++ = 'r'; break;
+                case '\t': *w->cur++ = 't'; break;
+                default:
+                    *w->cur++ = 'u';
+                    *w->cur++ = '0';
+                    *w->cur++ = '0';
+                    *w->cur++ = HEX_DIGITS[ch >> 4];
+                    *w->cur++ = HEX_DIGITS[ch & 0xF];
             }
+            s = run + 1;
         }
-        return retStatus;
+        w->put('"');
     }
 
-    static void jsonStringifyArray(const FieldValue* v, ostringstream& jStrm);
-    static void jsonStringifyObject(const FieldValue* v, ostringstream& jStrm);
+    void appendQuotedString(std::string* out, const char* s, size_t len) {
+        JsonWriter w(out, len + 2, false, 0);
+        writeString(&w, s, len);
+        w.finish();
+    }
+
+    /**
+     * 估计大小时每个容器最多抽样的元素个数，其余元素按抽样的平均长度推算
+     */
+    static const size_t ESTIMATE_SAMPLES = 4;
+
+    /**
+     * 粗略估计字符串化之后的长度，用于预先分配输出缓冲区
+     * 每个容器只抽样前几个元素，代价与树的深度相关而与元素总数无关；估小了由 JsonWriter 扩容兜底
+     */
+    static size_t estimateSize(const FieldValue* v, bool pretty, int indent, int depth) {
+        switch (v->getType()) {
+            case JsonFieldType::J_NULL:
+            case JsonFieldType::J_TRUE:
+                return 4;
+            case JsonFieldType::J_FALSE:
+                return 5;
+            case JsonFieldType::J_NUMBER:
+                return 24;
+            case JsonFieldType::J_INT64:
+            case JsonFieldType::J_UINT64:
+                return 20;
+            case JsonFieldType::J_STRING:
+                // 为转义留出一些余量
+                return v->getJStr()->len + v->getJStr()->len / 8 + 2;
+            case JsonFieldType::J_ARRAY: {
+                const auto array = v->getArray();
+                const size_t perItem = pretty ? 2 + (depth + 1) * indent : 1;
+                const size_t samples = std::min(array->size(), ESTIMATE_SAMPLES);
+                size_t sampled = 0;
+                for (size_t i = 0; i < samples; ++i)
+                    sampled += perItem + estimateSize(&(*array)[i], pretty, indent, depth + 1);
+                return 2 + (samples == 0 ? 0 : sampled * array->size() / samples);
+            }
+            case JsonFieldType::J_OBJECT: {
+                const auto obj = v->getObj();
+                const size_t perItem = pretty ? 5 + (depth + 1) * indent : 4;
+                size_t samples = 0, sampled = 0;
+                for (auto it = obj->begin(); it != obj->end() && samples < ESTIMATE_SAMPLES; ++it, ++samples)
+                    sampled += perItem + it->first.len + estimateSize(&it->second, pretty, indent, depth + 1);
+                return 2 + (samples == 0 ? 0 : sampled * obj->size() / samples);
+            }
+            default:
+                return 0;
+        }
+    }
 
     /**
      * 将一个 FieldValue 对象进行字符串化
      * @param v
-     * @param jStrm
+     * @param w
      */
-    static void jsonStringifyValue(const FieldValue* v, ostringstream& jStrm) {
+    static void jsonStringifyValue(const FieldValue* v, JsonWriter* w) {
         switch (v->getType()) {
             case JsonFieldType::J_NULL:
-                jStrm << "null";
+                w->write("null", 4);
                 break;
             case JsonFieldType::J_FALSE:
-                jStrm << "false";
+                w->write("false", 5);
                 break;
             case JsonFieldType::J_TRUE:
-                jStrm << "true";
+                w->write("true", 4);
                 break;
             case JsonFieldType::J_NUMBER:
-                jStrm << v->data.n;
+                w->reserve(NUMBER_BUFFER_SIZE);
+                if (std::isfinite(v->data.n))
+                    w->cur = writeDouble(v->data.n, w->cur);
+                else
+                    w->write("null", 4);  // json 无法表示 NaN 与无穷大
+                break;
+            case JsonFieldType::J_INT64:
+                w->reserve(NUMBER_BUFFER_SIZE);
+                w->cur = writeInt64(v->data.i, w->cur);
+                break;
+            case JsonFieldType::J_UINT64:
+                w->reserve(NUMBER_BUFFER_SIZE);
+                w->cur = writeUint64(v->data.u, w->cur);
                 break;
             case JsonFieldType::J_STRING:
-                jStrm << '"' << string(v->getJStr()->s, v->getJStr()->len) << '"';
+                writeString(w, v->getJStr()->s, v->getJStr()->len);
                 break;
-            case JsonFieldType::J_ARRAY:
-                jsonStringifyArray(v, jStrm);
+            case JsonFieldType::J_ARRAY: {
+                const auto array = v->getArray();
+                w->put('[');
+                if (!array->empty()) {
+                    ++w->depth;
+                    for (size_t i = 0; i < array->size(); ++i) {
+                        if (i != 0)
+                            w->put(',');
+                        if (w->pretty)
+                            w->newline();
+                        jsonStringifyValue(&(*array)[i], w);
+                    }
+                    --w->depth;
+                    if (w->pretty)
+                        w->newline();
+                }
+                w->put(']');
                 break;
-            case JsonFieldType::J_OBJECT:
-                jsonStringifyObject(v, jStrm);
+            }
+            case JsonFieldType::J_OBJECT: {
+                const auto obj = v->getObj();
+                w->put('{');
+                if (!obj->empty()) {
+                    ++w->depth;
+                    bool first = true;
+                    for (auto& item : *obj) {
+                        if (!first)
+                            w->put(',');
+                        first = false;
+                        if (w->pretty)
+                            w->newline();
+                        writeString(w, item.first.s, item.first.len);
+                        if (w->pretty)
+                            w->write(": ", 2);
+                        else
+                            w->put(':');
+                        jsonStringifyValue(&item.second, w);
+                    }
+                    --w->depth;
+                    if (w->pretty)
+                        w->newline();
+                }
+                w->put('}');
                 break;
+            }
             default:
                 assert(0 && "invalid type");
         }
     }
 
+    void jsonStringify(const FieldValue* v, std::string* out, StringifyStyle style, int indent) {
+        assert(v != nullptr && out != nullptr);
+        const bool pretty = (style == StringifyStyle::PRETTY);
+        JsonWriter w(out, estimateSize(v, pretty, indent, 0), pretty, indent);
+        jsonStringifyValue(v, &w);
+        w.finish();
+    }
+
     /**
      * 将 json 进行字符串化
      * @param v
      * @return
      */
     string jsonStringify(const FieldValue* v) {
-        assert(v != nullptr);
-        ostringstream jsonStream;
-        jsonStringifyValue(v, jsonStream);
-        return jsonStream.str();
-    }
-
-    /**
-     * 将一个数组进行字符串化
-     * @param v
-     * @param jStrm
-     */
-    static void jsonStringifyArray(const FieldValue* v, ostringstream& jStrm) {
-        jStrm << '[';
-        const auto arraySize = v->data.array->size();
-        auto ite = v->data.array->begin();
-        for (int i = 0; i < arraySize - 1; ++i) {
-            jsonStringifyValue(&*ite, jStrm);
-            jStrm << ", ";
-            ++ite;
-        }
-        jsonStringifyValue(&*ite, jStrm);
-        jStrm << ']';
-    }
-
-    /**
-     * 将一个对象进行字符串化
-     * @param v
-     * @param jStrm
-     */
-    static void jsonStringifyObject(const FieldValue* v, ostringstream& jStrm) {
-        jStrm << '{';
-        const auto mapSize = v->data.obj->size();
-        auto ite = v->data.obj->begin();
-        for (int i = 0; i < mapSize - 1; ++i) {
-            jStrm << '"' << ite->first << "\": ";
-            jsonStringifyValue(&ite->second, jStrm);
-            jStrm << ", ";
-            ++ite;
-        }
-        jStrm << '"' << ite->first << "\": ";
-        jsonStringifyValue(&ite->second, jStrm);
-        jStrm << "}";
+        string out;
+        jsonStringify(v, &out);
+        return out;
     }
 
 
     void FieldValue::freeSpace()
     {
+        if (borrowed) {
+            // Arena 中的内存由 Arena 统一回收
+            setType(JsonFieldType::J_NULL);
+            return;
+        }
         switch (type)
         {
             case JsonFieldType::J_STRING:
-                delete getJStr()->s;
+                delete[] getJStr()->s;
                 setJStr(nullptr, 0);
                 break;
             case JsonFieldType::J_ARRAY:
@@ -430,6 +1434,8 @@ namespace fairy {
                 break;
             case JsonFieldType::J_OBJECT:
                 for (auto& item: *this->data.obj) {
+                    if (this->data.obj->ownsKey(item.first))
+                        delete[] item.first.s;
                     item.second.freeSpace();
                 }
                 delete this->data.obj;
@@ -439,6 +1445,86 @@ namespace fairy {
         setType(JsonFieldType::J_NULL);
     }
 
+    static bool keyEquals(const JString& k, const char* key, size_t len) {
+        // 驻留过的键内容相同则指针相同
+        return k.len == len && (k.s == key || memcmp(k.s, key, len) == 0);
+    }
+
+    bool FieldObject::ownsKey(const JString& key) const {
+        return ownKeys && (keyPool == nullptr || keyPool->find(key.s, key.len) != key.s);
+    }
+
+    void FieldObject::append(JString key, FieldValue&& value) {
+        members.emplace_back(key, std::move(value));
+        if (index.empty())
+            return;
+        if (members.size() * 2 > index.size()) {
+            // 装载因子超过 1/2，丢弃索引，下次查找时按新的大小重建
+            index.clear();
+            return;
+        }
+        const size_t mask = index.size() - 1;
+        size_t slot = hashBytes(key.s, key.len) & mask;
+        while (index[slot] != 0) {
+            if (keyEquals(members[index[slot] - 1].first, key.s, key.len))
+                return;  // 已有同名的键，保持 find 返回最先插入的成员
+            slot = (slot + 1) & mask;
+        }
+        index[slot] = static_cast<uint32_t>(members.size());
+    }
+
+    void FieldObject::buildIndex() const {
+        if (members.size() <= HASH_INDEX_THRESHOLD || !index.empty())
+            return;
+        size_t capacity = 1;
+        while (capacity < members.size() * 4)
+            capacity <<= 1;
+        index.assign(capacity, 0);
+        const size_t mask = capacity - 1;
+        for (size_t i = 0; i < members.size(); ++i) {
+            const JString& key = members[i].first;
+            size_t slot = hashBytes(key.s, key.len) & mask;
+            bool duplicate = false;
+            while (index[slot] != 0) {
+                if (keyEquals(members[index[slot] - 1].first, key.s, key.len)) {
+                    duplicate = true;
+                    break;
+                }
+                slot = (slot + 1) & mask;
+            }
+            if (!duplicate)
+                index[slot] = static_cast<uint32_t>(i + 1);
+        }
+    }
+
+    /**
+     * @return 成员的下标，没有找到时返回 size()
+     */
+    size_t FieldObject::findIndex(const char* key, size_t len) const {
+        if (members.size() <= HASH_INDEX_THRESHOLD) {
+            for (size_t i = 0; i < members.size(); ++i) {
+                if (keyEquals(members[i].first, key, len))
+                    return i;
+            }
+            return members.size();
+        }
+        buildIndex();
+        const size_t mask = index.size() - 1;
+        for (size_t slot = hashBytes(key, len) & mask; index[slot] != 0; slot = (slot + 1) & mask) {
+            if (keyEquals(members[index[slot] - 1].first, key, len))
+                return index[slot] - 1;
+        }
+        return members.size();
+    }
+
+    FieldObject::iterator FieldObject::find(const char* key, size_t len) {
+        return members.begin() + findIndex(key, len);
+    }
+
+    FieldObject::const_iterator FieldObject::find(const char* key, size_t len) const {
+        return members.begin() + findIndex(key, len);
+    }
+
     FieldValue::FieldValue() :
         type(JsonFieldType::J_NULL)
     {}
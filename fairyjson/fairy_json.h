@@ -6,12 +6,14 @@
 
 #include <string>
 #include <cassert>
-#include <stack>
+#include <cstdint>
+#include <deque>
 #include <vector>
 #include <memory>
-#include <map>
-#include <string>
+#include <cstring>
+#include <string_view>
 #include "JString.h"
+#include "arena.h"
 
 namespace fairy {
     /**
@@ -21,7 +23,9 @@ namespace fairy {
         J_NULL,
         J_FALSE,
         J_TRUE,
-        J_NUMBER,
+        J_NUMBER,   // 浮点数，以 double 存储
+        J_INT64,    // 能用 int64_t 精确表示的整数
+        J_UINT64,   // 超出 int64_t 但能用 uint64_t 精确表示的正整数
         J_STRING,
         J_ARRAY,
         J_OBJECT
@@ -45,30 +49,85 @@ namespace fairy {
         PARSE_MISS_COMMA_OR_SQUARE_BRACKET,
         PARSE_MISS_KEY,
         PARSE_MISS_COLON,
-        PARSE_MISS_COMMA_OR_CURLY_BRACKET
+        PARSE_MISS_COMMA_OR_CURLY_BRACKET,
+        PARSE_CANCELLED,                // SAX 处理器要求停止解析
+        PARSE_IO_ERROR,                 // 文件无法打开或映射
+        PARSE_DEPTH_EXCEEDED,           // 数组与对象的嵌套层数超过 ParseOptions::maxDepth
+        PARSE_INVALID_BINARY,           // MessagePack 输入被截断、含有不支持的类型或者 map 的键不是字符串
+        PARSE_TYPE_MISMATCH             // 绑定到 C++ 类型或按需取值时，值的类型与目标不符或者超出目标的范围
     };
 
+    struct FieldValue;
+
+    /**
+     * array 与 object 的存储类型，未绑定 Arena 时使用普通堆分配
+     */
+    typedef std::vector<FieldValue, ArenaAllocator<FieldValue>> FieldArray;
+    class FieldObject;
+    class KeyPool;
+    class StructuralIndex;
+
     /**
      * Json 中一个数据元素的类型
+     * 值拥有其字符串、数组与对象的内存，析构时释放；只能移动，移动后原对象为 J_NULL
      */
     struct FieldValue {
         union {
             double n;       // number
+            int64_t i;      // int64
+            uint64_t u;     // uint64
             JString str;    // string
-            std::vector<FieldValue>* array;   // array
-            std::multimap<std::string, FieldValue>* obj;  // object
+            FieldArray* array;   // array
+            FieldObject* obj;  // object
         } data{};
         JsonFieldType type;
+        bool borrowed = false;  // 数据存放在 Arena 或原地解析的输入缓冲区中，不由本对象释放
 
     public:
         explicit FieldValue();
         explicit FieldValue(JsonFieldType t);
 
+        FieldValue(FieldValue&& other) noexcept :
+            data(other.data), type(other.type), borrowed(other.borrowed)
+        {
+            other.type = JsonFieldType::J_NULL;
+        }
+
+        FieldValue& operator=(FieldValue&& other) noexcept {
+            if (this != &other) {
+                // 与析构函数相同，标量不必调用 freeSpace
+                if (this->type >= JsonFieldType::J_STRING)
+                    freeSpace();
+                this->data = other.data;
+                this->type = other.type;
+                this->borrowed = other.borrowed;
+                other.type = JsonFieldType::J_NULL;
+            }
+            return *this;
+        }
+
+        FieldValue(const FieldValue&) = delete;
+        FieldValue& operator=(const FieldValue&) = delete;
+
+        ~FieldValue() {
+            // 标量不持有内存，不必调用 freeSpace
+            if (this->type >= JsonFieldType::J_STRING)
+                freeSpace();
+        }
+
         /**
-         * 释放掉已申请的空间
+         * 释放掉已申请的空间，数据不归本对象所有时只重置类型
          */
         void freeSpace();
 
+        bool isBorrowed() const {
+            return this->borrowed;
+        }
+
+        void setBorrowed(bool b) {
+            this->borrowed = b;
+        }
+
         JsonFieldType getType() const {
             return this->type;
         }
@@ -77,8 +136,24 @@ namespace fairy {
             this->type = t;
         }
 
+        /**
+         * @return 是否为数字类型（J_NUMBER、J_INT64 或 J_UINT64）
+         */
+        bool isNumber() const {
+            return this->type == JsonFieldType::J_NUMBER
+                || this->type == JsonFieldType::J_INT64
+                || this->type == JsonFieldType::J_UINT64;
+        }
+
+        /**
+         * @return 数字的 double 值，整数类型会被转换成 double
+         */
         double getNumber() const {
-            assert(this->type == JsonFieldType::J_NUMBER);
+            assert(isNumber());
+            if (this->type == JsonFieldType::J_INT64)
+                return static_cast<double>(this->data.i);
+            if (this->type == JsonFieldType::J_UINT64)
+                return static_cast<double>(this->data.u);
             return this->data.n;
         }
 
@@ -87,6 +162,26 @@ namespace fairy {
             this->data.n = n;
         }
 
+        int64_t getInt64() const {
+            assert(this->type == JsonFieldType::J_INT64);
+            return this->data.i;
+        }
+
+        void setInt64(int64_t i) {
+            assert(this->type == JsonFieldType::J_INT64);
+            this->data.i = i;
+        }
+
+        uint64_t getUint64() const {
+            assert(this->type == JsonFieldType::J_UINT64);
+            return this->data.u;
+        }
+
+        void setUint64(uint64_t u) {
+            assert(this->type == JsonFieldType::J_UINT64);
+            this->data.u = u;
+        }
+
         bool getBoolean() const {
             assert(this->type == JsonFieldType::J_TRUE || this->type == JsonFieldType::J_FALSE);
            if (this->type == JsonFieldType::J_TRUE)
@@ -111,37 +206,343 @@ namespace fairy {
             this->setJStr(pJStr->s, pJStr->len);
         }
 
-        std::vector<FieldValue>* getArray() const {
+        FieldArray* getArray() const {
             return this->data.array;
         }
 
-        void setArray(std::vector<FieldValue>* array) {
+        void setArray(FieldArray* array) {
             this->data.array = array;
         }
 
-        std::multimap<std::string, FieldValue>* getObj() const {
+        FieldObject* getObj() const {
             return this->data.obj;
         }
 
-        void setObj(std::multimap<std::string, FieldValue>* obj) {
+        void setObj(FieldObject* obj) {
             this->data.obj = obj;
         }
     };
 
+    /**
+     * object 的一个成员，键只记录起始位置与长度，不以 '\0' 结尾
+     */
+    typedef std::pair<JString, FieldValue> FieldMember;
+
+    /**
+     * 按插入顺序连续存放成员的 object
+     * 成员较少时 find 直接线性扫描；超过 HASH_INDEX_THRESHOLD 个成员后，第一次 find 时建立开放寻址的哈希索引，
+     * 之后的查找为 O(1)。建立索引会修改对象内部的状态，多个线程同时查找同一个大对象之前需要先调用 buildIndex()。
+     * 存在重复的键时 find 返回最先插入的那个
+     */
+    class FieldObject {
+    public:
+        typedef std::vector<FieldMember, ArenaAllocator<FieldMember>> MemberList;
+        typedef MemberList::iterator iterator;
+        typedef MemberList::const_iterator const_iterator;
+        typedef MemberList::allocator_type allocator_type;
+
+        static const size_t HASH_INDEX_THRESHOLD = 16;
+
+        /**
+         * @param alloc 成员与索引使用的分配器
+         * @param ownKeys 键的内存是否由本对象在 FieldValue::freeSpace() 时用 delete[] 释放
+         * @param keyPool 非空时，指向该池中规范副本的键不归本对象所有，即使 ownKeys 为 true
+         */
+        explicit FieldObject(const allocator_type& alloc = allocator_type(), bool ownKeys = true,
+                             const KeyPool* keyPool = nullptr) :
+            members(alloc), index(IndexList::allocator_type(alloc)), keyPool(keyPool), ownKeys(ownKeys)
+        {}
+
+        size_t size() const {
+            return members.size();
+        }
+
+        bool empty() const {
+            return members.empty();
+        }
+
+        iterator begin() {
+            return members.begin();
+        }
+
+        iterator end() {
+            return members.end();
+        }
+
+        const_iterator begin() const {
+            return members.begin();
+        }
+
+        const_iterator end() const {
+            return members.end();
+        }
+
+        FieldMember& operator[](size_t i) {
+            return members[i];
+        }
+
+        const FieldMember& operator[](size_t i) const {
+            return members[i];
+        }
+
+        bool hasOwnKeys() const {
+            return ownKeys;
+        }
+
+        /**
+         * @return 键是否需要由本对象释放
+         */
+        bool ownsKey(const JString& key) const;
+
+        void reserve(size_t n) {
+            members.reserve(n);
+        }
+
+        /**
+         * 在末尾追加一个成员，不检查键是否重复
+         * @param key 键，ownKeys 为 true 时其内存必须来自 new[]
+         * @param value 值，移动进本对象
+         */
+        void append(JString key, FieldValue&& value);
+
+        /**
+         * 按键查找成员，传入 KeyPool 中的规范副本时只需比较指针
+         * @param key 键的起始位置
+         * @param len 键的长度
+         * @return 找到的成员，没有找到时返回 end()
+         */
+        iterator find(const char* key, size_t len);
+        const_iterator find(const char* key, size_t len) const;
+
+        iterator find(const char* key) {
+            return find(key, strlen(key));
+        }
+
+        const_iterator find(const char* key) const {
+            return find(key, strlen(key));
+        }
+
+        iterator find(const std::string& key) {
+            return find(key.data(), key.size());
+        }
+
+        const_iterator find(const std::string& key) const {
+            return find(key.data(), key.size());
+        }
+
+        /**
+         * 成员数超过阈值且索引尚未建立时建立哈希索引
+         */
+        void buildIndex() const;
+
+    private:
+        typedef std::vector<uint32_t, ArenaAllocator<uint32_t>> IndexList;
+
+        size_t findIndex(const char* key, size_t len) const;
+
+        MemberList members;
+        mutable IndexList index;  // 槽中存放成员下标 + 1，0 表示空槽；容量为 2 的幂
+        const KeyPool* keyPool;
+        bool ownKeys;
+    };
+
+    /**
+     * 解析选项
+     */
+    struct ParseOptions {
+        static const size_t DEFAULT_MAX_DEPTH = 1024;
+        /**
+         * maxDepth 能够放宽到的上限。tape、SAX、两阶段与并行解析的构建过程，以及 FieldValue 的析构、
+         * 序列化都随嵌套层数递归，这个层数下在默认 8MB 的线程栈上仍有数倍的余量
+         */
+        static const size_t MAX_DEPTH_LIMIT = 10000;
+
+        KeyPool* keyPool = nullptr;  // 非空时对象的键驻留到该池中，池可以被多个线程共享
+        size_t maxDepth = DEFAULT_MAX_DEPTH;  // 数组与对象最多的嵌套层数，超过时返回 PARSE_DEPTH_EXCEEDED；大于 MAX_DEPTH_LIMIT 时按 MAX_DEPTH_LIMIT 处理
+        bool padded = false;         // 只对带长度的 json_parse 有效：调用者保证 data[len] 可读且为 '\0'，解析时省去边界检查
+        StructuralIndex* index = nullptr;  // 只对两阶段解析有效：非空时在其中建立索引并保留空间，供调用者在多次解析间复用
+
+        /**
+         * @return 实际生效的层数限制
+         */
+        size_t depthLimit() const {
+            return this->maxDepth < MAX_DEPTH_LIMIT ? this->maxDepth : MAX_DEPTH_LIMIT;
+        }
+    };
+
+    /**
+     * 非递归解析中一个尚未闭合的容器
+     */
+    struct ParseFrame {
+        FieldValue value;   // 对象在 '{' 处创建；数组在闭合时才一次性创建，此前为 J_NULL
+        JString key;        // 对象中等待值的键，没有时 s 为 nullptr
+        size_t stackBase;   // 数组的元素在 fieldStack 中的起始位置
+        bool isArray;
+    };
+
     /**
      * 解析上下文
      */
     struct ParseContext {
         const char* json = nullptr;
-        std::stack<char> charStack;
-        std::stack<FieldValue> fieldStack;
+        std::vector<char> strBuf;  // 解码字符串用的连续缓冲区，在整个解析过程中复用
+        std::deque<FieldValue> fieldStack;   // 尚未闭合的数组的元素，按顺序排列；按块增长，不会整体搬迁
+        std::vector<ParseFrame> frames;      // 尚未闭合的容器，代替递归调用的栈
+        size_t maxDepth = ParseOptions::DEFAULT_MAX_DEPTH;
+        size_t depth = 0;          // 外层已经打开的容器数，供递归的构建器（tape、SAX、两阶段解析）计数，parseValue 从这个层数开始检查限制
+        Arena* arena = nullptr;  // 非空时所有节点与字符串都从中分配
+        bool insitu = false;     // 为 true 时 json 指向可写的缓冲区，字符串原地解码
+        KeyPool* keyPool = nullptr;
+        const char* end = nullptr;  // 输入的末尾，为 nullptr 时输入以 '\0' 结尾；否则 end 之前的 '\0' 是非法字符
+        bool bounded = false;       // 为 true 时 end 处不可读，每次读取前都要检查边界
+    };
+
+    /**
+     * 基于 Arena 的 json 文档
+     * 解析出的所有节点与字符串都存放在文档自己的 Arena 中，
+     * 文档析构或 clear() 时按块一次性释放，无需逐个节点递归地 freeSpace()
+     */
+    class Document {
+    public:
+        explicit Document(size_t chunkSize = Arena::DEFAULT_CHUNK_SIZE) :
+            arena(chunkSize)
+        {}
+
+        Document(const Document&) = delete;
+        Document& operator=(const Document&) = delete;
+
+        FieldValue* getRoot() {
+            return &this->root;
+        }
+
+        const FieldValue* getRoot() const {
+            return &this->root;
+        }
+
+        Arena* getArena() {
+            return &this->arena;
+        }
+
+        /**
+         * 丢弃已解析的内容，Arena 保留第一个块以便下次解析复用
+         */
+        void clear() {
+            this->root.setType(JsonFieldType::J_NULL);
+            this->arena.clear();
+        }
+
+    private:
+        Arena arena;
+        FieldValue root;
     };
 
 
-    JsonParseStatus json_parse(FieldValue* v, const char* json_str);
+    JsonParseStatus json_parse(FieldValue* v, const char* json_str, const ParseOptions& options = ParseOptions());
+
+    /**
+     * 将 json 解析到文档的 Arena 中，文档中原有的内容会先被丢弃
+     * @param doc 目标文档
+     * @param json_str 以 '\0' 结尾的 json 字符串
+     * @param options 解析选项
+     * @return 解析结果状态
+     */
+    JsonParseStatus json_parse(Document* doc, const char* json_str, const ParseOptions& options = ParseOptions());
+
+    /**
+     * 解析 [data, data + len) 这段 json，输入不需要以 '\0' 结尾，可以直接来自网络或映射的缓冲区，
+     * 中间出现的 '\0' 按非法字符处理；解析结果只取决于范围内的字节。
+     * 启用 SIMD 时跳过空白会按对齐的 16/32 字节块读取，可能读到 data 之前或 data + len 之后、与范围同在一个对齐块中的字节，
+     * 这些字节不影响结果，对齐的块也不会跨越内存页，因此不会访问未映射的内存
+     * options.padded 为 true 时调用者保证 data[len] 可读且为 '\0'，解析走与 '\0' 结尾的输入相同的、不检查边界的路径
+     * @param v 解析结果
+     * @param data 输入的起始位置
+     * @param len 输入的长度
+     * @param options 解析选项
+     * @return 解析结果状态
+     */
+    JsonParseStatus json_parse(FieldValue* v, const char* data, size_t len, const ParseOptions& options = ParseOptions());
+
+    JsonParseStatus json_parse(Document* doc, const char* data, size_t len, const ParseOptions& options = ParseOptions());
+
+    inline JsonParseStatus json_parse(FieldValue* v, std::string_view json, const ParseOptions& options = ParseOptions()) {
+        return json_parse(v, json.data(), json.size(), options);
+    }
+
+    inline JsonParseStatus json_parse(Document* doc, std::string_view json, const ParseOptions& options = ParseOptions()) {
+        return json_parse(doc, json.data(), json.size(), options);
+    }
+
+    /**
+     * 原地解析：字符串直接在输入缓冲区中解码，解析结果中的字符串指向该缓冲区，
+     * 因此缓冲区必须比解析结果活得更久；解析失败时缓冲区的内容是未定义的
+     * @param v 解析结果
+     * @param json_str 可写的、以 '\0' 结尾的 json 字符串
+     * @param options 解析选项
+     * @return 解析结果状态
+     */
+    JsonParseStatus json_parse_insitu(FieldValue* v, char* json_str, const ParseOptions& options = ParseOptions());
+
+    /**
+     * 原地解析到文档中，数组与对象放在文档的 Arena 里，字符串仍指向输入缓冲区
+     * @param doc 目标文档
+     * @param json_str 可写的、以 '\0' 结尾的 json 字符串
+     * @param options 解析选项
+     * @return 解析结果状态
+     */
+    JsonParseStatus json_parse_insitu(Document* doc, char* json_str, const ParseOptions& options = ParseOptions());
+
+    /**
+     * 两阶段解析：第一阶段用 SIMD 建立结构字符的索引（见 StructuralIndex），第二阶段沿着索引建立树，
+     * 结果与错误状态都与 json_parse 相同，适合较大的输入。
+     * 没有通过 options.index 提供索引时使用线程内共享的索引，输入较大时解析结束后释放其空间
+     * @param v 解析结果
+     * @param json_str 以 '\0' 结尾的 json 字符串
+     * @param options 解析选项
+     * @return 解析结果状态
+     */
+    JsonParseStatus json_parse_indexed(FieldValue* v, const char* json_str, const ParseOptions& options = ParseOptions());
+
+    /**
+     * 两阶段解析到文档的 Arena 中，文档中原有的内容会先被丢弃
+     */
+    JsonParseStatus json_parse_indexed(Document* doc, const char* json_str, const ParseOptions& options = ParseOptions());
+
+    /**
+     * 直接从文件的只读内存映射中解析，不需要先把文件读进内存
+     * 映射区域在文件内容之后补满了 '\0'，因此按带填充的输入解析，文件中间的 '\0' 按非法字符处理
+     * @param v 解析结果，字符串都被拷贝出来，解析结束后映射即被解除
+     * @param path 文件路径
+     * @param options 解析选项
+     * @return 解析结果状态，文件无法打开时返回 PARSE_IO_ERROR
+     */
+    JsonParseStatus json_parse_file(FieldValue* v, const char* path, const ParseOptions& options = ParseOptions());
+
+    /**
+     * 从文件解析到文档的 Arena 中，文档中原有的内容会先被丢弃
+     */
+    JsonParseStatus json_parse_file(Document* doc, const char* path, const ParseOptions& options = ParseOptions());
+
+    /**
+     * 字符串化的输出格式
+     */
+    enum class StringifyStyle {
+        COMPACT,    // 不输出任何多余的空白
+        PRETTY      // 每个元素独占一行并缩进
+    };
+
+    /**
+     * 将 json 进行字符串化，结果追加到 out 的末尾
+     * out 可以在多次调用之间复用，已有的容量不会被释放；字符串中的 '"'、'\\' 与控制字符会被转义
+     * @param v 要字符串化的值
+     * @param out 输出缓冲区
+     * @param style 输出格式
+     * @param indent PRETTY 格式下每层缩进的空格数
+     */
+    void jsonStringify(const FieldValue* v, std::string* out,
+                       StringifyStyle style = StringifyStyle::COMPACT, int indent = 4);
 
     /**
-    * 将 json 进行字符串化
+    * 将 json 进行字符串化，使用紧凑格式
     * @param v
     * @return
     */
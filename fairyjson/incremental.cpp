@@ -0,0 +1,315 @@
+//
+// Created by yubin on 2021/5/15.
+//
+
+#include "incremental.h"
+#include "utils.h"
+#include "simd.h"
+
+namespace fairy {
+
+    /**
+     * 数字与字面量中可能出现的字符：结构字符、引号、空白与 '\0' 之外的所有字节
+     * 标量在这些字符处结束，之后交给 parseValue 判断是否合法
+     */
+    static bool isScalarChar(char ch) {
+        switch (ch) {
+            case '{': case '}': case '[': case ']': case ':': case ',': case '\"':
+            case ' ': case '\t': case '\n': case '\r': case '\0':
+                return false;
+            default:
+                return true;
+        }
+    }
+
+    IncrementalParser::IncrementalParser(const ParseOptions& options) {
+        this->context.maxDepth = options.depthLimit();
+    }
+
+    IncrementalParser::~IncrementalParser() {
+        clear();
+    }
+
+    void IncrementalParser::clear() {
+        for (auto& frame : this->frames) {
+            delete[] frame.key.s;
+            frame.value.freeSpace();
+        }
+        this->frames.clear();
+        this->root.freeSpace();
+        this->root = FieldValue();
+        this->inString = this->inScalar = this->escapeNext = false;
+        this->stringStart = nullptr;
+        this->pending.clear();
+    }
+
+    void IncrementalParser::reset() {
+        clear();
+        this->state = State::VALUE;
+        this->status = JsonParseStatus::PARSE_OK;
+    }
+
+    void IncrementalParser::fail(JsonParseStatus s) {
+        clear();
+        this->status = s;
+    }
+
+    JsonParseStatus IncrementalParser::feed(const char* chunk, size_t len) {
+        if (this->status == JsonParseStatus::PARSE_OK)
+            consume(chunk, chunk + len);
+        return this->status;
+    }
+
+    JsonParseStatus IncrementalParser::finish(FieldValue* v) {
+        *v = FieldValue();
+        if (this->status == JsonParseStatus::PARSE_OK) {
+            // 输入结束相当于在完整文档的末尾遇到 '\0'
+            if (this->inString)
+                finishString(nullptr);
+            else if (this->inScalar)
+                finishScalar(nullptr);
+            if (this->status == JsonParseStatus::PARSE_OK)
+                onToken('\0');
+        }
+        const JsonParseStatus retStatus = this->status;
+        if (retStatus == JsonParseStatus::PARSE_OK) {
+            *v = std::move(this->root);
+        }
+        reset();
+        return retStatus;
+    }
+
+    JsonParseStatus IncrementalParser::consume(const char* p, const char* end) {
+        while (p != end && this->status == JsonParseStatus::PARSE_OK) {
+            if (this->inString) {
+                p = continueString(p, end);
+            } else if (this->inScalar) {
+                const char* q = p;
+                while (q != end && isScalarChar(*q))
+                    ++q;
+                if (q != end && this->pending.empty()) {
+                    // 标量在当前块中结束，直接解析，parseValue 不会越过结尾的分隔符
+                    finishScalar(p);
+                } else {
+                    this->pending.insert(this->pending.end(), p, q);
+                    if (q != end)
+                        finishScalar(nullptr);
+                }
+                p = q;
+            } else if (isWhitespace(*p)) {
+                do {
+                    ++p;
+                } while (p != end && isWhitespace(*p));
+            } else {
+                const char ch = *p;
+                if (onToken(ch))
+                    ++p;
+                if (this->inString) {
+                    this->stringStart = p - 1;
+                    this->stringIsKey = this->state == State::OBJECT_COLON;
+                }
+            }
+        }
+        if (this->inString && this->stringStart != nullptr && this->status == JsonParseStatus::PARSE_OK) {
+            // 块用完时字符串还没有结束，暂存已读取的部分
+            this->pending.insert(this->pending.end(), this->stringStart, end);
+            this->stringStart = nullptr;
+        }
+        return this->status;
+    }
+
+    bool IncrementalParser::onToken(char ch) {
+        switch (this->state) {
+            case State::ARRAY_FIRST:
+                if (ch == ']') {
+                    closeContainer();
+                    return true;
+                }
+                // fall through
+            case State::VALUE:
+                switch (ch) {
+                    case '\"':
+                        this->inString = true;
+                        return true;
+                    case '[':
+                    case '{': {
+                        if (this->frames.size() >= this->context.maxDepth) {
+                            fail(JsonParseStatus::PARSE_DEPTH_EXCEEDED);
+                            return true;
+                        }
+                        Frame frame;
+                        frame.key = {nullptr, 0};
+                        if (ch == '[') {
+                            frame.value.setType(JsonFieldType::J_ARRAY);
+                            frame.value.setArray(new FieldArray());
+                            this->state = State::ARRAY_FIRST;
+                        } else {
+                            frame.value.setType(JsonFieldType::J_OBJECT);
+                            frame.value.setObj(new FieldObject());
+                            this->state = State::OBJECT_FIRST;
+                        }
+                        this->frames.push_back(std::move(frame));
+                        return true;
+                    }
+                    case '\0':
+                        fail(JsonParseStatus::PARSE_EXPECT_VALUE);
+                        return true;
+                    case ']': case '}': case ':': case ',':
+                        // 与 parseValue 一样，按数字解析时报告不合法的值
+                        fail(JsonParseStatus::PARSE_INVALID_VALUE);
+                        return true;
+                    default:
+                        this->inScalar = true;
+                        this->pending.clear();
+                        return false;
+                }
+            case State::ARRAY_NEXT:
+                if (ch == ',') {
+                    this->state = State::VALUE;
+                } else if (ch == ']') {
+                    closeContainer();
+                } else {
+                    fail(JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET);
+                }
+                return true;
+            case State::OBJECT_FIRST:
+                if (ch == '}') {
+                    closeContainer();
+                    return true;
+                }
+                // fall through
+            case State::OBJECT_KEY:
+                if (ch == '\"') {
+                    // 键读完之后等待 ':'
+                    this->state = State::OBJECT_COLON;
+                    this->inString = true;
+                } else {
+                    fail(JsonParseStatus::PARSE_MISS_KEY);
+                }
+                return true;
+            case State::OBJECT_COLON:
+                if (ch == ':')
+                    this->state = State::VALUE;
+                else
+                    fail(JsonParseStatus::PARSE_MISS_COLON);
+                return true;
+            case State::OBJECT_NEXT:
+                if (ch == ',') {
+                    this->state = State::OBJECT_KEY;
+                } else if (ch == '}') {
+                    closeContainer();
+                } else {
+                    fail(JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET);
+                }
+                return true;
+            case State::ROOT_DONE:
+                if (ch != '\0')
+                    fail(JsonParseStatus::PARSE_ROOT_NOT_SINGULAR);
+                return true;
+        }
+        return true;
+    }
+
+    const char* IncrementalParser::continueString(const char* p, const char* end) {
+        if (this->stringStart == nullptr)
+            this->stringStart = p;
+        while (true) {
+            if (this->escapeNext) {
+                if (p == end)
+                    break;
+                ++p;
+                this->escapeNext = false;
+            }
+            p = scanStringSpecial(p, end);
+            if (p == end)
+                break;
+            const char ch = *p++;
+            if (ch == '\"') {
+                finishString(p);
+                return p;
+            }
+            if (ch == '\\')
+                this->escapeNext = true;
+            // 控制字符留给解码时报告
+        }
+        return end;
+    }
+
+    void IncrementalParser::finishString(const char* end) {
+        const char* s = nullptr;
+        size_t len = 0;
+        ParseContext* c = &this->context;
+        if (this->pending.empty()) {
+            // 整个字符串都在当前块中，直接解码
+            c->json = this->stringStart;
+        } else {
+            if (end != nullptr)
+                this->pending.insert(this->pending.end(), this->stringStart, end);
+            this->pending.push_back('\0');
+            c->json = this->pending.data();
+        }
+        c->strBuf.clear();
+        const auto retStatus = decodeStringRaw(c, &s, &len);
+        this->inString = false;
+        this->stringStart = nullptr;
+        if (retStatus != JsonParseStatus::PARSE_OK) {
+            fail(retStatus);
+            return;
+        }
+        char* str = copyStr(s, len, nullptr);
+        this->pending.clear();
+        if (this->stringIsKey) {
+            this->frames.back().key = {str, len};
+            return;
+        }
+        FieldValue v(JsonFieldType::J_STRING);
+        v.setJStr(str, len);
+        valueDone(std::move(v));
+    }
+
+    void IncrementalParser::finishScalar(const char* p) {
+        ParseContext* c = &this->context;
+        if (p != nullptr) {
+            c->json = p;
+        } else {
+            this->pending.push_back('\0');
+            c->json = this->pending.data();
+        }
+        FieldValue v;
+        const auto retStatus = parseValue(c, &v);
+        this->inScalar = false;
+        if (retStatus != JsonParseStatus::PARSE_OK) {
+            fail(retStatus);
+            return;
+        }
+        const char leftover = *c->json;
+        this->pending.clear();
+        valueDone(std::move(v));
+        // 标量之后紧跟着的字节，例如 "0123" 中的 "123"，在值之后一定是语法错误
+        if (leftover != '\0' && isScalarChar(leftover))
+            onToken(leftover);
+    }
+
+    void IncrementalParser::closeContainer() {
+        FieldValue v = std::move(this->frames.back().value);
+        this->frames.pop_back();
+        valueDone(std::move(v));
+    }
+
+    void IncrementalParser::valueDone(FieldValue&& v) {
+        if (this->frames.empty()) {
+            this->root = std::move(v);
+            this->state = State::ROOT_DONE;
+            return;
+        }
+        Frame& top = this->frames.back();
+        if (top.value.getType() == JsonFieldType::J_ARRAY) {
+            top.value.getArray()->push_back(std::move(v));
+            this->state = State::ARRAY_NEXT;
+        } else {
+            top.value.getObj()->append(top.key, std::move(v));
+            top.key = {nullptr, 0};
+            this->state = State::OBJECT_NEXT;
+        }
+    }
+}
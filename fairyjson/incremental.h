@@ -0,0 +1,123 @@
+//
+// Created by yubin on 2021/5/15.
+//
+
+#pragma once
+
+#include <vector>
+#include "fairy_json.h"
+
+namespace fairy {
+
+    /**
+     * 推送式的增量解析器，输入可以被切成任意大小的块依次送入，不需要先拼接成完整的文档
+     * 解析状态（未闭合的字符串、数字、\u 转义以及容器的嵌套）在块之间保留。
+     * 只有跨越块边界的字符串与数字才会被暂存，其余内容直接从输入块中解析。
+     * 结果与错误状态都与对拼接后的完整文档调用 json_parse 相同；容器的嵌套由显式的栈记录，不使用递归
+     */
+    class IncrementalParser {
+    public:
+        /**
+         * @param options 解析选项，只有 maxDepth 起作用，对之后解析的每个文档都有效
+         */
+        explicit IncrementalParser(const ParseOptions& options = ParseOptions());
+
+        ~IncrementalParser();
+
+        IncrementalParser(const IncrementalParser&) = delete;
+        IncrementalParser& operator=(const IncrementalParser&) = delete;
+
+        /**
+         * 送入下一块输入，块在调用返回后即可释放
+         * @param chunk 输入块，不要求以 '\0' 结尾
+         * @param len 块的长度
+         * @return 目前为止没有发现错误时返回 PARSE_OK；出错后之后的调用都返回同一个错误
+         */
+        JsonParseStatus feed(const char* chunk, size_t len);
+
+        /**
+         * 输入结束，取出解析结果
+         * 之后解析器回到初始状态，可以开始解析下一个文档
+         * @param v 解析结果，原有的值会先被释放；失败时为 J_NULL
+         * @return 解析结果状态
+         */
+        JsonParseStatus finish(FieldValue* v);
+
+        /**
+         * 丢弃已解析的内容，回到初始状态
+         */
+        void reset();
+
+    private:
+        /**
+         * 语法上的位置，即下一个非空白字符应当是什么
+         */
+        enum class State {
+            VALUE,          // 一个值
+            ARRAY_FIRST,    // '[' 之后：值或 ']'
+            ARRAY_NEXT,     // 元素之后：',' 或 ']'
+            OBJECT_FIRST,   // '{' 之后：键或 '}'
+            OBJECT_KEY,     // ',' 之后：键
+            OBJECT_COLON,   // 键之后：':'
+            OBJECT_NEXT,    // 成员的值之后：',' 或 '}'
+            ROOT_DONE       // 根元素之后：只允许空白
+        };
+
+        /**
+         * 一个尚未闭合的容器
+         */
+        struct Frame {
+            FieldValue value;
+            JString key;    // 对象中等待值的键，没有时 s 为 nullptr
+        };
+
+        JsonParseStatus consume(const char* p, const char* end);
+
+        /**
+         * 处理一个空白之外的字符，字符串与标量只记录开始，由 consume 继续读取
+         * @param ch 当前字符，'\0' 表示输入结束
+         * @return 字符是否被消耗；标量的首字符不被消耗
+         */
+        bool onToken(char ch);
+
+        /**
+         * 继续读取字符串，直到结尾的 '"' 或输入块的末尾
+         * @return 读取之后的位置
+         */
+        const char* continueString(const char* p, const char* end);
+
+        void finishString(const char* end);
+
+        /**
+         * @param p 非空时标量在当前块中从 p 开始，否则在 pending 中
+         */
+        void finishScalar(const char* p);
+
+        /**
+         * 一个值解析完成，放进所在的容器
+         */
+        void valueDone(FieldValue&& v);
+
+        /**
+         * 栈顶的容器闭合，作为一个值放进外层
+         */
+        void closeContainer();
+
+        void fail(JsonParseStatus s);
+
+        void clear();
+
+        std::vector<Frame> frames;
+        FieldValue root;
+        State state = State::VALUE;
+        JsonParseStatus status = JsonParseStatus::PARSE_OK;
+
+        bool inString = false;
+        bool inScalar = false;
+        bool stringIsKey = false;
+        bool escapeNext = false;          // 上一块以未配对的 '\\' 结尾
+        const char* stringStart = nullptr;  // 当前块中字符串的起始位置
+        std::vector<char> pending;        // 跨越块边界的字符串（含开头的 '"'）或标量
+        ParseContext context;
+    };
+}
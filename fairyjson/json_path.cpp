@@ -0,0 +1,367 @@
+//
+// Created by yubin on 2021/5/16.
+//
+
+#include "json_path.h"
+#include <algorithm>
+#include <cstring>
+
+namespace fairy {
+
+    /**
+     * 把十进制的下标转换成数字，不接受前导 0 与溢出
+     * @return 不是合法的下标时返回 PathStep::NO_INDEX
+     */
+    static size_t parseIndex(const char* s, size_t len) {
+        if (len == 0 || len > 18 || (s[0] == '0' && len > 1))
+            return PathStep::NO_INDEX;
+        size_t index = 0;
+        for (size_t i = 0; i < len; ++i) {
+            if (s[i] < '0' || s[i] > '9')
+                return PathStep::NO_INDEX;
+            index = index * 10 + (s[i] - '0');
+        }
+        return index;
+    }
+
+    /**
+     * 解析 JSON Pointer：空串表示根，否则每个 '/' 之后是一个引用记号，记号中的 "~1" 表示 '/'，"~0" 表示 '~'
+     */
+    static bool compilePointer(const char* path, size_t len, std::vector<PathStep>* steps) {
+        if (len == 0)
+            return true;
+        if (path[0] != '/')
+            return false;
+        size_t i = 1;
+        while (true) {
+            PathStep step{PathStep::TOKEN, std::string(), PathStep::NO_INDEX};
+            for (; i < len && path[i] != '/'; ++i) {
+                if (path[i] != '~') {
+                    step.key += path[i];
+                    continue;
+                }
+                if (++i == len || (path[i] != '0' && path[i] != '1'))
+                    return false;
+                step.key += path[i] == '0' ? '~' : '/';
+            }
+            step.index = parseIndex(step.key.data(), step.key.size());
+            steps->push_back(std::move(step));
+            if (i == len)
+                return true;
+            ++i;
+        }
+    }
+
+    /**
+     * 解析 JSONPath 的子集：$ 之后是任意个 .name、.*、[n]、[*]、['name'] 或 ["name"]
+     * 带引号的名字中可以用 '\' 转义引号与 '\' 本身
+     */
+    static bool compileJsonPath(const char* path, size_t len, std::vector<PathStep>* steps) {
+        size_t i = 1;
+        while (i < len) {
+            PathStep step{PathStep::MEMBER, std::string(), PathStep::NO_INDEX};
+            if (path[i] == '.') {
+                if (++i < len && path[i] == '*') {
+                    step.kind = PathStep::WILDCARD;
+                    ++i;
+                } else {
+                    const size_t begin = i;
+                    while (i < len && path[i] != '.' && path[i] != '[')
+                        ++i;
+                    if (i == begin)
+                        return false;
+                    step.key.assign(path + begin, i - begin);
+                }
+            } else if (path[i] == '[') {
+                if (++i == len)
+                    return false;
+                if (path[i] == '*') {
+                    step.kind = PathStep::WILDCARD;
+                    ++i;
+                } else if (path[i] == '\'' || path[i] == '\"') {
+                    const char quote = path[i++];
+                    for (; i < len && path[i] != quote; ++i) {
+                        if (path[i] == '\\' && ++i == len)
+                            return false;
+                        step.key += path[i];
+                    }
+                    if (i == len)
+                        return false;
+                    ++i;
+                } else {
+                    const size_t begin = i;
+                    while (i < len && path[i] != ']')
+                        ++i;
+                    step.kind = PathStep::ELEMENT;
+                    step.index = parseIndex(path + begin, i - begin);
+                    if (step.index == PathStep::NO_INDEX)
+                        return false;
+                }
+                if (i == len || path[i] != ']')
+                    return false;
+                ++i;
+            } else {
+                return false;
+            }
+            steps->push_back(std::move(step));
+        }
+        return true;
+    }
+
+    static bool compilePath(const char* path, size_t len, std::vector<PathStep>* steps) {
+        steps->clear();
+        const bool ok = len > 0 && path[0] == '$' ? compileJsonPath(path, len, steps) : compilePointer(path, len, steps);
+        if (!ok)
+            steps->clear();
+        return ok;
+    }
+
+    static bool matchesKey(const PathStep& step, const char* key, size_t len) {
+        if (step.kind == PathStep::WILDCARD)
+            return true;
+        return step.kind != PathStep::ELEMENT && step.key.size() == len && memcmp(step.key.data(), key, len) == 0;
+    }
+
+    static bool matchesIndex(const PathStep& step, size_t i) {
+        return step.kind == PathStep::WILDCARD || (step.kind != PathStep::MEMBER && step.index == i);
+    }
+
+    /**
+     * 依次访问 v 中与 step 匹配的成员或元素
+     * @param visit 返回 false 时停止
+     */
+    template <typename Visit>
+    static void visitChildren(const PathStep& step, const FieldValue* v, Visit visit) {
+        if (v->getType() == JsonFieldType::J_OBJECT) {
+            const FieldObject* obj = v->getObj();
+            if (step.kind == PathStep::WILDCARD) {
+                for (auto it = obj->begin(); it != obj->end() && visit(&it->second); ++it) {}
+            } else if (step.kind != PathStep::ELEMENT) {
+                auto it = obj->find(step.key.data(), step.key.size());
+                if (it != obj->end())
+                    visit(&it->second);
+            }
+        } else if (v->getType() == JsonFieldType::J_ARRAY) {
+            const FieldArray* array = v->getArray();
+            if (step.kind == PathStep::WILDCARD) {
+                for (size_t k = 0; k < array->size() && visit(&(*array)[k]); ++k) {}
+            } else if (step.kind != PathStep::MEMBER && step.index < array->size()) {
+                visit(&(*array)[step.index]);
+            }
+        }
+    }
+
+    /**
+     * 在 FieldValue 树上从第 i 步开始求值
+     * @param limit 找到这么多个值之后停止
+     */
+    static void collect(const std::vector<PathStep>& steps, size_t i, const FieldValue* v,
+                        std::vector<const FieldValue*>* matches, size_t limit) {
+        if (i == steps.size()) {
+            matches->push_back(v);
+            return;
+        }
+        visitChildren(steps[i], v, [&](const FieldValue* child) {
+            collect(steps, i + 1, child, matches, limit);
+            return matches->size() < limit;
+        });
+    }
+
+    /**
+     * 在 json 文本上从第 i 步开始求值
+     */
+    static JsonParseStatus collect(const std::vector<PathStep>& steps, size_t i, const LazyValue& v,
+                                   std::vector<LazyValue>* matches) {
+        if (i == steps.size()) {
+            matches->push_back(v);
+            return JsonParseStatus::PARSE_OK;
+        }
+        const PathStep& step = steps[i];
+        const JsonFieldType type = v.getType();
+        if (type == JsonFieldType::J_OBJECT) {
+            LazyObject obj;
+            v.getObject(&obj);
+            LazyValue member;
+            if (step.kind != PathStep::WILDCARD) {
+                if (step.kind == PathStep::ELEMENT)
+                    return JsonParseStatus::PARSE_OK;
+                const auto retStatus = obj.findField(step.key.data(), step.key.size(), &member);
+                if (retStatus != JsonParseStatus::PARSE_OK || !member.exists())
+                    return retStatus;
+                return collect(steps, i + 1, member, matches);
+            }
+            const char* key = nullptr;
+            size_t len = 0;
+            while (obj.next(&key, &len, &member)) {
+                const auto retStatus = collect(steps, i + 1, member, matches);
+                if (retStatus != JsonParseStatus::PARSE_OK)
+                    return retStatus;
+            }
+            return obj.getStatus();
+        }
+        if (type == JsonFieldType::J_ARRAY) {
+            LazyArray array;
+            v.getArray(&array);
+            LazyValue e;
+            if (step.kind == PathStep::MEMBER || (step.kind == PathStep::TOKEN && step.index == PathStep::NO_INDEX))
+                return JsonParseStatus::PARSE_OK;
+            for (size_t k = 0; array.next(&e); ++k) {
+                if (!matchesIndex(step, k))
+                    continue;
+                const auto retStatus = collect(steps, i + 1, e, matches);
+                if (retStatus != JsonParseStatus::PARSE_OK || step.kind != PathStep::WILDCARD)
+                    return retStatus;
+            }
+            return array.getStatus();
+        }
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    bool JsonPath::compile(const char* path, size_t len) {
+        return compilePath(path, len, &this->steps);
+    }
+
+    void JsonPath::evaluate(const FieldValue* root, std::vector<const FieldValue*>* matches) const {
+        collect(this->steps, 0, root, matches, static_cast<size_t>(-1));
+    }
+
+    const FieldValue* JsonPath::evaluateFirst(const FieldValue* root) const {
+        std::vector<const FieldValue*> matches;
+        collect(this->steps, 0, root, &matches, 1);
+        return matches.empty() ? nullptr : matches[0];
+    }
+
+    JsonParseStatus JsonPath::evaluate(const LazyValue& root, std::vector<LazyValue>* matches) const {
+        return collect(this->steps, 0, root, matches);
+    }
+
+    JsonPathSet::JsonPathSet() :
+        nodes(1)
+    {}
+
+    bool JsonPathSet::add(const char* path, size_t len, size_t* id) {
+        std::vector<PathStep> steps;
+        if (!compilePath(path, len, &steps))
+            return false;
+        std::vector<size_t> visited{0};
+        size_t node = 0;
+        for (auto& step : steps) {
+            Node& n = this->nodes[node];
+            size_t next = 0;
+            for (size_t k = 0; k < n.steps.size() && next == 0; ++k) {
+                if (n.steps[k].kind == step.kind && n.steps[k].key == step.key && n.steps[k].index == step.index)
+                    next = n.children[k];
+            }
+            if (next == 0) {
+                // 先取下标：push_back 可能使 n 失效
+                next = this->nodes.size();
+                n.steps.push_back(std::move(step));
+                n.children.push_back(next);
+                this->nodes.emplace_back();
+            }
+            node = next;
+            visited.push_back(node);
+        }
+        *id = this->pathNodes.size();
+        this->nodes[node].paths.push_back(*id);
+        for (size_t k : visited)
+            ++this->nodes[k].pathCount;
+        this->pathNodes.push_back(std::move(visited));
+        return true;
+    }
+
+    void JsonPathSet::evaluate(const FieldValue* root, std::vector<const FieldValue*>* values) const {
+        values->assign(this->pathNodes.size(), nullptr);
+        evaluate(0, root, values);
+    }
+
+    void JsonPathSet::evaluate(size_t node, const FieldValue* v, std::vector<const FieldValue*>* values) const {
+        const Node& n = this->nodes[node];
+        for (size_t path : n.paths) {
+            if ((*values)[path] == nullptr)
+                (*values)[path] = v;
+        }
+        for (size_t k = 0; k < n.steps.size(); ++k) {
+            visitChildren(n.steps[k], v, [&](const FieldValue* child) {
+                evaluate(n.children[k], child, values);
+                return true;
+            });
+        }
+    }
+
+    JsonParseStatus JsonPathSet::evaluate(const LazyValue& root, std::vector<LazyValue>* values) {
+        values->assign(this->pathNodes.size(), LazyValue());
+        this->pending.resize(this->nodes.size());
+        for (size_t k = 0; k < this->nodes.size(); ++k)
+            this->pending[k] = this->nodes[k].pathCount;
+        if (this->pathNodes.empty())
+            return JsonParseStatus::PARSE_OK;
+        return evaluate(0, root, values);
+    }
+
+    void JsonPathSet::resolve(size_t path) {
+        for (size_t node : this->pathNodes[path])
+            --this->pending[node];
+    }
+
+    JsonParseStatus JsonPathSet::evaluate(size_t node, const LazyValue& v, std::vector<LazyValue>* values) {
+        const Node& n = this->nodes[node];
+        for (size_t path : n.paths) {
+            if (!(*values)[path].exists()) {
+                (*values)[path] = v;
+                resolve(path);
+            }
+        }
+        if (this->pending[node] == 0)
+            return JsonParseStatus::PARSE_OK;
+        const JsonFieldType type = v.getType();
+        if (type == JsonFieldType::J_OBJECT) {
+            LazyObject obj;
+            v.getObject(&obj);
+            const char* key = nullptr;
+            size_t len = 0;
+            LazyValue member;
+            // 解码出的键在下一次访问文档之前有效，所以先比较完所有分支，把匹配的子节点暂存在 hits 末尾再进入子树
+            const size_t base = this->hits.size();
+            while (this->pending[node] != 0 && obj.next(&key, &len, &member)) {
+                for (size_t k = 0; k < n.steps.size(); ++k) {
+                    if (this->pending[n.children[k]] != 0 && matchesKey(n.steps[k], key, len))
+                        this->hits.push_back(n.children[k]);
+                }
+                for (size_t k = base; k < this->hits.size(); ++k) {
+                    const auto retStatus = evaluate(this->hits[k], member, values);
+                    if (retStatus != JsonParseStatus::PARSE_OK) {
+                        this->hits.resize(base);
+                        return retStatus;
+                    }
+                }
+                this->hits.resize(base);
+            }
+            return obj.getStatus();
+        }
+        if (type == JsonFieldType::J_ARRAY) {
+            // 没有通配符时，超过最大的下标之后不再扫描
+            size_t last = 0;
+            for (auto& step : n.steps) {
+                if (step.kind == PathStep::WILDCARD)
+                    last = PathStep::NO_INDEX;
+                else if (step.kind != PathStep::MEMBER && step.index != PathStep::NO_INDEX && last != PathStep::NO_INDEX)
+                    last = std::max(last, step.index + 1);
+            }
+            LazyArray array;
+            v.getArray(&array);
+            LazyValue e;
+            for (size_t i = 0; i < last && this->pending[node] != 0 && array.next(&e); ++i) {
+                for (size_t k = 0; k < n.steps.size(); ++k) {
+                    if (this->pending[n.children[k]] == 0 || !matchesIndex(n.steps[k], i))
+                        continue;
+                    const auto retStatus = evaluate(n.children[k], e, values);
+                    if (retStatus != JsonParseStatus::PARSE_OK)
+                        return retStatus;
+                }
+            }
+            return array.getStatus();
+        }
+        return JsonParseStatus::PARSE_OK;
+    }
+}
@@ -0,0 +1,140 @@
+//
+// Created by yubin on 2021/5/16.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "fairy_json.h"
+#include "lazy_json.h"
+
+namespace fairy {
+
+    /**
+     * 路径中的一步
+     */
+    struct PathStep {
+        enum Kind {
+            MEMBER,     // JSONPath 的 .name 与 ['name']，只匹配对象的成员
+            ELEMENT,    // JSONPath 的 [n]，只匹配数组的元素
+            TOKEN,      // JSON Pointer 的引用记号，匹配对象的成员；是合法的下标时也匹配数组的元素
+            WILDCARD    // JSONPath 的 .* 与 [*]，匹配对象的所有成员或数组的所有元素
+        };
+
+        Kind kind;
+        std::string key;
+        size_t index;       // ELEMENT 的下标；TOKEN 不是合法的下标时为 NO_INDEX
+
+        static const size_t NO_INDEX = static_cast<size_t>(-1);
+    };
+
+    /**
+     * 编译好的路径，可以在多个文档上反复求值
+     * 支持 JSON Pointer（RFC 6901），例如 "/a/b/3"、"/a~1b"，其中的数字记号既可以是对象的键也可以是数组的下标；
+     * 以及以 '$' 开头的 JSONPath 子集："$.a.b[3]"、"$['a.b']"、"$.a.*"、"$.a[*].id"，不支持递归下降、切片与过滤器
+     */
+    class JsonPath {
+    public:
+        JsonPath() = default;
+
+        /**
+         * 编译路径，以 '$' 开头的按 JSONPath 解析，其余按 JSON Pointer 解析
+         * @param path 路径
+         * @param len 路径的长度
+         * @return 路径有语法错误时返回 false，此时 JsonPath 为空，匹配根元素
+         */
+        bool compile(const char* path, size_t len);
+
+        bool compile(const std::string& path) {
+            return compile(path.data(), path.size());
+        }
+
+        /**
+         * 在 FieldValue 树上求值
+         * @param root 根元素
+         * @param matches 匹配的值按文档中的顺序追加在末尾，指向 root 树中的节点
+         */
+        void evaluate(const FieldValue* root, std::vector<const FieldValue*>* matches) const;
+
+        /**
+         * @return 第一个匹配的值，没有匹配时返回 nullptr
+         */
+        const FieldValue* evaluateFirst(const FieldValue* root) const;
+
+        /**
+         * 直接在 json 文本上求值，不匹配的子树只做括号与引号的配对检查即被跳过，不会被解析
+         * @param root LazyDocument 中的一个值
+         * @param matches 匹配的值按文档中的顺序追加在末尾
+         * @return 遍历过的部分有语法错误时返回对应的错误，此时 matches 中可能已有部分结果
+         */
+        JsonParseStatus evaluate(const LazyValue& root, std::vector<LazyValue>* matches) const;
+
+        const std::vector<PathStep>& getSteps() const {
+            return this->steps;
+        }
+
+    private:
+        std::vector<PathStep> steps;
+    };
+
+    /**
+     * 一组编译好的路径，每条路径取第一个匹配的值
+     * 路径按步骤合并成一棵前缀树，在 json 文本上求值时整份文档只遍历一次：
+     * 对象的每个成员只解码一次键并与树中的分支比较，不匹配的成员被跳过；
+     * 某个容器之下的路径都已经找到值之后，不再扫描这个容器剩下的部分
+     */
+    class JsonPathSet {
+    public:
+        JsonPathSet();
+
+        /**
+         * 编译一条路径并加入集合，语法同 JsonPath::compile
+         * @param id 路径的编号，即它在求值结果中的下标
+         * @return 路径有语法错误时返回 false，集合不变
+         */
+        bool add(const char* path, size_t len, size_t* id);
+
+        bool add(const std::string& path, size_t* id) {
+            return add(path.data(), path.size(), id);
+        }
+
+        size_t size() const {
+            return this->pathNodes.size();
+        }
+
+        /**
+         * 在 FieldValue 树上求值
+         * @param values 每条路径第一个匹配的值，没有匹配时为 nullptr
+         */
+        void evaluate(const FieldValue* root, std::vector<const FieldValue*>* values) const;
+
+        /**
+         * 直接在 json 文本上求值
+         * @param values 每条路径第一个匹配的值，没有匹配时 exists() 为 false
+         * @return 遍历过的部分有语法错误时返回对应的错误
+         */
+        JsonParseStatus evaluate(const LazyValue& root, std::vector<LazyValue>* values);
+
+    private:
+        struct Node {
+            std::vector<PathStep> steps;    // 各个分支的步骤
+            std::vector<size_t> children;   // 与 steps 一一对应的子节点
+            std::vector<size_t> paths;      // 恰好在此结束的路径
+            size_t pathCount = 0;           // 经过此节点的路径数
+        };
+
+        void evaluate(size_t node, const FieldValue* v, std::vector<const FieldValue*>* values) const;
+        JsonParseStatus evaluate(size_t node, const LazyValue& v, std::vector<LazyValue>* values);
+
+        /**
+         * 路径找到第一个值时记录下来，并更新路径经过的每个节点中尚未找到值的路径数
+         */
+        void resolve(size_t path);
+
+        std::vector<Node> nodes;                 // nodes[0] 是根
+        std::vector<std::vector<size_t>> pathNodes;  // 每条路径从根到结束处经过的节点
+        std::vector<size_t> pending;             // 求值时每个节点之下尚未找到值的路径数
+        std::vector<size_t> hits;                // 求值时各层对象中与当前成员匹配的子节点
+    };
+}
@@ -0,0 +1,103 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#include "key_pool.h"
+#include <cstring>
+#include "utils.h"
+
+namespace fairy {
+
+    static const size_t INITIAL_CAPACITY = 256;
+
+    KeyPool::KeyPool(size_t maxKeys, size_t maxKeyLength) :
+        table(newTable(INITIAL_CAPACITY)), count(0), maxKeys(maxKeys), maxKeyLength(maxKeyLength)
+    {}
+
+    KeyPool::~KeyPool() {
+        retired.push_back(table.load(std::memory_order_relaxed));
+        for (auto t : retired) {
+            delete[] t->slots;
+            delete t;
+        }
+    }
+
+    KeyPool::Table* KeyPool::newTable(size_t capacity) {
+        auto t = new Table;
+        t->mask = capacity - 1;
+        t->slots = new std::atomic<const Entry*>[capacity]();
+        return t;
+    }
+
+    /**
+     * 在表中按线性探测查找键，遇到空槽即说明不存在
+     */
+    const KeyPool::Entry* KeyPool::probe(const Table* t, const char* s, size_t len, uint32_t hash) {
+        for (size_t slot = hash & t->mask; ; slot = (slot + 1) & t->mask) {
+            const Entry* e = t->slots[slot].load(std::memory_order_acquire);
+            if (e == nullptr)
+                return nullptr;
+            if (e->hash == hash && e->len == len && memcmp(e->data(), s, len) == 0)
+                return e;
+        }
+    }
+
+    /**
+     * 把一个确定不存在的键放进表中，只在持有写锁时调用
+     */
+    void KeyPool::insert(Table* t, const Entry* e) {
+        size_t slot = e->hash & t->mask;
+        while (t->slots[slot].load(std::memory_order_relaxed) != nullptr)
+            slot = (slot + 1) & t->mask;
+        // release 保证读者看到槽中的指针时，键的内容已经写好
+        t->slots[slot].store(e, std::memory_order_release);
+    }
+
+    const char* KeyPool::find(const char* s, size_t len) const {
+        const Entry* e = probe(table.load(std::memory_order_acquire), s, len, hashBytes(s, len));
+        return e != nullptr ? e->data() : nullptr;
+    }
+
+    const char* KeyPool::intern(const char* s, size_t len) {
+        if (len > maxKeyLength)
+            return nullptr;
+        const uint32_t hash = hashBytes(s, len);
+        // 绝大多数键已经在池中，先走无锁的查找
+        const Entry* e = probe(table.load(std::memory_order_acquire), s, len, hash);
+        if (e != nullptr)
+            return e->data();
+
+        std::lock_guard<std::mutex> lock(writeMutex);
+        Table* t = table.load(std::memory_order_relaxed);
+        e = probe(t, s, len, hash);
+        if (e != nullptr)
+            return e->data();
+        const size_t n = count.load(std::memory_order_relaxed);
+        if (n >= maxKeys)
+            return nullptr;
+
+        auto entry = static_cast<Entry*>(storage.allocate(sizeof(Entry) + len + 1, alignof(Entry)));
+        entry->len = len;
+        entry->hash = hash;
+        char* data = reinterpret_cast<char*>(entry + 1);
+        memcpy(data, s, len);
+        data[len] = '\0';
+
+        if ((n + 1) * 2 > t->mask + 1) {
+            // 装载因子超过 1/2，拷贝到新表后整体发布，旧表可能还有读者在用，留到析构时释放
+            Table* grown = newTable((t->mask + 1) * 2);
+            for (size_t i = 0; i <= t->mask; ++i) {
+                const Entry* old = t->slots[i].load(std::memory_order_relaxed);
+                if (old != nullptr)
+                    insert(grown, old);
+            }
+            insert(grown, entry);
+            table.store(grown, std::memory_order_release);
+            retired.push_back(t);
+        } else {
+            insert(t, entry);
+        }
+        count.store(n + 1, std::memory_order_relaxed);
+        return entry->data();
+    }
+}
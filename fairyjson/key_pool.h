@@ -0,0 +1,90 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "arena.h"
+
+namespace fairy {
+
+    /**
+     * 可在多个文档、多个线程之间共享的对象键驻留池
+     * 同样内容的键只保存一份，解析出的键直接指向池中的规范副本，既省去了每个键的分配，
+     * 也使得用池中指针查找时只需比较指针。
+     * 查找不加锁：哈希表的槽与表本身都通过原子指针发布，新键在互斥锁的保护下插入，
+     * 表满一半时拷贝到两倍大的新表后整体替换，旧表保留到池析构时才释放，所以读者不会访问到已释放的内存。
+     * 池中的键在池析构之前一直有效，池必须比所有用它解析出的结果活得更久
+     */
+    class KeyPool {
+    public:
+        static const size_t DEFAULT_MAX_KEYS = 64 * 1024;
+        static const size_t DEFAULT_MAX_KEY_LENGTH = 256;
+
+        /**
+         * @param maxKeys 最多驻留的键的个数，达到上限后不再接受新键，防止不可信的输入撑大池
+         * @param maxKeyLength 能够驻留的最长的键
+         */
+        explicit KeyPool(size_t maxKeys = DEFAULT_MAX_KEYS, size_t maxKeyLength = DEFAULT_MAX_KEY_LENGTH);
+
+        ~KeyPool();
+
+        KeyPool(const KeyPool&) = delete;
+        KeyPool& operator=(const KeyPool&) = delete;
+
+        /**
+         * 查找键的规范副本，不加锁，可以与 intern 并发调用
+         * @param s 键的起始位置
+         * @param len 键的长度
+         * @return 以 '\0' 结尾的规范副本，不存在时返回 nullptr
+         */
+        const char* find(const char* s, size_t len) const;
+
+        /**
+         * 驻留一个键，已经存在时直接返回已有的副本
+         * @param s 键的起始位置
+         * @param len 键的长度
+         * @return 以 '\0' 结尾的规范副本；键过长或池已满时返回 nullptr，调用者需要自行保存该键
+         */
+        const char* intern(const char* s, size_t len);
+
+        /**
+         * @return 已驻留的键的个数
+         */
+        size_t size() const {
+            return count.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Entry {
+            size_t len;
+            uint32_t hash;
+
+            const char* data() const {
+                return reinterpret_cast<const char*>(this + 1);
+            }
+        };
+
+        struct Table {
+            size_t mask;  // 槽数减一，槽数是 2 的幂
+            std::atomic<const Entry*>* slots;
+        };
+
+        static Table* newTable(size_t capacity);
+        static const Entry* probe(const Table* t, const char* s, size_t len, uint32_t hash);
+        void insert(Table* t, const Entry* e);
+
+        std::atomic<Table*> table;
+        std::atomic<size_t> count;
+        const size_t maxKeys;
+        const size_t maxKeyLength;
+        std::mutex writeMutex;           // 保护下面的成员以及所有写操作
+        Arena storage;                   // 存放键的内容
+        std::vector<Table*> retired;     // 被替换掉的旧表
+    };
+}
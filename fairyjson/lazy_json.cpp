@@ -0,0 +1,345 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#include "lazy_json.h"
+#include <cassert>
+#include "utils.h"
+#include "simd.h"
+
+namespace fairy {
+
+    LazyDocument::LazyDocument(const char* json) :
+        json(json)
+    {}
+
+    JsonParseStatus LazyDocument::getRoot(LazyValue* v) {
+        const char* p = skipWhitespace(this->json);
+        if (*p == '\0')
+            return JsonParseStatus::PARSE_EXPECT_VALUE;
+        *v = LazyValue(this, p);
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    /**
+     * 跳过一个字符串，只检查引号是否闭合以及是否含有控制字符，不解码转义
+     * @param p 指向开头的 '"'
+     * @param end 成功时存储结尾的 '"' 之后的位置
+     */
+    static JsonParseStatus skipString(const char* p, const char** end) {
+        ++p;
+        while (true) {
+            p = scanStringSpecial(p);
+            const char ch = *p++;
+            if (ch == '\"') {
+                *end = p;
+                return JsonParseStatus::PARSE_OK;
+            }
+            if (ch == '\\') {
+                if (*p == '\0')
+                    return JsonParseStatus::PARSE_MISS_QUOTATION_MARK;
+                ++p;
+            } else if (ch == '\0') {
+                return JsonParseStatus::PARSE_MISS_QUOTATION_MARK;
+            } else {
+                return JsonParseStatus::PARSE_INVALID_STRING_CHAR;
+            }
+        }
+    }
+
+    JsonParseStatus LazyDocument::skipValue(const char* p, const char** end) {
+        if (*p == '\"')
+            return skipString(p, end);
+        if (*p != '[' && *p != '{') {
+            // 标量直接按语法规则解析，数字与字面量的解析不会分配内存
+            FieldValue scalar;
+            this->context.json = p;
+            const auto retStatus = parseValue(&this->context, &scalar);
+            if (retStatus == JsonParseStatus::PARSE_OK)
+                *end = this->context.json;
+            return retStatus;
+        }
+        // 容器只检查括号的配对，字符串整段跳过，其余字节不做校验
+        this->brackets.clear();
+        while (true) {
+            switch (*p) {
+                case '\"': {
+                    const auto retStatus = skipString(p, &p);
+                    if (retStatus != JsonParseStatus::PARSE_OK)
+                        return retStatus;
+                    continue;
+                }
+                case '[':
+                case '{':
+                    this->brackets.push_back(*p);
+                    break;
+                case ']':
+                    if (this->brackets.back() != '[')
+                        return JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                    this->brackets.pop_back();
+                    break;
+                case '}':
+                    if (this->brackets.back() != '{')
+                        return JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                    this->brackets.pop_back();
+                    break;
+                case '\0':
+                    return this->brackets.back() == '['
+                           ? JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET
+                           : JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                default:
+                    break;
+            }
+            ++p;
+            if (this->brackets.empty()) {
+                *end = p;
+                return JsonParseStatus::PARSE_OK;
+            }
+        }
+    }
+
+    ParseContext* LazyValue::seek() const {
+        assert(exists());
+        ParseContext* c = &this->doc->context;
+        c->json = this->pos;
+        c->strBuf.clear();
+        return c;
+    }
+
+    JsonFieldType LazyValue::getType() const {
+        assert(exists());
+        switch (*this->pos) {
+            case 't':   return JsonFieldType::J_TRUE;
+            case 'f':   return JsonFieldType::J_FALSE;
+            case '\"':  return JsonFieldType::J_STRING;
+            case '[':   return JsonFieldType::J_ARRAY;
+            case '{':   return JsonFieldType::J_OBJECT;
+            case '-':
+            case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9': {
+                FieldValue n;
+                if (parseNumber(seek(), &n) == JsonParseStatus::PARSE_OK)
+                    return n.getType();
+                return JsonFieldType::J_NUMBER;
+            }
+            default:    return JsonFieldType::J_NULL;
+        }
+    }
+
+    /**
+     * @return 首字符是否可能开始一个数字，其余的值在取数字时报告 PARSE_TYPE_MISMATCH
+     */
+    static bool startsNumber(char ch) {
+        return ch == '-' || (ch >= '0' && ch <= '9');
+    }
+
+    JsonParseStatus LazyValue::getBool(bool* b) const {
+        if (*this->pos != 't' && *this->pos != 'f')
+            return JsonParseStatus::PARSE_TYPE_MISMATCH;
+        FieldValue v;
+        const auto retStatus = parseValue(seek(), &v);
+        if (retStatus == JsonParseStatus::PARSE_OK)
+            *b = v.getType() == JsonFieldType::J_TRUE;
+        return retStatus;
+    }
+
+    JsonParseStatus LazyValue::isNull(bool* null) const {
+        *null = false;
+        if (*this->pos != 'n')
+            return JsonParseStatus::PARSE_OK;
+        FieldValue v;
+        const auto retStatus = parseValue(seek(), &v);
+        if (retStatus == JsonParseStatus::PARSE_OK)
+            *null = true;
+        return retStatus;
+    }
+
+    JsonParseStatus LazyValue::getNumber(double* n) const {
+        if (!startsNumber(*this->pos))
+            return JsonParseStatus::PARSE_TYPE_MISMATCH;
+        FieldValue v;
+        const auto retStatus = parseNumber(seek(), &v);
+        if (retStatus == JsonParseStatus::PARSE_OK)
+            *n = v.getNumber();
+        return retStatus;
+    }
+
+    JsonParseStatus LazyValue::getInt64(int64_t* i) const {
+        if (!startsNumber(*this->pos))
+            return JsonParseStatus::PARSE_TYPE_MISMATCH;
+        FieldValue v;
+        const auto retStatus = parseNumber(seek(), &v);
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            return retStatus;
+        // 小数与超出 int64_t 的整数不能无损地转换
+        if (v.getType() != JsonFieldType::J_INT64)
+            return JsonParseStatus::PARSE_TYPE_MISMATCH;
+        *i = v.getInt64();
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    JsonParseStatus LazyValue::getUint64(uint64_t* u) const {
+        if (!startsNumber(*this->pos))
+            return JsonParseStatus::PARSE_TYPE_MISMATCH;
+        FieldValue v;
+        const auto retStatus = parseNumber(seek(), &v);
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            return retStatus;
+        // 不超过 int64_t 的整数解析为 J_INT64，非负时同样可以取出
+        if (v.getType() == JsonFieldType::J_UINT64)
+            *u = v.getUint64();
+        else if (v.getType() == JsonFieldType::J_INT64 && v.getInt64() >= 0)
+            *u = static_cast<uint64_t>(v.getInt64());
+        else
+            return JsonParseStatus::PARSE_TYPE_MISMATCH;
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    JsonParseStatus LazyValue::getString(const char** s, size_t* len) const {
+        if (*this->pos != '\"')
+            return JsonParseStatus::PARSE_TYPE_MISMATCH;
+        return decodeStringRaw(seek(), s, len);
+    }
+
+    JsonParseStatus LazyValue::getString(std::string* s) const {
+        const char* str = nullptr;
+        size_t len = 0;
+        const auto retStatus = getString(&str, &len);
+        if (retStatus == JsonParseStatus::PARSE_OK)
+            s->assign(str, len);
+        return retStatus;
+    }
+
+    JsonParseStatus LazyValue::getArray(LazyArray* array) const {
+        if (*this->pos != '[')
+            return JsonParseStatus::PARSE_TYPE_MISMATCH;
+        *array = LazyArray();
+        array->doc = this->doc;
+        array->cur = this->pos + 1;
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    JsonParseStatus LazyValue::getObject(LazyObject* obj) const {
+        if (*this->pos != '{')
+            return JsonParseStatus::PARSE_TYPE_MISMATCH;
+        *obj = LazyObject();
+        obj->doc = this->doc;
+        obj->begin = obj->cur = this->pos + 1;
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    JsonParseStatus LazyValue::parse(FieldValue* v) const {
+        v->freeSpace();
+        v->setBorrowed(false);
+        return parseValue(seek(), v);
+    }
+
+    bool LazyArray::next(LazyValue* v) {
+        if (this->done)
+            return false;
+        const char* p = this->cur;
+        if (this->pending != nullptr) {
+            this->status = this->doc->skipValue(this->pending, &p);
+            this->pending = nullptr;
+            if (this->status != JsonParseStatus::PARSE_OK) {
+                this->done = true;
+                return false;
+            }
+        }
+        p = skipWhitespace(p);
+        if (*p == ']') {
+            this->done = true;
+            return false;
+        }
+        if (!this->first) {
+            if (*p != ',') {
+                this->status = JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                this->done = true;
+                return false;
+            }
+            p = skipWhitespace(p + 1);
+        }
+        this->first = false;
+        if (*p == '\0') {
+            this->status = JsonParseStatus::PARSE_EXPECT_VALUE;
+            this->done = true;
+            return false;
+        }
+        *v = LazyValue(this->doc, p);
+        this->pending = this->cur = p;
+        return true;
+    }
+
+    bool LazyObject::next(const char** key, size_t* len, LazyValue* v) {
+        if (this->done)
+            return false;
+        const char* p = this->cur;
+        if (this->pending != nullptr) {
+            this->status = this->doc->skipValue(this->pending, &p);
+            this->pending = nullptr;
+            if (this->status != JsonParseStatus::PARSE_OK) {
+                this->done = true;
+                return false;
+            }
+        }
+        p = skipWhitespace(p);
+        if (*p == '}') {
+            this->done = true;
+            return false;
+        }
+        if (!this->first) {
+            if (*p != ',') {
+                this->status = JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                this->done = true;
+                return false;
+            }
+            p = skipWhitespace(p + 1);
+        }
+        this->first = false;
+        if (*p != '\"') {
+            this->status = JsonParseStatus::PARSE_MISS_KEY;
+            this->done = true;
+            return false;
+        }
+        ParseContext* c = &this->doc->context;
+        c->json = p;
+        c->strBuf.clear();
+        this->status = decodeStringRaw(c, key, len);
+        if (this->status != JsonParseStatus::PARSE_OK) {
+            this->done = true;
+            return false;
+        }
+        p = skipWhitespace(c->json);
+        if (*p != ':') {
+            this->status = JsonParseStatus::PARSE_MISS_COLON;
+            this->done = true;
+            return false;
+        }
+        p = skipWhitespace(p + 1);
+        if (*p == '\0') {
+            this->status = JsonParseStatus::PARSE_EXPECT_VALUE;
+            this->done = true;
+            return false;
+        }
+        *v = LazyValue(this->doc, p);
+        this->pending = this->cur = p;
+        return true;
+    }
+
+    JsonParseStatus LazyObject::findField(const char* key, size_t len, LazyValue* v) const {
+        LazyObject it;
+        it.doc = this->doc;
+        it.begin = it.cur = this->begin;
+        const char* k = nullptr;
+        size_t n = 0;
+        LazyValue value;
+        while (it.next(&k, &n, &value)) {
+            if (n == len && memcmp(k, key, len) == 0) {
+                *v = value;
+                return JsonParseStatus::PARSE_OK;
+            }
+        }
+        *v = LazyValue();
+        return it.status;
+    }
+}
@@ -0,0 +1,199 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#pragma once
+
+#include <vector>
+#include "fairy_json.h"
+
+namespace fairy {
+
+    class LazyDocument;
+    class LazyArray;
+    class LazyObject;
+
+    /**
+     * 按需解析中的一个值，只记录它在输入中的位置，访问时才解析
+     * 取值时类型不符（包括小数或超出范围的数字按整数读取）返回 PARSE_TYPE_MISMATCH，输出参数保持不变
+     */
+    class LazyValue {
+    public:
+        LazyValue() = default;
+
+        /**
+         * @return 是否指向一个值；findField 没有找到时为 false
+         */
+        bool exists() const {
+            return this->pos != nullptr;
+        }
+
+        /**
+         * 根据首字符判断类型，数字会被解析一次以区分 J_INT64、J_UINT64 与 J_NUMBER
+         * @return 值的类型，首字符不合法时返回 J_NULL，之后的取值操作会给出具体的错误
+         */
+        JsonFieldType getType() const;
+
+        JsonParseStatus getBool(bool* b) const;
+
+        JsonParseStatus isNull(bool* null) const;
+
+        /**
+         * 取数字的值，整数类型会被转换成 double
+         */
+        JsonParseStatus getNumber(double* n) const;
+
+        JsonParseStatus getInt64(int64_t* i) const;
+
+        JsonParseStatus getUint64(uint64_t* u) const;
+
+        /**
+         * 解码字符串，不分配内存
+         * 结果指向输入或文档内部的缓冲区，不以 '\0' 结尾，在同一文档的下一次访问之前有效
+         * @param s 解码结果的起始位置
+         * @param len 解码结果的长度
+         */
+        JsonParseStatus getString(const char** s, size_t* len) const;
+
+        JsonParseStatus getString(std::string* s) const;
+
+        JsonParseStatus getArray(LazyArray* array) const;
+
+        JsonParseStatus getObject(LazyObject* obj) const;
+
+        /**
+         * 把这个值完整地解析成 FieldValue 树，与 json_parse 的结果相同
+         * @param v 解析结果，原有的值会先被释放
+         */
+        JsonParseStatus parse(FieldValue* v) const;
+
+    private:
+        friend class LazyDocument;
+        friend class LazyArray;
+        friend class LazyObject;
+
+        LazyValue(LazyDocument* doc, const char* pos) :
+            doc(doc), pos(pos)
+        {}
+
+        /**
+         * 把 doc 的解析上下文定位到本值的开头
+         */
+        ParseContext* seek() const;
+
+        LazyDocument* doc = nullptr;
+        const char* pos = nullptr;  // 值的第一个字符
+    };
+
+    /**
+     * 数组上的只进游标，依次给出每个元素，跳过未访问的元素时只做括号与引号的配对检查
+     */
+    class LazyArray {
+    public:
+        LazyArray() = default;
+
+        /**
+         * 移动到下一个元素
+         * @param v 下一个元素
+         * @return 存在下一个元素时返回 true；到达末尾或出错时返回 false，此时由 getStatus() 给出原因
+         */
+        bool next(LazyValue* v);
+
+        /**
+         * @return PARSE_OK 表示正常结束或尚未结束，否则为遇到的错误
+         */
+        JsonParseStatus getStatus() const {
+            return this->status;
+        }
+
+    private:
+        friend class LazyValue;
+
+        LazyDocument* doc = nullptr;
+        const char* cur = nullptr;         // 下一次扫描的起点
+        const char* pending = nullptr;     // 上一次给出的、尚未跳过的元素
+        bool first = true;
+        bool done = false;
+        JsonParseStatus status = JsonParseStatus::PARSE_OK;
+    };
+
+    /**
+     * 对象上的只进游标，按文档中的顺序依次给出每个成员
+     */
+    class LazyObject {
+    public:
+        LazyObject() = default;
+
+        /**
+         * 移动到下一个成员
+         * @param key 解码后的键，不以 '\0' 结尾，在同一文档的下一次访问之前有效
+         * @param len 键的长度
+         * @param v 成员的值
+         * @return 存在下一个成员时返回 true；到达末尾或出错时返回 false，此时由 getStatus() 给出原因
+         */
+        bool next(const char** key, size_t* len, LazyValue* v);
+
+        /**
+         * 从对象开头查找键，不影响 next 的位置；存在重复的键时返回第一个
+         * @param key 要查找的键
+         * @param len 键的长度
+         * @param v 找到的值，没有找到时 v->exists() 为 false
+         */
+        JsonParseStatus findField(const char* key, size_t len, LazyValue* v) const;
+
+        JsonParseStatus findField(const char* key, LazyValue* v) const {
+            return findField(key, strlen(key), v);
+        }
+
+        JsonParseStatus getStatus() const {
+            return this->status;
+        }
+
+    private:
+        friend class LazyValue;
+
+        LazyDocument* doc = nullptr;
+        const char* begin = nullptr;       // '{' 之后的位置
+        const char* cur = nullptr;
+        const char* pending = nullptr;
+        bool first = true;
+        bool done = false;
+        JsonParseStatus status = JsonParseStatus::PARSE_OK;
+    };
+
+    /**
+     * 按需解析的文档，不建立 FieldValue 树，只在访问时解析用到的部分
+     * 输入必须以 '\0' 结尾，并且比文档以及从它得到的所有游标活得更久。
+     * 只访问一部分值时不会扫描文档的其余部分，因此根之后多余的内容不会被报告为 PARSE_ROOT_NOT_SINGULAR。
+     * 文档不是线程安全的，从同一个文档得到的游标只能在一个线程中使用
+     */
+    class LazyDocument {
+    public:
+        explicit LazyDocument(const char* json);
+
+        LazyDocument(const LazyDocument&) = delete;
+        LazyDocument& operator=(const LazyDocument&) = delete;
+
+        /**
+         * @param v 根元素
+         * @return 输入只有空白时返回 PARSE_EXPECT_VALUE
+         */
+        JsonParseStatus getRoot(LazyValue* v);
+
+    private:
+        friend class LazyValue;
+        friend class LazyArray;
+        friend class LazyObject;
+
+        /**
+         * 跳过从 p 开始的一个值
+         * @param p 值的第一个字符
+         * @param end 成功时存储值之后的位置
+         */
+        JsonParseStatus skipValue(const char* p, const char** end);
+
+        const char* json;
+        ParseContext context;
+        std::vector<char> brackets;  // skipValue 中尚未闭合的括号
+    };
+}
@@ -0,0 +1,91 @@
+//
+// Created by yubin on 2021/5/16.
+//
+
+#include "mapped_file.h"
+#include <cstdio>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define FAIRY_JSON_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fairy {
+
+#if defined(FAIRY_JSON_HAS_MMAP)
+    bool MappedFile::open(const char* path) {
+        close();
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            ::close(fd);
+            return false;
+        }
+        const size_t len = static_cast<size_t>(st.st_size);
+        const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        // 先占住文件向上取整到页之后再多一页的匿名映射，再把文件映射到它的开头：
+        // 文件最后一页中超出文件长度的部分由内核补 0，之后的匿名页也全是 0；
+        // 长度恰好是页的整数倍时文件的最后一页没有空余，也要靠多出的这一页补上结尾的 '\0'
+        const size_t mapped = (len + pageSize - 1) / pageSize * pageSize + pageSize;
+        void* base = mmap(nullptr, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        if (len != 0) {
+            void* file = mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+            if (file == MAP_FAILED) {
+                munmap(base, mapped);
+                ::close(fd);
+                return false;
+            }
+            // 解析按顺序访问整个文件，提示内核积极地预读
+            madvise(base, len, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+        this->begin = static_cast<const char*>(base);
+        this->length = len;
+        this->mappedLength = mapped;
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (this->mappedLength != 0)
+            munmap(const_cast<char*>(this->begin), this->mappedLength);
+        this->begin = nullptr;
+        this->length = this->mappedLength = 0;
+    }
+#else
+    bool MappedFile::open(const char* path) {
+        close();
+        FILE* fp = fopen(path, "rb");
+        if (fp == nullptr)
+            return false;
+        char buf[1 << 16];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) != 0)
+            this->fallback.append(buf, n);
+        const bool ok = ferror(fp) == 0;
+        fclose(fp);
+        if (!ok) {
+            this->fallback.clear();
+            return false;
+        }
+        this->begin = this->fallback.c_str();
+        this->length = this->fallback.size();
+        return true;
+    }
+
+    void MappedFile::close() {
+        this->fallback.clear();
+        this->fallback.shrink_to_fit();
+        this->begin = nullptr;
+        this->length = 0;
+    }
+#endif
+}
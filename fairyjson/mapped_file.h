@@ -0,0 +1,54 @@
+//
+// Created by yubin on 2021/5/16.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace fairy {
+
+    /**
+     * 文件的只读内存映射，映射之后紧跟着至少一个全 0 的页
+     * 因此内容总是以 '\0' 结尾，按对齐地址读取的 SIMD 扫描在末尾也不会越过已映射的内存。
+     * 不支持 mmap 的平台上退回为把整个文件读进内存
+     */
+    class MappedFile {
+    public:
+        MappedFile() = default;
+
+        ~MappedFile() {
+            close();
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /**
+         * 映射文件，原有的映射会先被解除
+         * @param path 文件路径
+         * @return 成功时返回 true
+         */
+        bool open(const char* path);
+
+        void close();
+
+        /**
+         * @return 以 '\0' 结尾的文件内容，没有打开文件时返回 nullptr
+         */
+        const char* data() const {
+            return this->begin;
+        }
+
+        size_t size() const {
+            return this->length;
+        }
+
+    private:
+        const char* begin = nullptr;
+        size_t length = 0;
+        size_t mappedLength = 0;  // 包括末尾补 0 的页
+        std::string fallback;     // 不使用 mmap 时存放文件内容
+    };
+}
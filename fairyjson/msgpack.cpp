@@ -0,0 +1,375 @@
+//
+// Created by yubin on 2021/5/17.
+//
+
+#include "msgpack.h"
+#include <cassert>
+#include <cstring>
+#include "utils.h"
+
+namespace fairy {
+
+    /**
+     * 追加一个类型字节以及之后 bytes 个字节的大端整数
+     */
+    static void putTagged(std::string* out, uint8_t tag, uint64_t x, int bytes) {
+        char buf[9];
+        buf[0] = static_cast<char>(tag);
+        for (int i = bytes; i > 0; --i) {
+            buf[i] = static_cast<char>(x & 0xff);
+            x >>= 8;
+        }
+        out->append(buf, bytes + 1);
+    }
+
+    static void encodeUint(std::string* out, uint64_t u) {
+        if (u < 0x80)
+            out->push_back(static_cast<char>(u));
+        else if (u <= 0xff)
+            putTagged(out, 0xcc, u, 1);
+        else if (u <= 0xffff)
+            putTagged(out, 0xcd, u, 2);
+        else if (u <= 0xffffffff)
+            putTagged(out, 0xce, u, 4);
+        else
+            putTagged(out, 0xcf, u, 8);
+    }
+
+    static void encodeInt(std::string* out, int64_t i) {
+        if (i >= 0)
+            encodeUint(out, static_cast<uint64_t>(i));
+        else if (i >= -32)
+            out->push_back(static_cast<char>(i));  // negative fixint
+        else if (i >= INT8_MIN)
+            putTagged(out, 0xd0, static_cast<uint64_t>(i), 1);
+        else if (i >= INT16_MIN)
+            putTagged(out, 0xd1, static_cast<uint64_t>(i), 2);
+        else if (i >= INT32_MIN)
+            putTagged(out, 0xd2, static_cast<uint64_t>(i), 4);
+        else
+            putTagged(out, 0xd3, static_cast<uint64_t>(i), 8);
+    }
+
+    static void encodeStr(std::string* out, const char* s, size_t len) {
+        if (len <= 31)
+            out->push_back(static_cast<char>(0xa0 | len));
+        else if (len <= 0xff)
+            putTagged(out, 0xd9, len, 1);
+        else if (len <= 0xffff)
+            putTagged(out, 0xda, len, 2);
+        else
+            putTagged(out, 0xdb, len, 4);
+        out->append(s, len);
+    }
+
+    /**
+     * 数组与 map 的头部
+     * @param fix fixarray 或 fixmap 的类型字节，16 位与 32 位格式的类型字节为 tag16 与 tag16 + 1
+     */
+    static void encodeContainer(std::string* out, size_t n, uint8_t fix, uint8_t tag16) {
+        if (n <= 15)
+            out->push_back(static_cast<char>(fix | n));
+        else if (n <= 0xffff)
+            putTagged(out, tag16, n, 2);
+        else
+            putTagged(out, tag16 + 1, n, 4);
+    }
+
+    static void encodeValue(const FieldValue* v, std::string* out) {
+        switch (v->getType()) {
+            case JsonFieldType::J_NULL:
+                out->push_back(static_cast<char>(0xc0));
+                break;
+            case JsonFieldType::J_FALSE:
+                out->push_back(static_cast<char>(0xc2));
+                break;
+            case JsonFieldType::J_TRUE:
+                out->push_back(static_cast<char>(0xc3));
+                break;
+            case JsonFieldType::J_NUMBER: {
+                const double n = v->getNumber();
+                uint64_t bits = 0;
+                memcpy(&bits, &n, sizeof(bits));
+                putTagged(out, 0xcb, bits, 8);
+                break;
+            }
+            case JsonFieldType::J_INT64:
+                encodeInt(out, v->getInt64());
+                break;
+            case JsonFieldType::J_UINT64:
+                encodeUint(out, v->getUint64());
+                break;
+            case JsonFieldType::J_STRING:
+                encodeStr(out, v->getJStr()->s, v->getJStr()->len);
+                break;
+            case JsonFieldType::J_ARRAY:
+                encodeContainer(out, v->getArray()->size(), 0x90, 0xdc);
+                for (auto& e : *v->getArray())
+                    encodeValue(&e, out);
+                break;
+            case JsonFieldType::J_OBJECT:
+                encodeContainer(out, v->getObj()->size(), 0x80, 0xde);
+                for (auto& member : *v->getObj()) {
+                    encodeStr(out, member.first.s, member.first.len);
+                    encodeValue(&member.second, out);
+                }
+                break;
+        }
+    }
+
+    void msgpackEncode(const FieldValue* v, std::string* out) {
+        assert(v != nullptr && out != nullptr);
+        encodeValue(v, out);
+    }
+
+    std::string msgpackEncode(const FieldValue* v) {
+        std::string out;
+        msgpackEncode(v, &out);
+        return out;
+    }
+
+    /**
+     * 从 c->json 处读取 bytes 个字节的大端整数
+     * @return 输入不够时返回 false
+     */
+    static bool readBig(ParseContext* c, int bytes, uint64_t* x) {
+        if (c->end - c->json < bytes)
+            return false;
+        const auto* p = reinterpret_cast<const unsigned char*>(c->json);
+        uint64_t r = 0;
+        for (int i = 0; i < bytes; ++i)
+            r = (r << 8) | p[i];
+        c->json += bytes;
+        *x = r;
+        return true;
+    }
+
+    /**
+     * 读取 str 格式的内容并拷贝出来，存在 Arena 时从 Arena 中分配
+     * @param len 内容的长度，来自类型字节或长度字段
+     */
+    static JsonParseStatus readStr(ParseContext* c, uint64_t len, char** s) {
+        if (static_cast<uint64_t>(c->end - c->json) < len)
+            return JsonParseStatus::PARSE_INVALID_BINARY;
+        *s = copyStr(c->json, len, c->arena);
+        c->json += len;
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    /**
+     * 读取 map 的键，只接受 fixstr、str8、str16 与 str32
+     */
+    static JsonParseStatus decodeKey(ParseContext* c, char** s, size_t* len) {
+        if (c->json == c->end)
+            return JsonParseStatus::PARSE_INVALID_BINARY;
+        const auto tag = static_cast<uint8_t>(*c->json++);
+        uint64_t n = 0;
+        if ((tag & 0xe0) == 0xa0)
+            n = tag & 0x1f;
+        else if (tag < 0xd9 || tag > 0xdb || !readBig(c, 1 << (tag - 0xd9), &n))
+            return JsonParseStatus::PARSE_INVALID_BINARY;
+        *len = n;
+        return readStr(c, n, s);
+    }
+
+    static JsonParseStatus decodeValue(ParseContext* c, FieldValue* v);
+
+    /**
+     * 解码 n 个元素的数组，数组按 n 一次分配好，元素直接解码到其中
+     * 容器在解码元素之前就放进 v，出错时由调用者连同已经解码的部分一起释放
+     */
+    static JsonParseStatus decodeArray(ParseContext* c, uint64_t n, FieldValue* v) {
+        // 每个元素至少占一个字节，长度字段不可信时不按它分配
+        if (n > static_cast<uint64_t>(c->end - c->json))
+            return JsonParseStatus::PARSE_INVALID_BINARY;
+        if (c->depth >= c->maxDepth)
+            return JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+        FieldArray* array = newArray(c);
+        array->resize(n);
+        v->setType(JsonFieldType::J_ARRAY);
+        v->setArray(array);
+        v->setBorrowed(c->arena != nullptr);
+        ++c->depth;
+        JsonParseStatus retStatus = JsonParseStatus::PARSE_OK;
+        for (auto& e : *array) {
+            retStatus = decodeValue(c, &e);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                break;
+        }
+        --c->depth;
+        return retStatus;
+    }
+
+    static JsonParseStatus decodeMap(ParseContext* c, uint64_t n, FieldValue* v) {
+        // 每个成员至少占两个字节
+        if (n > static_cast<uint64_t>(c->end - c->json) / 2)
+            return JsonParseStatus::PARSE_INVALID_BINARY;
+        if (c->depth >= c->maxDepth)
+            return JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+        FieldObject* obj = newObject(c);
+        obj->reserve(n);
+        v->setType(JsonFieldType::J_OBJECT);
+        v->setObj(obj);
+        v->setBorrowed(c->arena != nullptr);
+        ++c->depth;
+        JsonParseStatus retStatus = JsonParseStatus::PARSE_OK;
+        for (uint64_t i = 0; i < n; ++i) {
+            char* key = nullptr;
+            size_t len = 0;
+            retStatus = decodeKey(c, &key, &len);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                break;
+            FieldValue member;
+            retStatus = decodeValue(c, &member);
+            if (retStatus != JsonParseStatus::PARSE_OK) {
+                if (c->arena == nullptr)
+                    delete[] key;
+                break;
+            }
+            obj->append({key, len}, std::move(member));
+        }
+        --c->depth;
+        return retStatus;
+    }
+
+    static void setUnsigned(FieldValue* v, uint64_t u) {
+        // 与 json_parse 一致：能用 int64_t 表示的整数都是 J_INT64
+        if (u <= static_cast<uint64_t>(INT64_MAX)) {
+            v->setType(JsonFieldType::J_INT64);
+            v->setInt64(static_cast<int64_t>(u));
+        } else {
+            v->setType(JsonFieldType::J_UINT64);
+            v->setUint64(u);
+        }
+    }
+
+    static JsonParseStatus decodeValue(ParseContext* c, FieldValue* v) {
+        if (c->json == c->end)
+            return JsonParseStatus::PARSE_INVALID_BINARY;
+        const auto tag = static_cast<uint8_t>(*c->json++);
+        if (tag < 0x80) {
+            setUnsigned(v, tag);
+            return JsonParseStatus::PARSE_OK;
+        }
+        if (tag >= 0xe0) {
+            v->setType(JsonFieldType::J_INT64);
+            v->setInt64(static_cast<int8_t>(tag));
+            return JsonParseStatus::PARSE_OK;
+        }
+        if (tag < 0x90)
+            return decodeMap(c, tag & 0x0f, v);
+        if (tag < 0xa0)
+            return decodeArray(c, tag & 0x0f, v);
+        uint64_t x = 0;
+        if (tag < 0xc0) {
+            x = tag & 0x1f;
+        } else {
+            // 定长部分的字节数：c0 之后依次是 nil、(未使用)、false、true、bin8..ext32、float32、float64、uint8..uint64、int8..int64……
+            static const int8_t LENGTH_BYTES[0x20] = {
+                0, -1, 0, 0, -1, -1, -1, -1, -1, -1, 4, 8, 1, 2, 4, 8,
+                1, 2, 4, 8, -1, -1, -1, -1, -1, 1, 2, 4, 2, 4, 2, 4
+            };
+            const int bytes = LENGTH_BYTES[tag - 0xc0];
+            if (bytes < 0 || !readBig(c, bytes, &x))
+                return JsonParseStatus::PARSE_INVALID_BINARY;
+        }
+        switch (tag) {
+            case 0xc0:
+                v->setType(JsonFieldType::J_NULL);
+                return JsonParseStatus::PARSE_OK;
+            case 0xc2:
+                v->setType(JsonFieldType::J_FALSE);
+                return JsonParseStatus::PARSE_OK;
+            case 0xc3:
+                v->setType(JsonFieldType::J_TRUE);
+                return JsonParseStatus::PARSE_OK;
+            case 0xca: {
+                const auto bits = static_cast<uint32_t>(x);
+                float f = 0;
+                memcpy(&f, &bits, sizeof(f));
+                v->setType(JsonFieldType::J_NUMBER);
+                v->setNumber(f);
+                return JsonParseStatus::PARSE_OK;
+            }
+            case 0xcb: {
+                double n = 0;
+                memcpy(&n, &x, sizeof(n));
+                v->setType(JsonFieldType::J_NUMBER);
+                v->setNumber(n);
+                return JsonParseStatus::PARSE_OK;
+            }
+            case 0xcc: case 0xcd: case 0xce: case 0xcf:
+                setUnsigned(v, x);
+                return JsonParseStatus::PARSE_OK;
+            case 0xd0:
+                v->setType(JsonFieldType::J_INT64);
+                v->setInt64(static_cast<int8_t>(x));
+                return JsonParseStatus::PARSE_OK;
+            case 0xd1:
+                v->setType(JsonFieldType::J_INT64);
+                v->setInt64(static_cast<int16_t>(x));
+                return JsonParseStatus::PARSE_OK;
+            case 0xd2:
+                v->setType(JsonFieldType::J_INT64);
+                v->setInt64(static_cast<int32_t>(x));
+                return JsonParseStatus::PARSE_OK;
+            case 0xd3:
+                v->setType(JsonFieldType::J_INT64);
+                v->setInt64(static_cast<int64_t>(x));
+                return JsonParseStatus::PARSE_OK;
+            case 0xdc: case 0xdd:
+                return decodeArray(c, x, v);
+            case 0xde: case 0xdf:
+                return decodeMap(c, x, v);
+            default: {
+                // fixstr 与 str8、str16、str32
+                char* s = nullptr;
+                const auto retStatus = readStr(c, x, &s);
+                if (retStatus == JsonParseStatus::PARSE_OK) {
+                    v->setType(JsonFieldType::J_STRING);
+                    v->setJStr(s, x);
+                    v->setBorrowed(c->arena != nullptr);
+                }
+                return retStatus;
+            }
+        }
+    }
+
+    /**
+     * 解码根元素，之后必须是输入的末尾
+     */
+    static JsonParseStatus decodeRoot(ParseContext* c, FieldValue* v) {
+        auto retStatus = decodeValue(c, v);
+        if (retStatus == JsonParseStatus::PARSE_OK && c->json != c->end)
+            retStatus = JsonParseStatus::PARSE_ROOT_NOT_SINGULAR;
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            v->freeSpace();
+        return retStatus;
+    }
+
+    JsonParseStatus msgpack_decode(FieldValue* v, const char* data, size_t len, const ParseOptions& options) {
+        if (v == nullptr || (data == nullptr && len != 0)) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        v->freeSpace();
+        v->setBorrowed(false);
+        ParseContext c;
+        c.json = data;
+        c.end = data + len;
+        c.maxDepth = options.depthLimit();
+        return decodeRoot(&c, v);
+    }
+
+    JsonParseStatus msgpack_decode(Document* doc, const char* data, size_t len, const ParseOptions& options) {
+        if (doc == nullptr || (data == nullptr && len != 0)) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        doc->clear();
+        ParseContext c;
+        c.json = data;
+        c.end = data + len;
+        c.maxDepth = options.depthLimit();
+        c.arena = doc->getArena();
+        return decodeRoot(&c, doc->getRoot());
+    }
+}
@@ -0,0 +1,51 @@
+//
+// Created by yubin on 2021/5/17.
+//
+
+#pragma once
+
+#include <string>
+#include "fairy_json.h"
+
+namespace fairy {
+
+    /**
+     * 将值编码成 MessagePack，结果追加到 out 的末尾
+     * 整数使用能容纳它的最短格式，J_NUMBER 使用 float64，字符串使用 str 格式，数组与对象使用带长度的 array 与 map 格式；
+     * 对象中成员的顺序与重复的键都原样保留
+     * @param v 要编码的值
+     * @param out 输出缓冲区
+     */
+    void msgpackEncode(const FieldValue* v, std::string* out);
+
+    std::string msgpackEncode(const FieldValue* v);
+
+    /**
+     * 解码 msgpackEncode 的结果，得到与编码前相同的 FieldValue 树
+     * 容器按头部记录的长度一次分配好，字符串一次拷贝，不需要扫描文本。
+     * 也接受其他编码器产生的 float32 以及非最短的整数格式；bin、ext 与非字符串的 map 键不受支持
+     * @param v 解码结果，原有的值会先被释放；失败时为 J_NULL
+     * @param data 输入的起始位置
+     * @param len 输入的长度
+     * @param options 解析选项，只有 maxDepth 起作用
+     * @return 输入被截断或含有不支持的格式时返回 PARSE_INVALID_BINARY，根之后还有多余的字节时返回 PARSE_ROOT_NOT_SINGULAR
+     */
+    JsonParseStatus msgpack_decode(FieldValue* v, const char* data, size_t len,
+                                   const ParseOptions& options = ParseOptions());
+
+    inline JsonParseStatus msgpack_decode(FieldValue* v, const std::string& data,
+                                          const ParseOptions& options = ParseOptions()) {
+        return msgpack_decode(v, data.data(), data.size(), options);
+    }
+
+    /**
+     * 解码到文档的 Arena 中，文档中原有的内容会先被丢弃；节点、字符串与键都从 Arena 中分配
+     */
+    JsonParseStatus msgpack_decode(Document* doc, const char* data, size_t len,
+                                   const ParseOptions& options = ParseOptions());
+
+    inline JsonParseStatus msgpack_decode(Document* doc, const std::string& data,
+                                          const ParseOptions& options = ParseOptions()) {
+        return msgpack_decode(doc, data.data(), data.size(), options);
+    }
+}
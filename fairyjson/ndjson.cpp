@@ -0,0 +1,74 @@
+//
+// Created by yubin on 2021/5/15.
+//
+
+#include "ndjson.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include "utils.h"
+#include "simd.h"
+
+namespace fairy {
+
+    /**
+     * 工作线程每次领取的记录数，记录较少时不启动额外的线程
+     */
+    static const size_t BATCH_SIZE = 64;
+
+    NdjsonParser::NdjsonParser(unsigned threads, const ParseOptions& options) :
+        options(options)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        // ParseContext 不可复制，直接构造出全部工作线程，避免 resize 搬迁元素
+        this->workers = std::vector<Worker>(threads);
+        for (auto& worker : this->workers) {
+            worker.context.keyPool = options.keyPool;
+            worker.context.maxDepth = options.depthLimit();
+        }
+    }
+
+    void NdjsonParser::parse(const char* data, size_t len, std::vector<NdjsonRecord>* records) {
+        records->clear();
+        this->lineEnds.clear();
+        const char* const end = data + len;
+        for (const char* p = data; p < end;) {
+            const char* nl = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (nl == nullptr)
+                nl = end;
+            const char* first = p;
+            while (first != nl && isWhitespace(*first))
+                ++first;
+            if (first != nl) {
+                records->emplace_back();
+                records->back().offset = p - data;
+                this->lineEnds.push_back(nl - data);
+            }
+            p = nl + 1;
+        }
+
+        parallelFor(this->workers.size(), records->size(), BATCH_SIZE, [&](size_t worker, size_t first, size_t last) {
+            parseRange(&this->workers[worker], data, records, first, last);
+        });
+    }
+
+    void NdjsonParser::parseRange(Worker* worker, const char* data, std::vector<NdjsonRecord>* records,
+                                  size_t begin, size_t end) {
+        ParseContext* c = &worker->context;
+        for (size_t i = begin; i < end; ++i) {
+            NdjsonRecord& record = (*records)[i];
+            // 记录之后是下一行，按有界的输入直接在原处解析，解析不会越过本行
+            c->json = data + record.offset;
+            c->end = data + this->lineEnds[i];
+            c->bounded = true;
+            c->strBuf.clear();
+            record.status = parseRoot(c, &record.value);
+        }
+    }
+
+    void json_parse_ndjson(const char* data, size_t len, std::vector<NdjsonRecord>* records, unsigned threads) {
+        NdjsonParser parser(threads);
+        parser.parse(data, len, records);
+    }
+}
@@ -0,0 +1,74 @@
+//
+// Created by yubin on 2021/5/15.
+//
+
+#pragma once
+
+#include <vector>
+#include "fairy_json.h"
+
+namespace fairy {
+
+    /**
+     * NDJSON 中一条记录的解析结果
+     */
+    struct NdjsonRecord {
+        FieldValue value;   // 解析结果，失败时为 J_NULL
+        JsonParseStatus status = JsonParseStatus::PARSE_OK;
+        size_t offset = 0;  // 记录在输入中的起始位置
+    };
+
+    /**
+     * NDJSON（JSON Lines）的多线程批量解析器
+     * 输入按 '\n' 切分成记录；json 字符串中不允许出现未转义的换行符，因此每个 '\n' 都在字符串之外。
+     * 只含空白的行被跳过，其余每一行都得到一条记录，记录按输入中的顺序排列。
+     * 记录直接在输入中按有界的范围解析，不做拷贝；每个工作线程使用自己的解析上下文，它在多次 parse 之间被保留
+     */
+    class NdjsonParser {
+    public:
+        /**
+         * @param threads 工作线程数，0 表示使用硬件支持的并发线程数
+         * @param options 解析选项，其中的 KeyPool 可以被所有工作线程共享
+         */
+        explicit NdjsonParser(unsigned threads = 0, const ParseOptions& options = ParseOptions());
+
+        NdjsonParser(const NdjsonParser&) = delete;
+        NdjsonParser& operator=(const NdjsonParser&) = delete;
+
+        /**
+         * 解析一段 NDJSON
+         * @param data 输入，不要求以 '\0' 结尾
+         * @param len 输入的长度
+         * @param records 解析结果，原有的记录连同其中的值被释放
+         */
+        void parse(const char* data, size_t len, std::vector<NdjsonRecord>* records);
+
+        unsigned getThreads() const {
+            return static_cast<unsigned>(this->workers.size());
+        }
+
+    private:
+        struct Worker {
+            ParseContext context;
+        };
+
+        /**
+         * 解析 [begin, end) 之间的记录
+         */
+        void parseRange(Worker* worker, const char* data, std::vector<NdjsonRecord>* records,
+                        size_t begin, size_t end);
+
+        std::vector<Worker> workers;
+        std::vector<size_t> lineEnds;  // 每条记录之后的 '\n' 或输入末尾的位置
+        ParseOptions options;
+    };
+
+    /**
+     * 用一个临时的 NdjsonParser 解析一段 NDJSON
+     * @param data 输入，不要求以 '\0' 结尾
+     * @param len 输入的长度
+     * @param records 按输入顺序排列的解析结果
+     * @param threads 工作线程数，0 表示使用硬件支持的并发线程数
+     */
+    void json_parse_ndjson(const char* data, size_t len, std::vector<NdjsonRecord>* records, unsigned threads = 0);
+}
@@ -0,0 +1,49 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#pragma once
+
+#include <cstdint>
+#include "fairy_json.h"
+
+namespace fairy {
+
+    /**
+     * 单遍解析一个 json 数字
+     * number = [ "-" ] int [ frac ] [ exp ]
+     * 校验语法的同时累加各位数字，不再调用 strtod 重新扫描：
+     * 不含小数部分和指数部分、且能用 64 位整数精确表示的数字存为 J_INT64 / J_UINT64（"-0" 除外），
+     * 其余的存为 J_NUMBER，依次尝试 Clinger 快速路径、Eisel-Lemire 算法，只有无法确定舍入方向时才走慢速路径。
+     * 整个过程与 locale 无关，也不会修改 errno
+     * @param json 数字的起始位置
+     * @param end 解析成功时存储数字之后的位置
+     * @param v 解析结果
+     * @return PARSE_OK、PARSE_INVALID_VALUE 或 PARSE_NUMBER_OVERFLOW
+     */
+    JsonParseStatus readNumber(const char* json, const char** end, FieldValue* v);
+
+    /**
+     * writeDouble / writeInt64 / writeUint64 所需的最小缓冲区大小
+     */
+    static const size_t NUMBER_BUFFER_SIZE = 32;
+
+    /**
+     * 把 double 格式化成能精确还原的最短（Grisu2）十进制表示，结果总能被 readNumber 逐位还原
+     * 整数值以 ".0" 结尾，以免再次解析时变成 J_INT64；
+     * 指数形式写作 "1e30"、"1.5e-7"，不输出多余的 "+" 和前导 0
+     * @param d 有限的 double
+     * @param buffer 至少 NUMBER_BUFFER_SIZE 字节的缓冲区，结果不以 '\0' 结尾
+     * @return 写入内容之后的位置
+     */
+    char* writeDouble(double d, char* buffer);
+
+    /**
+     * 把整数格式化成十进制
+     * @param buffer 至少 NUMBER_BUFFER_SIZE 字节的缓冲区，结果不以 '\0' 结尾
+     * @return 写入内容之后的位置
+     */
+    char* writeUint64(uint64_t u, char* buffer);
+
+    char* writeInt64(int64_t i, char* buffer);
+}
@@ -0,0 +1,132 @@
+//
+// Created by yubin on 2021/5/16.
+//
+
+#include "parallel.h"
+#include <memory>
+#include "structural.h"
+#include "utils.h"
+#include "simd.h"
+
+namespace fairy {
+
+    /**
+     * 每次扫描的字节数，必须是 64 的倍数
+     */
+    static const size_t SCAN_WINDOW = 1 << 20;
+
+    /**
+     * 每个线程每次领取的元素个数
+     */
+    static const size_t ELEMENT_BATCH = 256;
+
+    /**
+     * 顶层数组中一个元素的范围：从第一个字符到其后的 ',' 或 ']'
+     */
+    struct ElementRange {
+        size_t begin;
+        size_t end;
+    };
+
+    /**
+     * 在字符串之外找出顶层数组各元素的边界
+     * 只根据括号的层数切分，不检查语法；括号种类不匹配等错误留给元素的解析发现
+     * @return 顶层是一个数组并且之后没有多余的内容时返回 true
+     */
+    static bool findElements(const char* json, size_t len, std::vector<ElementRange>* elements) {
+        std::unique_ptr<uint32_t[]> positions(new uint32_t[SCAN_WINDOW + StructuralScanner::PADDING]);
+        StructuralScanner scanner;
+        size_t depth = 0;
+        bool closed = false;          // 顶层数组已经闭合
+        bool expectElement = false;   // 下一个结构字符是元素的开头
+        size_t elementBegin = 0;
+        for (size_t base = 0; base < len; base += SCAN_WINDOW) {
+            const size_t n = scanner.scan(json + base, std::min(SCAN_WINDOW, len - base), positions.get());
+            for (size_t i = 0; i < n; ++i) {
+                const size_t pos = base + positions[i];
+                const char ch = json[pos];
+                if (closed || (depth == 0 && ch != '['))
+                    return false;
+                if (expectElement) {
+                    expectElement = false;
+                    elementBegin = pos;
+                    if (ch == ']' && depth == 1) {
+                        // "[]" 中没有元素；"[1,]" 这样的错误交给 json_parse 报告
+                        if (!elements->empty())
+                            return false;
+                        depth = 0;
+                        closed = true;
+                        continue;
+                    }
+                }
+                switch (ch) {
+                    case '[':
+                    case '{':
+                        if (++depth == 1)
+                            expectElement = true;
+                        break;
+                    case ']':
+                    case '}':
+                        if (--depth == 0) {
+                            // 元素只检查自己的边界，根数组的闭合括号必须在这里核对，否则 "[1}" 会被接受
+                            if (ch != ']')
+                                return false;
+                            elements->push_back({elementBegin, pos});
+                            closed = true;
+                        }
+                        break;
+                    case ',':
+                        if (depth == 1) {
+                            elements->push_back({elementBegin, pos});
+                            expectElement = true;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+        return closed && !scanner.inString();
+    }
+
+    JsonParseStatus json_parse_parallel(FieldValue* v, const char* json, unsigned threads,
+                                        const ParseOptions& options) {
+        if (v == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        v->freeSpace();
+        v->setBorrowed(false);
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<ElementRange> elements;
+        if (threads > 1 && findElements(json, strlen(json), &elements)) {
+            FieldArray* array = new FieldArray(elements.size());
+            std::vector<ParseContext> contexts(threads);
+            std::atomic<bool> failed(false);
+            parallelFor(threads, elements.size(), ELEMENT_BATCH, [&](size_t worker, size_t first, size_t last) {
+                ParseContext* c = &contexts[worker];
+                c->keyPool = options.keyPool;
+                c->maxDepth = options.depthLimit();
+                c->depth = 1;  // 元素位于根数组之中
+                for (size_t i = first; i < last && !failed.load(std::memory_order_relaxed); ++i) {
+                    c->json = json + elements[i].begin;
+                    // 元素必须恰好在边界处结束
+                    if (parseValue(c, &(*array)[i]) != JsonParseStatus::PARSE_OK
+                        || skipWhitespace(c->json) != json + elements[i].end)
+                        failed.store(true, std::memory_order_relaxed);
+                }
+            });
+            v->setType(JsonFieldType::J_ARRAY);
+            v->setArray(array);
+            if (!failed.load())
+                return JsonParseStatus::PARSE_OK;
+            // 出错时重新顺序解析，得到与 json_parse 相同的错误状态
+            v->freeSpace();
+        }
+        ParseContext c;
+        c.json = json;
+        c.keyPool = options.keyPool;
+        c.maxDepth = options.depthLimit();
+        return parseRoot(&c, v);
+    }
+}
@@ -0,0 +1,24 @@
+//
+// Created by yubin on 2021/5/16.
+//
+
+#pragma once
+
+#include "fairy_json.h"
+
+namespace fairy {
+
+    /**
+     * 多线程解析一个顶层为数组的大文档
+     * 先分段扫描结构字符，在字符串之外找出顶层数组各元素的边界，再把元素分给多个线程分别解析，
+     * 结果按原来的顺序直接写入同一个数组。顶层不是数组、只有一个线程或者文档中存在错误时，
+     * 退回单线程的 json_parse，因此结果与错误状态都与 json_parse 相同
+     * @param v 解析结果，原有的值会先被释放
+     * @param json 以 '\0' 结尾的 json 字符串
+     * @param threads 工作线程数，0 表示使用硬件支持的并发线程数
+     * @param options 解析选项，其中的 KeyPool 被所有工作线程共享
+     * @return 解析结果状态
+     */
+    JsonParseStatus json_parse_parallel(FieldValue* v, const char* json, unsigned threads = 0,
+                                        const ParseOptions& options = ParseOptions());
+}
@@ -0,0 +1,248 @@
+//
+// Created by yubin on 2021/5/16.
+//
+
+#include "projection.h"
+#include <cstring>
+#include "utils.h"
+#include "simd.h"
+
+namespace fairy {
+
+    Projection::Projection() :
+        nodes(1)
+    {}
+
+    bool Projection::add(const char* path, size_t len) {
+        JsonPath compiled;
+        if (!compiled.compile(path, len))
+            return false;
+        insert(0, compiled.getSteps(), 0);
+        return true;
+    }
+
+    void Projection::insert(size_t node, const std::vector<PathStep>& steps, size_t i) {
+        if (this->nodes[node].whole)
+            return;
+        if (i == steps.size()) {
+            // 整个值都保留，之下的分支不再需要
+            Node& n = this->nodes[node];
+            n.whole = true;
+            n.members.clear();
+            n.elements.clear();
+            n.wildcard = 0;
+            return;
+        }
+        const PathStep& step = steps[i];
+        switch (step.kind) {
+            case PathStep::WILDCARD: {
+                if (this->nodes[node].wildcard == 0) {
+                    const size_t child = this->nodes.size();
+                    this->nodes.emplace_back();
+                    this->nodes[node].wildcard = child;
+                }
+                insert(this->nodes[node].wildcard, steps, i + 1);
+                // 已经指定的成员与元素同样匹配通配符；insert 可能使引用失效，每次都按下标重新取
+                for (size_t k = 0; k < this->nodes[node].members.size(); ++k)
+                    insert(this->nodes[node].members[k].second, steps, i + 1);
+                for (size_t k = 0; k < this->nodes[node].elements.size(); ++k)
+                    insert(this->nodes[node].elements[k].second, steps, i + 1);
+                break;
+            }
+            case PathStep::MEMBER:
+                insert(memberChild(node, step.key), steps, i + 1);
+                break;
+            case PathStep::ELEMENT:
+                insert(elementChild(node, step.index), steps, i + 1);
+                break;
+            case PathStep::TOKEN:
+                insert(memberChild(node, step.key), steps, i + 1);
+                if (step.index != PathStep::NO_INDEX)
+                    insert(elementChild(node, step.index), steps, i + 1);
+                break;
+        }
+    }
+
+    size_t Projection::memberChild(size_t node, const std::string& key) {
+        for (auto& member : this->nodes[node].members) {
+            if (member.first == key)
+                return member.second;
+        }
+        size_t child = 0;
+        if (this->nodes[node].wildcard != 0) {
+            child = clone(this->nodes[node].wildcard);
+        } else {
+            child = this->nodes.size();
+            this->nodes.emplace_back();
+        }
+        this->nodes[node].members.emplace_back(key, child);
+        return child;
+    }
+
+    size_t Projection::elementChild(size_t node, size_t index) {
+        for (auto& element : this->nodes[node].elements) {
+            if (element.first == index)
+                return element.second;
+        }
+        size_t child = 0;
+        if (this->nodes[node].wildcard != 0) {
+            child = clone(this->nodes[node].wildcard);
+        } else {
+            child = this->nodes.size();
+            this->nodes.emplace_back();
+        }
+        this->nodes[node].elements.emplace_back(index, child);
+        return child;
+    }
+
+    size_t Projection::clone(size_t node) {
+        const size_t copy = this->nodes.size();
+        Node n = this->nodes[node];
+        this->nodes.push_back(std::move(n));
+        for (size_t k = 0; k < this->nodes[copy].members.size(); ++k) {
+            const size_t child = clone(this->nodes[copy].members[k].second);
+            this->nodes[copy].members[k].second = child;
+        }
+        for (size_t k = 0; k < this->nodes[copy].elements.size(); ++k) {
+            const size_t child = clone(this->nodes[copy].elements[k].second);
+            this->nodes[copy].elements[k].second = child;
+        }
+        if (this->nodes[copy].wildcard != 0) {
+            const size_t child = clone(this->nodes[copy].wildcard);
+            this->nodes[copy].wildcard = child;
+        }
+        return copy;
+    }
+
+    JsonParseStatus Projection::parse(ParseContext* c, size_t node, FieldValue* v, std::string* open) const {
+        const Node& n = this->nodes[node];
+        if (n.whole)
+            return parseValue(c, v);
+        const char ch = *c->json;
+        if (ch != '[' && ch != '{') {
+            // 标量之下不会有选中的值
+            return skipValue(c, open);
+        }
+        if (c->depth >= c->maxDepth)
+            return JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+        ++c->depth;
+        const auto retStatus = ch == '[' ? parseArray(c, n, v, open) : parseObject(c, n, v, open);
+        --c->depth;
+        return retStatus;
+    }
+
+    JsonParseStatus Projection::parseObject(ParseContext* c, const Node& n, FieldValue* v, std::string* open) const {
+        FieldObject* obj = new FieldObject();
+        v->setType(JsonFieldType::J_OBJECT);
+        v->setObj(obj);
+        c->json = skipWhitespace(c->json + 1);
+        if (*c->json == '}') {
+            ++c->json;
+            return JsonParseStatus::PARSE_OK;
+        }
+        while (true) {
+            const char* key = nullptr;
+            size_t len = 0;
+            auto retStatus = readMemberKey(c, &key, &len);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            size_t child = n.wildcard;
+            for (auto& member : n.members) {
+                if (member.first.size() == len && memcmp(member.first.data(), key, len) == 0) {
+                    child = member.second;
+                    break;
+                }
+            }
+            if (child == 0) {
+                retStatus = skipValue(c, open);
+                if (retStatus != JsonParseStatus::PARSE_OK)
+                    return retStatus;
+            } else {
+                // 键在解析值之前复制出来，解析值时会复用 strBuf
+                char* keyStr = copyStr(key, len, nullptr);
+                FieldValue member;
+                retStatus = parse(c, child, &member, open);
+                if (retStatus != JsonParseStatus::PARSE_OK) {
+                    delete[] keyStr;
+                    return retStatus;
+                }
+                if (this->nodes[child].whole || member.getType() != JsonFieldType::J_NULL)
+                    obj->append({keyStr, len}, std::move(member));
+                else
+                    delete[] keyStr;
+            }
+            c->json = skipWhitespace(c->json);
+            if (*c->json == ',') {
+                c->json = skipWhitespace(c->json + 1);
+            } else if (*c->json == '}') {
+                ++c->json;
+                return JsonParseStatus::PARSE_OK;
+            } else {
+                return JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            }
+        }
+    }
+
+    JsonParseStatus Projection::parseArray(ParseContext* c, const Node& n, FieldValue* v, std::string* open) const {
+        FieldArray* array = new FieldArray();
+        v->setType(JsonFieldType::J_ARRAY);
+        v->setArray(array);
+        c->json = skipWhitespace(c->json + 1);
+        if (*c->json == ']') {
+            ++c->json;
+            return JsonParseStatus::PARSE_OK;
+        }
+        for (size_t i = 0; ; ++i) {
+            size_t child = n.wildcard;
+            for (auto& element : n.elements) {
+                if (element.first == i) {
+                    child = element.second;
+                    break;
+                }
+            }
+            JsonParseStatus retStatus;
+            if (child == 0) {
+                retStatus = skipValue(c, open);
+            } else {
+                FieldValue e;
+                retStatus = parse(c, child, &e, open);
+                if (retStatus == JsonParseStatus::PARSE_OK
+                    && (this->nodes[child].whole || e.getType() != JsonFieldType::J_NULL)) {
+                    // 之前没有选中的元素以 J_NULL 占位
+                    array->resize(i);
+                    array->push_back(std::move(e));
+                }
+            }
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            c->json = skipWhitespace(c->json);
+            if (*c->json == ',') {
+                c->json = skipWhitespace(c->json + 1);
+            } else if (*c->json == ']') {
+                ++c->json;
+                return JsonParseStatus::PARSE_OK;
+            } else {
+                return JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            }
+        }
+    }
+
+    JsonParseStatus json_parse(FieldValue* v, const char* json_str, const Projection& projection,
+                               const ParseOptions& options) {
+        if (v == nullptr || json_str == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        v->freeSpace();
+        v->setBorrowed(false);
+        ParseContext c;
+        c.json = skipWhitespace(json_str);
+        c.maxDepth = options.depthLimit();
+        std::string open;
+        auto retStatus = projection.parse(&c, 0, v, &open);
+        if (retStatus == JsonParseStatus::PARSE_OK && *skipWhitespace(c.json) != '\0')
+            retStatus = JsonParseStatus::PARSE_ROOT_NOT_SINGULAR;
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            v->freeSpace();
+        return retStatus;
+    }
+}
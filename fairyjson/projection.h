@@ -0,0 +1,92 @@
+//
+// Created by yubin on 2021/5/16.
+//
+
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#include "fairy_json.h"
+#include "json_path.h"
+
+namespace fairy {
+
+    class Projection;
+
+    /**
+     * 按投影解析 json，只建立投影中选中的部分，得到一棵稀疏的 FieldValue 树
+     * 没有选中的子树按完整的语法规则校验后跳过，其中的字符串、数组与对象都不会分配内存，
+     * 因此错误状态与 json_parse 相同。
+     * 对象只保留选中的成员；数组中没有选中的元素以 J_NULL 占位，使选中元素的下标不变，最后一个选中的元素之后不再保留；
+     * 路径要求继续向下、而文档中对应的值是标量时，这个值不会出现在结果中
+     * @param v 解析结果，原有的值会先被释放；失败时为 J_NULL
+     * @param json_str 以 '\0' 结尾的 json 字符串
+     * @param projection 要保留的路径
+     * @param options 解析选项，keyPool 不起作用
+     * @return 解析结果状态
+     */
+    JsonParseStatus json_parse(FieldValue* v, const char* json_str, const Projection& projection,
+                               const ParseOptions& options = ParseOptions());
+
+    /**
+     * 投影：一组要保留的路径，语法同 JsonPath::compile
+     * 路径合并成一棵确定的树，解析时对象的每个成员、数组的每个元素最多对应树中的一个分支；
+     * 编译一次后可以用于任意多份文档，多个线程可以同时使用同一个投影
+     */
+    class Projection {
+    public:
+        Projection();
+
+        /**
+         * 加入一条路径，路径所指的值整体保留，例如 "/user/name"、"$.items[*].id"
+         * @return 路径有语法错误时返回 false，投影不变
+         */
+        bool add(const char* path, size_t len);
+
+        bool add(const std::string& path) {
+            return add(path.data(), path.size());
+        }
+
+    private:
+        friend JsonParseStatus json_parse(FieldValue* v, const char* json_str, const Projection& projection,
+                                          const ParseOptions& options);
+
+        struct Node {
+            bool whole = false;                                  // 有路径在此结束，整个值都要保留
+            std::vector<std::pair<std::string, size_t>> members; // 指定的键与对应的子节点
+            std::vector<std::pair<size_t, size_t>> elements;     // 指定的下标与对应的子节点
+            size_t wildcard = 0;                                 // 其余成员与元素对应的子节点，0 表示不保留
+        };
+
+        /**
+         * 把 steps 中从第 i 步开始的部分加入以 node 为根的子树
+         */
+        void insert(size_t node, const std::vector<PathStep>& steps, size_t i);
+
+        /**
+         * @return 键为 key 的子节点，不存在时新建，已有通配分支时从它复制
+         */
+        size_t memberChild(size_t node, const std::string& key);
+
+        size_t elementChild(size_t node, size_t index);
+
+        /**
+         * 深复制以 node 为根的子树
+         * @return 副本的根
+         */
+        size_t clone(size_t node);
+
+        /**
+         * 按 node 解析 c->json 处的值
+         * @param open 跳过子树时尚未闭合的括号，在整次解析中复用
+         */
+        JsonParseStatus parse(ParseContext* c, size_t node, FieldValue* v, std::string* open) const;
+
+        JsonParseStatus parseObject(ParseContext* c, const Node& n, FieldValue* v, std::string* open) const;
+
+        JsonParseStatus parseArray(ParseContext* c, const Node& n, FieldValue* v, std::string* open) const;
+
+        std::vector<Node> nodes;    // nodes[0] 是根
+    };
+}
@@ -0,0 +1,223 @@
+//
+// Created by yubin on 2021/5/15.
+//
+
+#pragma once
+
+#include "fairy_json.h"
+#include "utils.h"
+#include "simd.h"
+
+namespace fairy {
+
+    /**
+     * SAX 处理器的基类，提供所有事件的默认实现，派生类只需覆盖关心的事件
+     * 通过 CRTP 在编译期分派，没有虚函数调用；每个事件返回 false 时停止解析，json_parse_sax 返回 PARSE_CANCELLED。
+     * 字符串与键的指针只在事件处理期间有效，且不以 '\0' 结尾
+     */
+    template <typename Derived>
+    class BaseSaxHandler {
+    public:
+        bool null() { return true; }
+        bool boolean(bool) { return true; }
+
+        /**
+         * 非整数或超出 64 位整数范围的数字
+         */
+        bool number(double) { return true; }
+
+        /**
+         * 整数默认转换成 double 交给 number
+         */
+        bool int64(int64_t i) { return static_cast<Derived*>(this)->number(static_cast<double>(i)); }
+        bool uint64(uint64_t u) { return static_cast<Derived*>(this)->number(static_cast<double>(u)); }
+
+        bool string(const char*, size_t) { return true; }
+        bool startObject() { return true; }
+        bool key(const char*, size_t) { return true; }
+
+        /**
+         * @param memberCount 对象的成员个数
+         */
+        bool endObject(size_t) { return true; }
+        bool startArray() { return true; }
+
+        /**
+         * @param elementCount 数组的元素个数
+         */
+        bool endArray(size_t) { return true; }
+    };
+
+    /**
+     * 事件驱动的解析器，不建立 FieldValue 树，复用 parseValue 的各个语法规则
+     * 解析器对象可以反复使用，字符串缓冲区会被保留
+     * @tparam Handler 提供 null、boolean、number、int64、uint64、string、startObject、key、endObject、
+     *                 startArray、endArray 的类型，可以从 BaseSaxHandler 派生
+     */
+    template <typename Handler>
+    class SaxParser {
+    public:
+        explicit SaxParser(Handler& handler, const ParseOptions& options = ParseOptions()) :
+            handler(handler)
+        {
+            this->context.maxDepth = options.depthLimit();
+        }
+
+        SaxParser(const SaxParser&) = delete;
+        SaxParser& operator=(const SaxParser&) = delete;
+
+        /**
+         * 解析一段以 '\0' 结尾的 json，错误状态与 json_parse 相同
+         * 出错之前的事件已经发出，处理器需要自行丢弃不完整的结果
+         */
+        JsonParseStatus parse(const char* json) {
+            this->context.json = skipWhitespace(json);
+            this->context.strBuf.clear();
+            auto retStatus = parseValue();
+            if (retStatus == JsonParseStatus::PARSE_OK && *skipWhitespace(this->context.json) != '\0')
+                retStatus = JsonParseStatus::PARSE_ROOT_NOT_SINGULAR;
+            return retStatus;
+        }
+
+    private:
+        static JsonParseStatus emitted(bool keepGoing) {
+            return keepGoing ? JsonParseStatus::PARSE_OK : JsonParseStatus::PARSE_CANCELLED;
+        }
+
+        JsonParseStatus parseLiteral() {
+            // 字面量与数字直接按语法规则解析，FieldValue 中不会分配内存
+            FieldValue v;
+            const auto retStatus = fairy::parseValue(&this->context, &v);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            switch (v.getType()) {
+                case JsonFieldType::J_NULL:   return emitted(this->handler.null());
+                case JsonFieldType::J_TRUE:   return emitted(this->handler.boolean(true));
+                case JsonFieldType::J_FALSE:  return emitted(this->handler.boolean(false));
+                case JsonFieldType::J_INT64:  return emitted(this->handler.int64(v.getInt64()));
+                case JsonFieldType::J_UINT64: return emitted(this->handler.uint64(v.getUint64()));
+                default:                      return emitted(this->handler.number(v.getNumber()));
+            }
+        }
+
+        /**
+         * @param isKey 为 true 时发出 key 事件，否则发出 string 事件
+         */
+        JsonParseStatus parseString(bool isKey) {
+            const char* s = nullptr;
+            size_t len = 0;
+            const auto retStatus = decodeStringRaw(&this->context, &s, &len);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            const bool keepGoing = isKey ? this->handler.key(s, len) : this->handler.string(s, len);
+            this->context.strBuf.clear();
+            return emitted(keepGoing);
+        }
+
+        JsonParseStatus parseArray() {
+            ParseContext* c = &this->context;
+            ++c->json;
+            auto retStatus = emitted(this->handler.startArray());
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            c->json = skipWhitespace(c->json);
+            size_t count = 0;
+            if (*c->json == ']') {
+                ++c->json;
+                return emitted(this->handler.endArray(count));
+            }
+            while (true) {
+                retStatus = parseValue();
+                if (retStatus != JsonParseStatus::PARSE_OK)
+                    return retStatus;
+                ++count;
+                c->json = skipWhitespace(c->json);
+                if (*c->json == ',') {
+                    c->json = skipWhitespace(c->json + 1);
+                } else if (*c->json == ']') {
+                    ++c->json;
+                    return emitted(this->handler.endArray(count));
+                } else {
+                    return JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+                }
+            }
+        }
+
+        JsonParseStatus parseObject() {
+            ParseContext* c = &this->context;
+            ++c->json;
+            auto retStatus = emitted(this->handler.startObject());
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            c->json = skipWhitespace(c->json);
+            size_t count = 0;
+            if (*c->json == '}') {
+                ++c->json;
+                return emitted(this->handler.endObject(count));
+            }
+            while (true) {
+                if (*c->json != '\"')
+                    return JsonParseStatus::PARSE_MISS_KEY;
+                retStatus = parseString(true);
+                if (retStatus != JsonParseStatus::PARSE_OK)
+                    return retStatus;
+                c->json = skipWhitespace(c->json);
+                if (*c->json != ':')
+                    return JsonParseStatus::PARSE_MISS_COLON;
+                c->json = skipWhitespace(c->json + 1);
+                retStatus = parseValue();
+                if (retStatus != JsonParseStatus::PARSE_OK)
+                    return retStatus;
+                ++count;
+                c->json = skipWhitespace(c->json);
+                if (*c->json == ',') {
+                    c->json = skipWhitespace(c->json + 1);
+                } else if (*c->json == '}') {
+                    ++c->json;
+                    return emitted(this->handler.endObject(count));
+                } else {
+                    return JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+                }
+            }
+        }
+
+        /**
+         * 递归解析数组或对象，嵌套层数受 ParseContext::maxDepth 限制
+         */
+        JsonParseStatus parseNested() {
+            ParseContext* c = &this->context;
+            if (c->depth >= c->maxDepth)
+                return JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+            ++c->depth;
+            const auto retStatus = *c->json == '[' ? parseArray() : parseObject();
+            --c->depth;
+            return retStatus;
+        }
+
+        JsonParseStatus parseValue() {
+            switch (*this->context.json) {
+                case '\"':  return parseString(false);
+                case '[':
+                case '{':   return parseNested();
+                case '\0':  return JsonParseStatus::PARSE_EXPECT_VALUE;
+                default:    return parseLiteral();
+            }
+        }
+
+        Handler& handler;
+        ParseContext context;
+    };
+
+    /**
+     * 以事件的形式解析 json，处理器的类型在编译期确定
+     * @param json_str 以 '\0' 结尾的 json 字符串
+     * @param handler 接收事件的处理器
+     * @param options 解析选项，只有 maxDepth 起作用
+     * @return 解析结果状态，处理器返回 false 时为 PARSE_CANCELLED
+     */
+    template <typename Handler>
+    JsonParseStatus json_parse_sax(const char* json_str, Handler& handler, const ParseOptions& options = ParseOptions()) {
+        SaxParser<Handler> parser(handler, options);
+        return parser.parse(json_str);
+    }
+}
@@ -0,0 +1,308 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FAIRY_JSON_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FAIRY_JSON_SSE2 1
+#endif
+
+#if defined(__clang__) || defined(__GNUC__)
+#define FAIRY_JSON_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define FAIRY_JSON_NO_SANITIZE_ADDRESS
+#endif
+
+/*
+ * 字符串与空白符扫描内核
+ * 向量化版本只使用对齐加载：对齐的加载永远不会跨越内存页，因此即使读到 '\0' 之后的几个字节也不会访问到无效的页，
+ * 调用方只需保证输入以 '\0' 结尾即可
+ */
+
+namespace fairy {
+
+    /**
+     * 判断一个字节在字符串中是否需要特殊处理：'"'、'\\' 或控制字符（包括 '\0'）
+     */
+    inline bool isStringSpecial(char ch) {
+        return ch == '"' || ch == '\\' || static_cast<unsigned char>(ch) < 0x20;
+    }
+
+    /**
+     * 逐字节查找第一个需要特殊处理的字节
+     * @param p 字符串内容的当前位置
+     * @return 第一个 '"'、'\\' 或控制字符的位置
+     */
+    inline const char* scanStringSpecialScalar(const char* p) {
+        while (!isStringSpecial(*p))
+            ++p;
+        return p;
+    }
+
+    inline int countTrailingZeros(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctz(x);
+#else
+        int n = 0;
+        while ((x & 1) == 0) {
+            x >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+#if defined(FAIRY_JSON_AVX2)
+    FAIRY_JSON_NO_SANITIZE_ADDRESS
+    inline uint32_t stringSpecialMask(const char* aligned) {
+        const __m256i chunk = _mm256_load_si256(reinterpret_cast<const __m256i*>(aligned));
+        const __m256i quote = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'));
+        const __m256i backslash = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'));
+        // 无符号比较 chunk <= 0x1F 等价于 min(chunk, 0x1F) == chunk
+        const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, _mm256_set1_epi8(0x1F)), chunk);
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(quote, backslash), control)));
+    }
+
+    static const size_t STRING_SCAN_WIDTH = 32;
+#elif defined(FAIRY_JSON_SSE2)
+    FAIRY_JSON_NO_SANITIZE_ADDRESS
+    inline uint32_t stringSpecialMask(const char* aligned) {
+        const __m128i chunk = _mm_load_si128(reinterpret_cast<const __m128i*>(aligned));
+        const __m128i quote = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'));
+        const __m128i backslash = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'));
+        // 无符号比较 chunk <= 0x1F 等价于 min(chunk, 0x1F) == chunk
+        const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, _mm_set1_epi8(0x1F)), chunk);
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, backslash), control)));
+    }
+
+    static const size_t STRING_SCAN_WIDTH = 16;
+#endif
+
+    /**
+     * 查找第一个需要特殊处理的字节，一次检查 16（SSE2）或 32（AVX2）个字节
+     * 输入必须以 '\0' 结尾，'\0' 本身也属于控制字符，因此扫描一定会在结尾处停下
+     * @param p 字符串内容的当前位置
+     * @return 第一个 '"'、'\\' 或控制字符的位置
+     */
+    inline const char* scanStringSpecial(const char* p) {
+#if defined(FAIRY_JSON_AVX2) || defined(FAIRY_JSON_SSE2)
+        // 第一个块向下对齐，并屏蔽掉 p 之前的字节
+        const size_t misalign = reinterpret_cast<uintptr_t>(p) & (STRING_SCAN_WIDTH - 1);
+        const char* block = p - misalign;
+        uint32_t mask = stringSpecialMask(block) & (0xFFFFFFFFu << misalign);
+        while (mask == 0) {
+            block += STRING_SCAN_WIDTH;
+            mask = stringSpecialMask(block);
+        }
+        return block + countTrailingZeros(mask);
+#else
+        return scanStringSpecialScalar(p);
+#endif
+    }
+
+#if defined(FAIRY_JSON_AVX2)
+    inline uint32_t stringSpecialMaskUnaligned(const char* p) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i quote = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"'));
+        const __m256i backslash = _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'));
+        const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, _mm256_set1_epi8(0x1F)), chunk);
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(quote, backslash), control)));
+    }
+#elif defined(FAIRY_JSON_SSE2)
+    inline uint32_t stringSpecialMaskUnaligned(const char* p) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i quote = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('"'));
+        const __m128i backslash = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\'));
+        const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, _mm_set1_epi8(0x1F)), chunk);
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, backslash), control)));
+    }
+#endif
+
+    /**
+     * 在 [p, end) 范围内查找第一个需要特殊处理的字节，不会读取 end 之后的内存，
+     * 适用于不以 '\0' 结尾或中间含有 '\0' 的数据
+     * @param p 起始位置
+     * @param end 结束位置
+     * @return 第一个 '"'、'\\' 或控制字符的位置，没有时返回 end
+     */
+    inline const char* scanStringSpecial(const char* p, const char* end) {
+#if defined(FAIRY_JSON_AVX2) || defined(FAIRY_JSON_SSE2)
+        for (; end - p >= static_cast<ptrdiff_t>(STRING_SCAN_WIDTH); p += STRING_SCAN_WIDTH) {
+            const uint32_t mask = stringSpecialMaskUnaligned(p);
+            if (mask != 0)
+                return p + countTrailingZeros(mask);
+        }
+#endif
+        while (p != end && !isStringSpecial(*p))
+            ++p;
+        return p;
+    }
+
+    /**
+     * 判断是否为 json 空白符：ws = *(%x20 / %x09 / %x0A / %x0D)
+     */
+    inline bool isWhitespace(char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+    }
+
+    /**
+     * 逐字节跳过空白符
+     * @param p 当前位置
+     * @return 第一个非空白符的位置
+     */
+    inline const char* skipWhitespaceScalar(const char* p) {
+        while (isWhitespace(*p))
+            ++p;
+        return p;
+    }
+
+#if defined(FAIRY_JSON_AVX2)
+    static const size_t WHITESPACE_SCAN_WIDTH = 32;
+
+    /**
+     * @return 块中不是空格的字节的位掩码
+     */
+    FAIRY_JSON_NO_SANITIZE_ADDRESS
+    inline uint32_t nonSpaceMask(const char* aligned) {
+        const __m256i chunk = _mm256_load_si256(reinterpret_cast<const __m256i*>(aligned));
+        return ~static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' '))));
+    }
+
+    /**
+     * @return 块中不是空白符的字节的位掩码
+     */
+    FAIRY_JSON_NO_SANITIZE_ADDRESS
+    inline uint32_t nonWhitespaceMask(const char* aligned) {
+        const __m256i chunk = _mm256_load_si256(reinterpret_cast<const __m256i*>(aligned));
+        const __m256i ws = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')), _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+        return ~static_cast<uint32_t>(_mm256_movemask_epi8(ws));
+    }
+#elif defined(FAIRY_JSON_SSE2)
+    static const size_t WHITESPACE_SCAN_WIDTH = 16;
+
+    /**
+     * @return 块中不是空格的字节的位掩码
+     */
+    FAIRY_JSON_NO_SANITIZE_ADDRESS
+    inline uint32_t nonSpaceMask(const char* aligned) {
+        const __m128i chunk = _mm_load_si128(reinterpret_cast<const __m128i*>(aligned));
+        return ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')))) & 0xFFFF;
+    }
+
+    /**
+     * @return 块中不是空白符的字节的位掩码
+     */
+    FAIRY_JSON_NO_SANITIZE_ADDRESS
+    inline uint32_t nonWhitespaceMask(const char* aligned) {
+        const __m128i chunk = _mm_load_si128(reinterpret_cast<const __m128i*>(aligned));
+        const __m128i ws = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+        return ~static_cast<uint32_t>(_mm_movemask_epi8(ws)) & 0xFFFF;
+    }
+#endif
+
+#if defined(FAIRY_JSON_AVX2) || defined(FAIRY_JSON_SSE2)
+    /**
+     * 按对齐的块查找第一个使 maskFn 对应位为 1 的字节
+     * 输入以 '\0' 结尾，'\0' 既不是空格也不是空白符，因此扫描一定会停下
+     */
+    template <uint32_t (*maskFn)(const char*)>
+    inline const char* scanBlocks(const char* p) {
+        const size_t misalign = reinterpret_cast<uintptr_t>(p) & (WHITESPACE_SCAN_WIDTH - 1);
+        const char* block = p - misalign;
+        uint32_t mask = maskFn(block) & (0xFFFFFFFFu << misalign);
+        while (mask == 0) {
+            block += WHITESPACE_SCAN_WIDTH;
+            mask = maskFn(block);
+        }
+        return block + countTrailingZeros(mask);
+    }
+
+    /**
+     * 只扫描与 [p, end) 有交集的块，结果不超过 end；对齐的块不会跨越内存页，因此块中 end 之后的字节也可以读取
+     * @param p 起始位置，必须小于 end
+     */
+    template <uint32_t (*maskFn)(const char*)>
+    inline const char* scanBlocks(const char* p, const char* end) {
+        const size_t misalign = reinterpret_cast<uintptr_t>(p) & (WHITESPACE_SCAN_WIDTH - 1);
+        const char* block = p - misalign;
+        uint32_t mask = maskFn(block) & (0xFFFFFFFFu << misalign);
+        while (mask == 0) {
+            block += WHITESPACE_SCAN_WIDTH;
+            if (block >= end)
+                return end;
+            mask = maskFn(block);
+        }
+        p = block + countTrailingZeros(mask);
+        return p < end ? p : end;
+    }
+#endif
+
+    /**
+     * 跳过空白符
+     * 紧凑的 json 在 token 之间通常没有空白或只有一个空格，只检查一两个字节就返回；
+     * 格式化过的 json 中最常见的是“换行 + N 个空格”的缩进，换行之后只与空格比较，整块跳过缩进；
+     * 其余情况按块检查全部四种空白符
+     * @param p 当前位置，输入必须以 '\0' 结尾
+     * @return 第一个非空白符的位置
+     */
+    inline const char* skipWhitespace(const char* p) {
+        if (!isWhitespace(*p))
+            return p;
+        // ", " 之类的单个空白
+        if (!isWhitespace(p[1]))
+            return p + 1;
+#if defined(FAIRY_JSON_AVX2) || defined(FAIRY_JSON_SSE2)
+        if (*p == '\r' && p[1] == '\n')
+            ++p;
+        if (*p == '\n') {
+            p = scanBlocks<nonSpaceMask>(p + 1);
+            if (!isWhitespace(*p))
+                return p;
+        }
+        return scanBlocks<nonWhitespaceMask>(p);
+#else
+        return skipWhitespaceScalar(p);
+#endif
+    }
+
+    /**
+     * 在 [p, end) 范围内跳过空白符，策略与 skipWhitespace 相同，但不依赖结尾的 '\0'
+     * @param p 当前位置
+     * @param end 输入的末尾
+     * @return 第一个非空白符的位置，没有时返回 end
+     */
+    inline const char* skipWhitespace(const char* p, const char* end) {
+        if (p == end || !isWhitespace(*p))
+            return p;
+        if (p + 1 == end || !isWhitespace(p[1]))
+            return p + 1;
+#if defined(FAIRY_JSON_AVX2) || defined(FAIRY_JSON_SSE2)
+        if (*p == '\r' && p[1] == '\n')
+            ++p;
+        if (*p == '\n') {
+            if (++p == end)
+                return end;
+            p = scanBlocks<nonSpaceMask>(p, end);
+            if (p == end || !isWhitespace(*p))
+                return p;
+        }
+        return scanBlocks<nonWhitespaceMask>(p, end);
+#else
+        while (p != end && isWhitespace(*p))
+            ++p;
+        return p;
+#endif
+    }
+}
@@ -0,0 +1,246 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#include "structural.h"
+#include <cassert>
+#include <cstring>
+#include "simd.h"
+
+namespace fairy {
+
+    static const size_t BLOCK_SIZE = 64;
+
+    /**
+     * 一个 64 字节块的分类结果，第 i 位对应块中的第 i 个字节
+     */
+    struct BlockMasks {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t op;          // { } [ ] : ,
+        uint64_t whitespace;
+    };
+
+#if defined(FAIRY_JSON_AVX2)
+    static uint64_t movemask64(__m256i lo, __m256i hi) {
+        return static_cast<uint32_t>(_mm256_movemask_epi8(lo))
+               | static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hi))) << 32;
+    }
+
+    static BlockMasks classifyBlock(const char* p) {
+        const __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        // '[' ']' 与 '{' '}' 只差 0x20 这一位
+        const __m256i bit5 = _mm256_set1_epi8(0x20);
+        const __m256i loCurly = _mm256_or_si256(lo, bit5);
+        const __m256i hiCurly = _mm256_or_si256(hi, bit5);
+        BlockMasks m;
+        m.quote = movemask64(_mm256_cmpeq_epi8(lo, _mm256_set1_epi8('"')),
+                             _mm256_cmpeq_epi8(hi, _mm256_set1_epi8('"')));
+        m.backslash = movemask64(_mm256_cmpeq_epi8(lo, _mm256_set1_epi8('\\')),
+                                 _mm256_cmpeq_epi8(hi, _mm256_set1_epi8('\\')));
+        m.op = movemask64(
+            _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(loCurly, _mm256_set1_epi8('{')),
+                                _mm256_cmpeq_epi8(loCurly, _mm256_set1_epi8('}'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(lo, _mm256_set1_epi8(':')),
+                                _mm256_cmpeq_epi8(lo, _mm256_set1_epi8(',')))),
+            _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(hiCurly, _mm256_set1_epi8('{')),
+                                _mm256_cmpeq_epi8(hiCurly, _mm256_set1_epi8('}'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(hi, _mm256_set1_epi8(':')),
+                                _mm256_cmpeq_epi8(hi, _mm256_set1_epi8(',')))));
+        m.whitespace = movemask64(
+            _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(lo, _mm256_set1_epi8(' ')),
+                                _mm256_cmpeq_epi8(lo, _mm256_set1_epi8('\t'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(lo, _mm256_set1_epi8('\n')),
+                                _mm256_cmpeq_epi8(lo, _mm256_set1_epi8('\r')))),
+            _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(hi, _mm256_set1_epi8(' ')),
+                                _mm256_cmpeq_epi8(hi, _mm256_set1_epi8('\t'))),
+                _mm256_or_si256(_mm256_cmpeq_epi8(hi, _mm256_set1_epi8('\n')),
+                                _mm256_cmpeq_epi8(hi, _mm256_set1_epi8('\r')))));
+        return m;
+    }
+#elif defined(FAIRY_JSON_SSE2)
+    /**
+     * 对 16 个字节分类，结果放在 BlockMasks 各字段的 [shift, shift + 16) 位
+     */
+    static void classify16(const char* p, int shift, BlockMasks* m) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // '[' ']' 与 '{' '}' 只差 0x20 这一位
+        const __m128i curly = _mm_or_si128(chunk, _mm_set1_epi8(0x20));
+        const __m128i op = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(curly, _mm_set1_epi8('{')), _mm_cmpeq_epi8(curly, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(':')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(','))));
+        const __m128i ws = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+        m->quote |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')))) << shift;
+        m->backslash |= static_cast<uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')))) << shift;
+        m->op |= static_cast<uint64_t>(_mm_movemask_epi8(op)) << shift;
+        m->whitespace |= static_cast<uint64_t>(_mm_movemask_epi8(ws)) << shift;
+    }
+
+    static BlockMasks classifyBlock(const char* p) {
+        BlockMasks m = {0, 0, 0, 0};
+        classify16(p, 0, &m);
+        classify16(p + 16, 16, &m);
+        classify16(p + 32, 32, &m);
+        classify16(p + 48, 48, &m);
+        return m;
+    }
+#else
+    static BlockMasks classifyBlock(const char* p) {
+        BlockMasks m = {0, 0, 0, 0};
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+            const uint64_t bit = uint64_t(1) << i;
+            switch (p[i]) {
+                case '"':  m.quote |= bit; break;
+                case '\\': m.backslash |= bit; break;
+                case '{': case '}': case '[': case ']': case ':': case ',':
+                    m.op |= bit;
+                    break;
+                case ' ': case '\t': case '\n': case '\r':
+                    m.whitespace |= bit;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return m;
+    }
+#endif
+
+    static int countTrailingZeros64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(x);
+#else
+        int n = 0;
+        while ((x & 1) == 0) {
+            x >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    /**
+     * 求出被转义的字符：位于奇数长度的连续反斜杠之后的字节
+     * @param backslash 反斜杠的位图
+     * @param prevEscaped 上一个块末尾的反斜杠是否转义了本块的第一个字节，返回时更新为本块的情况
+     */
+    static uint64_t escapedChars(uint64_t backslash, uint64_t* prevEscaped) {
+        if (backslash == 0) {
+            const uint64_t escaped = *prevEscaped;
+            *prevEscaped = 0;
+            return escaped;
+        }
+        const uint64_t evenBits = 0x5555555555555555ULL;
+        backslash &= ~*prevEscaped;
+        const uint64_t followsEscape = backslash << 1 | *prevEscaped;
+        // 从奇数位开始的反斜杠序列，加上整个序列后进位落在序列之后，再按起点的奇偶翻转
+        const uint64_t oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+        const uint64_t sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+        *prevEscaped = sequencesStartingOnEvenBits < backslash ? 1 : 0;
+        const uint64_t invertMask = sequencesStartingOnEvenBits << 1;
+        return (evenBits ^ invertMask) & followsEscape;
+    }
+
+    /**
+     * 前缀异或：第 i 位为输入第 0 ~ i 位的异或，用来把成对的引号展开成字符串内部的区间
+     */
+    static uint64_t prefixXor(uint64_t x) {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    static int popCount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_popcountll(x);
+#else
+        int n = 0;
+        for (; x != 0; x &= x - 1)
+            ++n;
+        return n;
+#endif
+    }
+
+    /**
+     * 把位图中每个置位的位置写出去
+     * 每次无条件地写 8 个，减少逐位循环中难以预测的分支；多写出的位置落在 out + 位数之后，随后会被覆盖，
+     * 因此 out 之后至少要留出 64 个位置的空间
+     * @return 写入之后的位置
+     */
+    static uint32_t* emitPositions(uint32_t* out, uint32_t base, uint64_t bits) {
+        uint32_t* const next = out + popCount64(bits);
+        while (bits != 0) {
+            for (int i = 0; i < 8; ++i) {
+                // 位图清空后 ctz 的结果无意义，或上最高位避免对 0 求 ctz
+                out[i] = base + countTrailingZeros64(bits | (uint64_t(1) << 63));
+                bits &= bits - 1;
+            }
+            out += 8;
+        }
+        return next;
+    }
+
+    size_t StructuralScanner::scan(const char* chunk, size_t len, uint32_t* out) {
+        uint32_t* const begin = out;
+        char tail[BLOCK_SIZE];
+        for (size_t base = 0; base < len; base += BLOCK_SIZE) {
+            const char* block = chunk + base;
+            if (len - base < BLOCK_SIZE) {
+                // 最后不足一块的部分用空白补齐，避免读到输入之外
+                memset(tail, ' ', BLOCK_SIZE);
+                memcpy(tail, block, len - base);
+                block = tail;
+            }
+            const BlockMasks m = classifyBlock(block);
+            const uint64_t escaped = escapedChars(m.backslash, &this->prevEscaped);
+            const uint64_t quote = m.quote & ~escaped;
+            // 字符串内部的掩码包含起始引号，不包含结束引号
+            const uint64_t inString = prefixXor(quote) ^ this->prevInString;
+            this->prevInString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+            // 数字与字面量只记录首字节：前一个字节不是同一个标量的一部分
+            const uint64_t scalar = ~(m.op | m.whitespace);
+            const uint64_t nonQuoteScalar = scalar & ~quote;
+            const uint64_t followsNonQuoteScalar = nonQuoteScalar << 1 | this->prevScalar;
+            this->prevScalar = nonQuoteScalar >> 63;
+            const uint64_t scalarStart = scalar & ~followsNonQuoteScalar;
+            // 去掉字符串内部与结束引号，保留起始引号
+            const uint64_t stringTail = inString ^ quote;
+            uint64_t structurals = (m.op | scalarStart | quote) & ~stringTail;
+            out = emitPositions(out, static_cast<uint32_t>(base), structurals);
+        }
+        return out - begin;
+    }
+
+    JsonParseStatus StructuralIndex::build(const char* json, size_t len) {
+        assert(len <= MAX_INPUT_SIZE);
+        // 结构字符的个数不会超过输入的字节数
+        if (this->capacity < len + BLOCK_SIZE) {
+            this->capacity = len + BLOCK_SIZE;
+            this->positions.reset(new uint32_t[this->capacity]);
+        }
+        StructuralScanner scanner;
+        this->count = scanner.scan(json, len, this->positions.get());
+        if (scanner.inString())
+            return JsonParseStatus::PARSE_MISS_QUOTATION_MARK;
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    void StructuralIndex::shrink(size_t maxCapacity) {
+        if (this->capacity > maxCapacity) {
+            this->positions.reset();
+            this->capacity = 0;
+            this->count = 0;
+        }
+    }
+}
@@ -0,0 +1,96 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "fairy_json.h"
+
+namespace fairy {
+
+    /**
+     * 分段扫描结构字符，转义、字符串与标量的状态在各段之间保留，不需要为整个输入保存索引
+     * 结构字符的定义与 StructuralIndex 相同
+     */
+    class StructuralScanner {
+    public:
+        /**
+         * 输出位置所需的额外空间，见 scan
+         */
+        static const size_t PADDING = 64;
+
+        /**
+         * 扫描紧接在上一段之后的一段输入
+         * @param chunk 本段的起始位置，不会读取 chunk + len 之后的内存
+         * @param len 本段的长度，除最后一段外必须是 64 的倍数，且不能超过 StructuralIndex::MAX_INPUT_SIZE
+         * @param out 输出相对于 chunk 的位置，至少要有 len + PADDING 个元素的空间
+         * @return 输出的位置个数
+         */
+        size_t scan(const char* chunk, size_t len, uint32_t* out);
+
+        /**
+         * @return 已扫描的输入是否结束在一个未闭合的字符串中
+         */
+        bool inString() const {
+            return this->prevInString != 0;
+        }
+
+    private:
+        uint64_t prevEscaped = 0;
+        uint64_t prevInString = 0;  // 全 1 表示上一个块结束时仍在字符串内
+        uint64_t prevScalar = 0;
+    };
+
+    /**
+     * 两阶段解析的第一阶段：结构字符索引
+     * 每次用 SIMD 对 64 个字节分类，得到引号、反斜杠、结构字符与空白的位图；
+     * 由反斜杠位图求出被转义的字符，再对未转义引号的位图做前缀异或得到字符串内部的掩码，
+     * 最后输出所有字符串外的 {}[]:, 、字符串的起始引号以及数字与字面量的首字节的位置。
+     * 索引对象可以反复使用，已申请的空间会被保留
+     */
+    class StructuralIndex {
+    public:
+        /**
+         * 单次能够建立索引的最大输入长度，位置以 32 位整数存放
+         */
+        static const size_t MAX_INPUT_SIZE = 0xFFFFFFFFu;
+
+        StructuralIndex() = default;
+
+        StructuralIndex(const StructuralIndex&) = delete;
+        StructuralIndex& operator=(const StructuralIndex&) = delete;
+
+        /**
+         * 为一段输入建立索引，原有的内容被丢弃
+         * @param json 输入，不要求以 '\0' 结尾，不会读取 json + len 之后的内存
+         * @param len 输入的长度，不能超过 MAX_INPUT_SIZE
+         * @return 字符串没有闭合时返回 PARSE_MISS_QUOTATION_MARK，否则返回 PARSE_OK；其余错误由第二阶段报告
+         */
+        JsonParseStatus build(const char* json, size_t len);
+
+        const uint32_t* begin() const {
+            return this->positions.get();
+        }
+
+        const uint32_t* end() const {
+            return this->positions.get() + this->count;
+        }
+
+        size_t size() const {
+            return this->count;
+        }
+
+        /**
+         * 已申请的空间超过 maxCapacity 个位置时释放，索引的内容一并丢弃
+         */
+        void shrink(size_t maxCapacity);
+
+    private:
+        std::unique_ptr<uint32_t[]> positions;
+        size_t capacity = 0;
+        size_t count = 0;
+    };
+}
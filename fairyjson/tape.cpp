@@ -0,0 +1,220 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#include "tape.h"
+#include <cassert>
+#include "utils.h"
+#include "simd.h"
+
+namespace fairy {
+
+    // 解析时用到的类型标记，定义见 TapeDocument
+    static const uint64_t TAG_NULL = TapeDocument::TAG_NULL;
+    static const uint64_t TAG_TRUE = TapeDocument::TAG_TRUE;
+    static const uint64_t TAG_FALSE = TapeDocument::TAG_FALSE;
+    static const uint64_t TAG_DOUBLE = TapeDocument::TAG_DOUBLE;
+    static const uint64_t TAG_INT64 = TapeDocument::TAG_INT64;
+    static const uint64_t TAG_UINT64 = TapeDocument::TAG_UINT64;
+    static const uint64_t TAG_STRING = TapeDocument::TAG_STRING;
+    static const uint64_t TAG_ARRAY_BEGIN = TapeDocument::TAG_ARRAY_BEGIN;
+    static const uint64_t TAG_ARRAY_END = TapeDocument::TAG_ARRAY_END;
+    static const uint64_t TAG_OBJECT_BEGIN = TapeDocument::TAG_OBJECT_BEGIN;
+    static const uint64_t TAG_OBJECT_END = TapeDocument::TAG_OBJECT_END;
+    static const uint64_t PAYLOAD_MASK = TapeDocument::PAYLOAD_MASK;
+
+    static uint64_t makeWord(uint64_t tag, uint64_t payload) {
+        assert(payload <= PAYLOAD_MASK);
+        return tag << TapeDocument::TAG_SHIFT | payload;
+    }
+
+    /**
+     * 解析 json 并写入 tape，c->strBuf 就是文档的字符串缓冲区
+     */
+    static JsonParseStatus tapeValue(ParseContext* c, std::vector<uint64_t>* tape);
+
+    /**
+     * 把字符串写进缓冲区：长度、字节、'\0'
+     * 含有转义的字符串由 decodeStringRaw 直接解码在缓冲区中的对应位置，不需要再拷贝
+     */
+    static JsonParseStatus tapeString(ParseContext* c, std::vector<uint64_t>* tape) {
+        const size_t offset = c->strBuf.size();
+        c->strBuf.resize(offset + sizeof(size_t));
+        const char* s = nullptr;
+        size_t len = 0;
+        const auto retStatus = decodeStringRaw(c, &s, &len);
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            return retStatus;
+        if (c->strBuf.size() == offset + sizeof(size_t))
+            c->strBuf.insert(c->strBuf.end(), s, s + len);
+        c->strBuf.push_back('\0');
+        memcpy(c->strBuf.data() + offset, &len, sizeof(size_t));
+        tape->push_back(makeWord(TAG_STRING, offset));
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    static JsonParseStatus tapeNumber(ParseContext* c, std::vector<uint64_t>* tape) {
+        FieldValue n;
+        const auto retStatus = parseNumber(c, &n);
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            return retStatus;
+        uint64_t bits = 0;
+        switch (n.getType()) {
+            case JsonFieldType::J_INT64: {
+                const int64_t i = n.getInt64();
+                memcpy(&bits, &i, sizeof(bits));
+                tape->push_back(makeWord(TAG_INT64, 0));
+                break;
+            }
+            case JsonFieldType::J_UINT64:
+                bits = n.getUint64();
+                tape->push_back(makeWord(TAG_UINT64, 0));
+                break;
+            default: {
+                const double d = n.getNumber();
+                memcpy(&bits, &d, sizeof(bits));
+                tape->push_back(makeWord(TAG_DOUBLE, 0));
+                break;
+            }
+        }
+        tape->push_back(bits);
+        return JsonParseStatus::PARSE_OK;
+    }
+
+    /**
+     * 写出容器的结束项，并回填起始项中结束项之后的位置
+     */
+    static void closeContainer(std::vector<uint64_t>* tape, size_t begin, uint64_t beginTag, uint64_t endTag,
+                               size_t count) {
+        tape->push_back(makeWord(endTag, count));
+        (*tape)[begin] = makeWord(beginTag, tape->size());
+    }
+
+    static JsonParseStatus tapeArray(ParseContext* c, std::vector<uint64_t>* tape) {
+        ++c->json;
+        const size_t begin = tape->size();
+        tape->push_back(0);
+        c->json = skipWhitespace(c->json);
+        size_t count = 0;
+        if (*c->json == ']') {
+            ++c->json;
+            closeContainer(tape, begin, TAG_ARRAY_BEGIN, TAG_ARRAY_END, count);
+            return JsonParseStatus::PARSE_OK;
+        }
+        while (true) {
+            const auto retStatus = tapeValue(c, tape);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            ++count;
+            c->json = skipWhitespace(c->json);
+            if (*c->json == ',') {
+                c->json = skipWhitespace(c->json + 1);
+            } else if (*c->json == ']') {
+                ++c->json;
+                closeContainer(tape, begin, TAG_ARRAY_BEGIN, TAG_ARRAY_END, count);
+                return JsonParseStatus::PARSE_OK;
+            } else {
+                return JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET;
+            }
+        }
+    }
+
+    static JsonParseStatus tapeObject(ParseContext* c, std::vector<uint64_t>* tape) {
+        ++c->json;
+        const size_t begin = tape->size();
+        tape->push_back(0);
+        c->json = skipWhitespace(c->json);
+        size_t count = 0;
+        if (*c->json == '}') {
+            ++c->json;
+            closeContainer(tape, begin, TAG_OBJECT_BEGIN, TAG_OBJECT_END, count);
+            return JsonParseStatus::PARSE_OK;
+        }
+        while (true) {
+            if (*c->json != '\"')
+                return JsonParseStatus::PARSE_MISS_KEY;
+            auto retStatus = tapeString(c, tape);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            c->json = skipWhitespace(c->json);
+            if (*c->json != ':')
+                return JsonParseStatus::PARSE_MISS_COLON;
+            c->json = skipWhitespace(c->json + 1);
+            retStatus = tapeValue(c, tape);
+            if (retStatus != JsonParseStatus::PARSE_OK)
+                return retStatus;
+            ++count;
+            c->json = skipWhitespace(c->json);
+            if (*c->json == ',') {
+                c->json = skipWhitespace(c->json + 1);
+            } else if (*c->json == '}') {
+                ++c->json;
+                closeContainer(tape, begin, TAG_OBJECT_BEGIN, TAG_OBJECT_END, count);
+                return JsonParseStatus::PARSE_OK;
+            } else {
+                return JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET;
+            }
+        }
+    }
+
+    static JsonParseStatus tapeValue(ParseContext* c, std::vector<uint64_t>* tape) {
+        switch (*c->json) {
+            case 'n':
+            case 't':
+            case 'f': {
+                // 字面量直接按语法规则解析
+                FieldValue literal;
+                const auto retStatus = parseValue(c, &literal);
+                if (retStatus != JsonParseStatus::PARSE_OK)
+                    return retStatus;
+                const JsonFieldType type = literal.getType();
+                tape->push_back(makeWord(type == JsonFieldType::J_NULL ? TAG_NULL
+                                         : type == JsonFieldType::J_TRUE ? TAG_TRUE : TAG_FALSE, 0));
+                return JsonParseStatus::PARSE_OK;
+            }
+            case '\"':  return tapeString(c, tape);
+            case '[':
+            case '{': {
+                if (c->depth >= c->maxDepth)
+                    return JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+                ++c->depth;
+                const auto retStatus = *c->json == '[' ? tapeArray(c, tape) : tapeObject(c, tape);
+                --c->depth;
+                return retStatus;
+            }
+            case '\0':  return JsonParseStatus::PARSE_EXPECT_VALUE;
+            default:    return tapeNumber(c, tape);
+        }
+    }
+
+    JsonParseStatus json_parse(TapeDocument* doc, const char* json_str, const ParseOptions& options) {
+        if (doc == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        doc->clear();
+        if (json_str == nullptr) {
+            return JsonParseStatus::PARSE_INVALID_VALUE;
+        }
+        ParseContext c;
+        c.json = skipWhitespace(json_str);
+        c.maxDepth = options.depthLimit();
+        c.strBuf.swap(doc->strings);
+        auto retStatus = tapeValue(&c, &doc->tape);
+        if (retStatus == JsonParseStatus::PARSE_OK && *skipWhitespace(c.json) != '\0')
+            retStatus = JsonParseStatus::PARSE_ROOT_NOT_SINGULAR;
+        c.strBuf.swap(doc->strings);
+        if (retStatus != JsonParseStatus::PARSE_OK)
+            doc->clear();
+        return retStatus;
+    }
+
+    TapeRef TapeRef::find(const char* key, size_t len) const {
+        assert(getType() == JsonFieldType::J_OBJECT);
+        for (auto it = begin(), last = end(); it != last; ++it) {
+            const JString k = it.key();
+            if (k.len == len && memcmp(k.s, key, len) == 0)
+                return *it;
+        }
+        return TapeRef();
+    }
+}
@@ -0,0 +1,306 @@
+//
+// Created by yubin on 2021/5/14.
+//
+
+#pragma once
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+#include "fairy_json.h"
+
+namespace fairy {
+
+    class TapeDocument;
+    class TapeIterator;
+
+    /**
+     * 指向 tape 中一个值的只读引用，接口与 FieldValue 的 getter 对应
+     */
+    class TapeRef {
+    public:
+        TapeRef() = default;
+
+        /**
+         * @return 是否指向一个值；find 没有找到时为 false
+         */
+        bool exists() const {
+            return this->doc != nullptr;
+        }
+
+        JsonFieldType getType() const;
+
+        /**
+         * @return 是否为数字类型（J_NUMBER、J_INT64 或 J_UINT64）
+         */
+        bool isNumber() const;
+
+        /**
+         * @return 数字的 double 值，整数类型会被转换成 double
+         */
+        double getNumber() const;
+
+        int64_t getInt64() const;
+
+        uint64_t getUint64() const;
+
+        /**
+         * @return 以 '\0' 结尾的字符串，指向文档的字符串缓冲区，不能修改
+         */
+        JString getJStr() const;
+
+        /**
+         * @return 数组的元素个数或对象的成员个数
+         */
+        size_t size() const;
+
+        /**
+         * 遍历数组的元素或对象的成员
+         */
+        TapeIterator begin() const;
+
+        TapeIterator end() const;
+
+        /**
+         * 在对象中查找键，存在重复的键时返回第一个
+         * @return 找到的值，没有找到时 exists() 为 false
+         */
+        TapeRef find(const char* key, size_t len) const;
+
+        TapeRef find(const char* key) const {
+            return find(key, strlen(key));
+        }
+
+    private:
+        friend class TapeDocument;
+        friend class TapeIterator;
+
+        TapeRef(const TapeDocument* doc, size_t index) :
+            doc(doc), index(index)
+        {}
+
+        uint64_t word() const;
+
+        const TapeDocument* doc = nullptr;
+        size_t index = 0;
+    };
+
+    /**
+     * 数组元素或对象成员的只进迭代器，对象成员依次由 key() 与 operator*() 给出键和值
+     */
+    class TapeIterator {
+    public:
+        TapeRef operator*() const;
+
+        /**
+         * @return 当前成员的键，只对对象有效
+         */
+        JString key() const;
+
+        TapeIterator& operator++();
+
+        bool operator==(const TapeIterator& other) const {
+            return this->index == other.index;
+        }
+
+        bool operator!=(const TapeIterator& other) const {
+            return this->index != other.index;
+        }
+
+    private:
+        friend class TapeRef;
+
+        TapeIterator(const TapeDocument* doc, size_t index, bool inObject) :
+            doc(doc), index(index), inObject(inObject)
+        {}
+
+        const TapeDocument* doc;
+        size_t index;     // 数组中指向元素，对象中指向成员的键
+        bool inObject;
+    };
+
+    /**
+     * 以 tape 形式存放的只读文档
+     * 整个文档是一段连续的 uint64_t 数组，每一项的高 8 位是类型标记、低 56 位是内容：
+     * 字面量只占一项；数字占两项，第二项是 double 或整数的原始位；字符串的内容是它在字符串缓冲区中的偏移，
+     * 缓冲区中依次存放长度、字节与 '\0'；数组与对象的起始项记录结束项之后的位置，可以一步跳过整个容器，
+     * 结束项记录元素个数；对象的成员按键、值的顺序交替存放。
+     * 与 FieldValue 树相比，内存占用更少，顺序遍历时也更容易命中缓存
+     */
+    class TapeDocument {
+    public:
+        TapeDocument() = default;
+
+        TapeDocument(const TapeDocument&) = delete;
+        TapeDocument& operator=(const TapeDocument&) = delete;
+
+        /**
+         * @return 根元素，文档为空时 exists() 为 false
+         */
+        TapeRef getRoot() const {
+            return this->tape.empty() ? TapeRef() : TapeRef(this, 0);
+        }
+
+        /**
+         * 丢弃已解析的内容，保留已申请的空间
+         */
+        void clear() {
+            this->tape.clear();
+            this->strings.clear();
+        }
+
+        /**
+         * @return tape 与字符串缓冲区占用的字节数
+         */
+        size_t memoryUsage() const {
+            return this->tape.size() * sizeof(uint64_t) + this->strings.size();
+        }
+
+        /*
+         * tape 中每一项的类型标记
+         */
+        static const uint64_t TAG_NULL = 'n';
+        static const uint64_t TAG_TRUE = 't';
+        static const uint64_t TAG_FALSE = 'f';
+        static const uint64_t TAG_DOUBLE = 'd';
+        static const uint64_t TAG_INT64 = 'l';
+        static const uint64_t TAG_UINT64 = 'u';
+        static const uint64_t TAG_STRING = '"';
+        static const uint64_t TAG_ARRAY_BEGIN = '[';
+        static const uint64_t TAG_ARRAY_END = ']';
+        static const uint64_t TAG_OBJECT_BEGIN = '{';
+        static const uint64_t TAG_OBJECT_END = '}';
+
+        static const int TAG_SHIFT = 56;
+        static const uint64_t PAYLOAD_MASK = (uint64_t(1) << TAG_SHIFT) - 1;
+
+    private:
+        friend class TapeRef;
+        friend class TapeIterator;
+        friend JsonParseStatus json_parse(TapeDocument* doc, const char* json_str, const ParseOptions& options);
+
+        /**
+         * @return index 处的值之后的位置
+         */
+        size_t skip(size_t index) const {
+            const uint64_t word = this->tape[index];
+            switch (word >> TAG_SHIFT) {
+                case TAG_ARRAY_BEGIN:
+                case TAG_OBJECT_BEGIN:
+                    return word & PAYLOAD_MASK;
+                case TAG_DOUBLE:
+                case TAG_INT64:
+                case TAG_UINT64:
+                    return index + 2;
+                default:
+                    return index + 1;
+            }
+        }
+
+        std::vector<uint64_t> tape;
+        std::vector<char> strings;
+    };
+
+    /**
+     * 将 json 解析成 tape，文档中原有的内容会先被丢弃
+     * @param doc 目标文档
+     * @param json_str 以 '\0' 结尾的 json 字符串
+     * @param options 解析选项，只有 maxDepth 起作用
+     * @return 解析结果状态，失败时文档为空
+     */
+    JsonParseStatus json_parse(TapeDocument* doc, const char* json_str, const ParseOptions& options = ParseOptions());
+
+    /*
+     * 遍历时频繁调用的访问函数放在头文件中，便于内联
+     */
+
+    inline uint64_t TapeRef::word() const {
+        assert(exists());
+        return this->doc->tape[this->index];
+    }
+
+    inline JsonFieldType TapeRef::getType() const {
+        switch (word() >> TapeDocument::TAG_SHIFT) {
+            case TapeDocument::TAG_TRUE:          return JsonFieldType::J_TRUE;
+            case TapeDocument::TAG_FALSE:         return JsonFieldType::J_FALSE;
+            case TapeDocument::TAG_DOUBLE:        return JsonFieldType::J_NUMBER;
+            case TapeDocument::TAG_INT64:         return JsonFieldType::J_INT64;
+            case TapeDocument::TAG_UINT64:        return JsonFieldType::J_UINT64;
+            case TapeDocument::TAG_STRING:        return JsonFieldType::J_STRING;
+            case TapeDocument::TAG_ARRAY_BEGIN:   return JsonFieldType::J_ARRAY;
+            case TapeDocument::TAG_OBJECT_BEGIN:  return JsonFieldType::J_OBJECT;
+            default:                              return JsonFieldType::J_NULL;
+        }
+    }
+
+    inline bool TapeRef::isNumber() const {
+        const uint64_t tag = word() >> TapeDocument::TAG_SHIFT;
+        return tag == TapeDocument::TAG_DOUBLE || tag == TapeDocument::TAG_INT64 || tag == TapeDocument::TAG_UINT64;
+    }
+
+    inline double TapeRef::getNumber() const {
+        assert(isNumber());
+        const uint64_t bits = this->doc->tape[this->index + 1];
+        switch (word() >> TapeDocument::TAG_SHIFT) {
+            case TapeDocument::TAG_INT64:
+                return static_cast<double>(static_cast<int64_t>(bits));
+            case TapeDocument::TAG_UINT64:
+                return static_cast<double>(bits);
+            default: {
+                double d;
+                memcpy(&d, &bits, sizeof(d));
+                return d;
+            }
+        }
+    }
+
+    inline int64_t TapeRef::getInt64() const {
+        assert(word() >> TapeDocument::TAG_SHIFT == TapeDocument::TAG_INT64);
+        return static_cast<int64_t>(this->doc->tape[this->index + 1]);
+    }
+
+    inline uint64_t TapeRef::getUint64() const {
+        assert(word() >> TapeDocument::TAG_SHIFT == TapeDocument::TAG_UINT64);
+        return this->doc->tape[this->index + 1];
+    }
+
+    inline JString TapeRef::getJStr() const {
+        assert(word() >> TapeDocument::TAG_SHIFT == TapeDocument::TAG_STRING);
+        const char* p = this->doc->strings.data() + (word() & TapeDocument::PAYLOAD_MASK);
+        size_t len;
+        memcpy(&len, p, sizeof(len));
+        return {const_cast<char*>(p + sizeof(len)), len};
+    }
+
+    inline size_t TapeRef::size() const {
+        assert(getType() == JsonFieldType::J_ARRAY || getType() == JsonFieldType::J_OBJECT);
+        // 结束项中记录了元素个数
+        return this->doc->tape[(word() & TapeDocument::PAYLOAD_MASK) - 1] & TapeDocument::PAYLOAD_MASK;
+    }
+
+    inline TapeIterator TapeRef::begin() const {
+        assert(getType() == JsonFieldType::J_ARRAY || getType() == JsonFieldType::J_OBJECT);
+        return TapeIterator(this->doc, this->index + 1, word() >> TapeDocument::TAG_SHIFT == TapeDocument::TAG_OBJECT_BEGIN);
+    }
+
+    inline TapeIterator TapeRef::end() const {
+        assert(getType() == JsonFieldType::J_ARRAY || getType() == JsonFieldType::J_OBJECT);
+        // 指向结束项
+        return TapeIterator(this->doc, (word() & TapeDocument::PAYLOAD_MASK) - 1,
+                            word() >> TapeDocument::TAG_SHIFT == TapeDocument::TAG_OBJECT_BEGIN);
+    }
+
+    inline TapeRef TapeIterator::operator*() const {
+        return TapeRef(this->doc, this->inObject ? this->index + 1 : this->index);
+    }
+
+    inline JString TapeIterator::key() const {
+        assert(this->inObject);
+        return TapeRef(this->doc, this->index).getJStr();
+    }
+
+    inline TapeIterator& TapeIterator::operator++() {
+        this->index = this->doc->skip(this->inObject ? this->index + 1 : this->index);
+        return *this;
+    }
+}
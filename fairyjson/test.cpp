@@ -1,9 +1,29 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cmath>
 #include <string>
-#include <iostream>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <functional>
 #include "fairy_json.h"
+#include "simd.h"
+#include "number.h"
+#include "key_pool.h"
+#include "lazy_json.h"
+#include "structural.h"
+#include "tape.h"
+#include "sax.h"
+#include "incremental.h"
+#include "ndjson.h"
+#include "parallel.h"
+#include "mapped_file.h"
+#include "json_path.h"
+#include "projection.h"
+#include "msgpack.h"
+#include "bind.h"
 
 
 using namespace fairy;
@@ -24,9 +44,13 @@ static int test_pass = 0;
     } while(0)
 
 #define EXPECT_EQ_INT(expect, actual) EXPECT_EQ_BASE((expect) == (actual), expect, actual, "%d")
+#define EXPECT_EQ_INT64(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (long long)(expect), (long long)(actual), "%lld")
+#define EXPECT_EQ_UINT64(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (unsigned long long)(expect), (unsigned long long)(actual), "%llu")
 #define EXPECT_EQ_DOUBLE(expect, actual) EXPECT_EQ_BASE((expect) == (actual), expect, actual, "%.17g")
 #define EXPECT_EQ_STRING(expect, actual, aLength) \
     EXPECT_EQ_BASE(sizeof(expect) - 1 == aLength && memcmp(expect, actual, aLength) == 0, expect, actual, "%s")
+#define EXPECT_TRUE(actual) EXPECT_EQ_BASE((actual) != 0, "true", "false", "%s")
+#define EXPECT_FALSE(actual) EXPECT_EQ_BASE((actual) == 0, "false", "true", "%s")
 #if defined(_MSC_VER)
 #define EXPECT_EQ_SIZE_T(expect, actual) EXPECT_EQ_BASE((expect) == (actual), (size_t)expect, (size_t)actual, "%Iu")
 #else
@@ -66,14 +90,38 @@ static void test_parse_root_not_singular() {
     EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());
 }
 
+#define TEST_ERROR(error, json)\
+    do {\
+        FieldValue v;\
+        EXPECT_EQ_INT(error, json_parse(&v, json));\
+        EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());\
+        v.freeSpace();\
+    } while(0)
+
 #define TEST_NUMBER(expect, json)\
     do {\
         FieldValue v(JsonFieldType::J_FALSE);\
         EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json));\
-        EXPECT_EQ_INT(JsonFieldType::J_NUMBER, v.getType());\
+        EXPECT_EQ_INT(1, v.isNumber());\
         EXPECT_EQ_DOUBLE(expect, v.getNumber());\
     } while(0)
 
+#define TEST_INT64(expect, json)\
+    do {\
+        FieldValue v;\
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json));\
+        EXPECT_EQ_INT(JsonFieldType::J_INT64, v.getType());\
+        EXPECT_EQ_INT64(expect, v.getInt64());\
+    } while(0)
+
+#define TEST_UINT64(expect, json)\
+    do {\
+        FieldValue v;\
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json));\
+        EXPECT_EQ_INT(JsonFieldType::J_UINT64, v.getType());\
+        EXPECT_EQ_UINT64(expect, v.getUint64());\
+    } while(0)
+
 static void test_parse_number() {
     TEST_NUMBER(0.0, "0");
     TEST_NUMBER(0.0, "-0");
@@ -104,6 +152,103 @@ static void test_parse_number() {
     TEST_NUMBER(-2.2250738585072014e-308, "-2.2250738585072014e-308");
     TEST_NUMBER( 1.7976931348623157e+308, "1.7976931348623157e+308");  /* Max double */
     TEST_NUMBER(-1.7976931348623157e+308, "-1.7976931348623157e+308");
+
+    TEST_NUMBER(9007199254740993.0, "9007199254740993.0");  /* 2^53 + 1, rounds to even */
+    TEST_NUMBER(0.1, "0.1");
+    TEST_NUMBER(0.1, "0.1000000000000000055511151231257827021181583404541015625");
+    TEST_NUMBER(1e23, "1e23");
+    TEST_NUMBER(1e23, "100000000000000000000000");
+    TEST_NUMBER(2.2250738585072011e-308, "2.2250738585072011e-308");
+    TEST_NUMBER(1.7976931348623157e+308, "179769313486231570814527423731704356798070567525844996598917476803157260780028538760589558632766878171540458953514382464234321326889464182768467546703537516986049910576551282076245490090389328944075868508455133942304583236903222948165808559332123348274797826204144723168738177180919299881250404026184124858368");
+    TEST_NUMBER(0.0, "0e1000000000000");
+    TEST_NUMBER(0.0, "0.0000000000000000000000000000000000000000000000000000000000000e99999");
+}
+
+static void test_parse_integer() {
+    TEST_INT64(0, "0");
+    TEST_INT64(1, "1");
+    TEST_INT64(-1, "-1");
+    TEST_INT64(123, "123");
+    TEST_INT64(9007199254740993LL, "9007199254740993");  /* 2^53 + 1, not representable as double */
+    TEST_INT64(INT64_MAX, "9223372036854775807");
+    TEST_INT64(INT64_MIN, "-9223372036854775808");
+    TEST_INT64(1234567890123456789LL, "1234567890123456789");
+    TEST_UINT64(9223372036854775808ULL, "9223372036854775808");
+    TEST_UINT64(UINT64_MAX, "18446744073709551615");
+    TEST_UINT64(10000000000000000000ULL, "10000000000000000000");
+
+    /* 超出 64 位整数范围的整数退化为 double */
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "18446744073709551616"));
+    EXPECT_EQ_INT(JsonFieldType::J_NUMBER, v.getType());
+    EXPECT_EQ_DOUBLE(18446744073709551616.0, v.getNumber());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "-9223372036854775809"));
+    EXPECT_EQ_INT(JsonFieldType::J_NUMBER, v.getType());
+    EXPECT_EQ_DOUBLE(-9223372036854775808.0, v.getNumber());
+    /* -0 需要保留符号 */
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "-0"));
+    EXPECT_EQ_INT(JsonFieldType::J_NUMBER, v.getType());
+    EXPECT_EQ_INT(1, std::signbit(v.getNumber()));
+    /* 带小数点或指数的数字总是 double */
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "1.0"));
+    EXPECT_EQ_INT(JsonFieldType::J_NUMBER, v.getType());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "1e2"));
+    EXPECT_EQ_INT(JsonFieldType::J_NUMBER, v.getType());
+}
+
+static void test_parse_number_against_strtod() {
+    // 与 strtod 逐位比较：随机的 17 位有效数字、截断的长尾数、非规格化数以及各种指数
+    srand(20210514);
+    char buf[128];
+    size_t mismatches = 0;
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t bits = (uint64_t(rand()) << 62) ^ (uint64_t(rand()) << 31) ^ uint64_t(rand());
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        if (std::isnan(d) || std::isinf(d))
+            continue;
+        switch (i % 4) {
+            case 0: snprintf(buf, sizeof(buf), "%.17g", d); break;
+            case 1: snprintf(buf, sizeof(buf), "%.25e", d); break;
+            case 2: snprintf(buf, sizeof(buf), "%.6g", d); break;
+            default: snprintf(buf, sizeof(buf), "%d.%de%d", rand(), rand() % 1000, rand() % 700 - 350); break;
+        }
+        FieldValue v;
+        if (json_parse(&v, buf) != JsonParseStatus::PARSE_OK) {
+            if (!std::isinf(strtod(buf, nullptr)))
+                ++mismatches;
+            continue;
+        }
+        const double expect = strtod(buf, nullptr);
+        const double actual = v.getNumber();
+        if (memcmp(&expect, &actual, sizeof(double)) != 0)
+            ++mismatches;
+    }
+    EXPECT_EQ_SIZE_T(0, mismatches);
+}
+
+static void test_parse_number_too_big() {
+    TEST_ERROR(JsonParseStatus::PARSE_NUMBER_OVERFLOW, "1e309");
+    TEST_ERROR(JsonParseStatus::PARSE_NUMBER_OVERFLOW, "-1e309");
+    TEST_ERROR(JsonParseStatus::PARSE_NUMBER_OVERFLOW, "1.7976931348623159e308");
+    TEST_ERROR(JsonParseStatus::PARSE_NUMBER_OVERFLOW, "1e99999999999999999999");
+}
+
+static void test_parse_invalid_number() {
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "+0");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "+1");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, ".123");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "1.");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "1e");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "1e+");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "-");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "INF");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "inf");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "NAN");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "nan");
+    TEST_ERROR(JsonParseStatus::PARSE_ROOT_NOT_SINGULAR, "0123");
+    TEST_ERROR(JsonParseStatus::PARSE_ROOT_NOT_SINGULAR, "0x0");
+    TEST_ERROR(JsonParseStatus::PARSE_ROOT_NOT_SINGULAR, "0x123");
 }
 
 #define TEST_STRING(expect, json)\
@@ -126,15 +271,19 @@ static void test_parse_string() {
     TEST_STRING("\xE2\x82\xAC", "\"\\u20AC\""); /* Euro sign U+20AC */
     TEST_STRING("\xF0\x9D\x84\x9E", "\"\\uD834\\uDD1E\"");  /* G clef sign U+1D11E */
     TEST_STRING("\xF0\x9D\x84\x9E", "\"\\ud834\\udd1e\"");  /* G clef sign U+1D11E */
+    TEST_STRING("Hello, \"World\"! \xE2\x82\xAC 100\tend", "\"Hello, \\\"World\\\"! \\u20AC 100\\tend\"");
 }
 
-#define TEST_ERROR(error, json)\
-    do {\
-        FieldValue v;\
-        EXPECT_EQ_INT(error, json_parse(&v, json));\
-        EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());\
-        v.freeSpace();\
-    } while(0)
+static void test_parse_string_in_array() {
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "[ \"plain\", \"esc\\naped\", \"\", \"tail\\u0041\" ]"));
+    EXPECT_EQ_SIZE_T(4, v.getArray()->size());
+    EXPECT_EQ_STRING("plain", (*v.getArray())[0].getJStr()->s, (*v.getArray())[0].getJStr()->len);
+    EXPECT_EQ_STRING("esc\naped", (*v.getArray())[1].getJStr()->s, (*v.getArray())[1].getJStr()->len);
+    EXPECT_EQ_STRING("", (*v.getArray())[2].getJStr()->s, (*v.getArray())[2].getJStr()->len);
+    EXPECT_EQ_STRING("tailA", (*v.getArray())[3].getJStr()->s, (*v.getArray())[3].getJStr()->len);
+    v.freeSpace();
+}
 
     
 static void test_parse_invalid_string_escape() {
@@ -151,6 +300,33 @@ static void test_parse_invalid_string_char() {
     TEST_ERROR(JsonParseStatus::PARSE_INVALID_STRING_CHAR, "\"\x1F\"");
 }
 
+static void test_parse_missing_quotation_mark() {
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_QUOTATION_MARK, "\"");
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_QUOTATION_MARK, "\"abc");
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_QUOTATION_MARK, "\"abc\\n");
+}
+
+static void test_parse_invalid_unicode_hex() {
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_HEX, "\"\\u\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_HEX, "\"\\u0\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_HEX, "\"\\u01\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_HEX, "\"\\u012\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_HEX, "\"\\u/000\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_HEX, "\"\\uG000\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_HEX, "\"\\u0G00\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_HEX, "\"\\u00G0\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_HEX, "\"\\u000G\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_HEX, "\"\\u 123\"");
+}
+
+static void test_parse_invalid_unicode_surrogate() {
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE, "\"\\uDBFF\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\\\\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uDBFF\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_UNICODE_SURROGATE, "\"\\uD800\\uE000\"");
+}
+
 static void test_parse_array() {
     size_t i, j;
     FieldValue v;
@@ -166,7 +342,7 @@ static void test_parse_array() {
     EXPECT_EQ_INT(JsonFieldType::J_NULL,   (*v.getArray())[0].getType());
     EXPECT_EQ_INT(JsonFieldType::J_FALSE,  (*v.getArray())[1].getType());
     EXPECT_EQ_INT(JsonFieldType::J_TRUE,   (*v.getArray())[2].getType());
-    EXPECT_EQ_INT(JsonFieldType::J_NUMBER, (*v.getArray())[3].getType());
+    EXPECT_EQ_INT(JsonFieldType::J_INT64,  (*v.getArray())[3].getType());
     EXPECT_EQ_INT(JsonFieldType::J_STRING, (*v.getArray())[4].getType());
     EXPECT_EQ_DOUBLE(123.0, (*v.getArray())[3].getNumber());
     EXPECT_EQ_STRING("abc", (*v.getArray())[4].getJStr()->s, (*v.getArray())[4].getJStr()->len);
@@ -198,9 +374,1950 @@ static void test_parse_object() {
     EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getObj()->find("n")->second.getType());
     EXPECT_EQ_INT(JsonFieldType::J_FALSE, v.getObj()->find("f")->second.getType());
     EXPECT_EQ_INT(JsonFieldType::J_TRUE, v.getObj()->find("t")->second.getType());
-    EXPECT_EQ_INT(JsonFieldType::J_NUMBER, v.getObj()->find("i")->second.getType());
+    EXPECT_EQ_INT(JsonFieldType::J_INT64, v.getObj()->find("i")->second.getType());
     EXPECT_EQ_DOUBLE(123.0, v.getObj()->find("i")->second.getNumber());
+    EXPECT_EQ_INT(1, v.getObj()->find("x") == v.getObj()->end());
+    // 成员保持插入顺序
+    const char order[] = "nftisao";
+    for (i = 0; i < 7; ++i) {
+        EXPECT_EQ_SIZE_T(1, (*v.getObj())[i].first.len);
+        EXPECT_EQ_INT(order[i], (*v.getObj())[i].first.s[0]);
+    }
+    v.freeSpace();
+
+    // 重复的键都会保留，find 返回最先出现的那个
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "{\"k\":1,\"k\":2}"));
+    EXPECT_EQ_SIZE_T(2, v.getObj()->size());
+    EXPECT_EQ_INT64(1, v.getObj()->find("k")->second.getInt64());
+    v.freeSpace();
+
+    // 键可以含有 '\0'
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "{\"a\\u0000b\":1,\"a\":2}"));
+    EXPECT_EQ_INT64(1, v.getObj()->find("a\0b", 3)->second.getInt64());
+    EXPECT_EQ_INT64(2, v.getObj()->find(std::string("a"))->second.getInt64());
+    v.freeSpace();
+}
+
+static void test_parse_miss_key() {
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_KEY, "{:1,");
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_KEY, "{1:1,");
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_KEY, "{\"a\":1,}");
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_KEY, "{\"a\":[1],null:1}");
+}
+
+static void test_parse_miss_colon() {
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_COLON, "{\"a\"}");
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_COLON, "{\"a\":\"b\",\"c\",}");
+}
+
+static void test_parse_miss_comma_or_curly_bracket() {
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":1");
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":1]");
+    TEST_ERROR(JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":{\"b\":\"c\"} \"d\"");
+    TEST_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "{\"a\":\"b\",\"c\":nul}");
+}
+
+static void test_parse_wide_object() {
+    // 成员数超过阈值后通过哈希索引查找
+    std::string json = "{";
+    for (int k = 0; k < 1000; ++k) {
+        if (k != 0)
+            json += ",";
+        json += "\"key" + std::to_string(k) + "\":" + std::to_string(k);
+    }
+    json += ",\"key7\":-1}";
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json.c_str()));
+    const FieldObject* obj = v.getObj();
+    EXPECT_EQ_SIZE_T(1001, obj->size());
+    size_t found = 0;
+    for (int k = 0; k < 1000; ++k) {
+        auto it = obj->find("key" + std::to_string(k));
+        if (it != obj->end() && it->second.getInt64() == k && it - obj->begin() == k)
+            ++found;
+    }
+    EXPECT_EQ_SIZE_T(1000, found);
+    EXPECT_EQ_INT(1, obj->find("key1000") == obj->end());
+    EXPECT_EQ_INT(1, obj->find("") == obj->end());
+
+    // 建立索引之后继续追加的成员也能找到
+    FieldObject grown(FieldObject::allocator_type(), false);
+    for (int k = 0; k < 100; ++k) {
+        FieldValue e(JsonFieldType::J_INT64);
+        e.setInt64(k);
+        grown.append({&json[2], 4 + size_t(k % 3)}, std::move(e));
+        if (k == 20)
+            EXPECT_EQ_INT(1, grown.find("key0", 4) != grown.end());
+    }
+    EXPECT_EQ_INT64(0, grown.find("key0", 4)->second.getInt64());
+    EXPECT_EQ_INT64(1, grown.find("key0\"", 5)->second.getInt64());
+    EXPECT_EQ_INT64(2, grown.find("key0\":", 6)->second.getInt64());
+    v.freeSpace();
+
+    Document doc;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&doc, json.c_str()));
+    EXPECT_EQ_INT64(999, doc.getRoot()->getObj()->find("key999")->second.getInt64());
+}
+
+static void test_parse_document() {
+    Document doc(256);
+
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&doc,
+                                            " { "
+                                            "\"s\" : \"abc\", "
+                                            "\"a\" : [ 1, 2, \"a long string that does not fit in one arena chunk, "
+                                            "so the arena has to fall back to a dedicated chunk for it ................"
+                                            "..................................................................\" ],"
+                                            "\"o\" : { \"1\" : 1 }"
+                                            " } "
+    ));
+    const FieldValue* root = doc.getRoot();
+    EXPECT_EQ_INT(JsonFieldType::J_OBJECT, root->getType());
+    EXPECT_EQ_SIZE_T(3, root->getObj()->size());
+    const FieldValue& s = root->getObj()->find("s")->second;
+    EXPECT_EQ_STRING("abc", s.getJStr()->s, s.getJStr()->len);
+    const FieldValue& a = root->getObj()->find("a")->second;
+    EXPECT_EQ_SIZE_T(3, a.getArray()->size());
+    EXPECT_EQ_DOUBLE(2.0, (*a.getArray())[1].getNumber());
+    EXPECT_EQ_INT(JsonFieldType::J_STRING, (*a.getArray())[2].getType());
+    EXPECT_EQ_INT(1, doc.getArena()->chunkCount() > 1);
+
+    // 重新解析会丢弃旧内容并复用 Arena
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&doc, "[ \"x\" ]"));
+    EXPECT_EQ_INT(JsonFieldType::J_ARRAY, doc.getRoot()->getType());
+    EXPECT_EQ_SIZE_T(1, doc.getRoot()->getArray()->size());
+    EXPECT_EQ_INT(1, doc.getArena()->chunkCount());
+
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, json_parse(&doc, "[ \"x\", [1 } ]"));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, doc.getRoot()->getType());
+
+    doc.clear();
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, doc.getRoot()->getType());
+    EXPECT_EQ_SIZE_T(0, doc.getArena()->bytesAllocated());
+}
+
+static void test_parse_insitu() {
+    char json[] = "{ \"plain\" : \"abc\", \"esc\" : \"a\\tb\\u20AC\\uD834\\uDD1E!\", \"arr\" : [ \"x\", 1 ] }";
+    const char* const begin = json;
+    const char* const end = json + sizeof(json);
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_insitu(&v, json));
+    EXPECT_EQ_INT(JsonFieldType::J_OBJECT, v.getType());
+    const FieldValue& plain = v.getObj()->find("plain")->second;
+    EXPECT_EQ_STRING("abc", plain.getJStr()->s, plain.getJStr()->len);
+    EXPECT_EQ_INT(1, plain.getJStr()->s > begin && plain.getJStr()->s < end);
+    const FieldValue& esc = v.getObj()->find("esc")->second;
+    EXPECT_EQ_STRING("a\tb\xE2\x82\xAC\xF0\x9D\x84\x9E!", esc.getJStr()->s, esc.getJStr()->len);
+    EXPECT_EQ_INT(1, esc.getJStr()->s > begin && esc.getJStr()->s < end);
+    const FieldValue& arr = v.getObj()->find("arr")->second;
+    EXPECT_EQ_STRING("x", (*arr.getArray())[0].getJStr()->s, (*arr.getArray())[0].getJStr()->len);
+    v.freeSpace();
+
+    char json2[] = "[ \"in\\\"doc\", { \"k\" : \"v\" } ]";
+    Document doc;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_insitu(&doc, json2));
+    const FieldValue& s = (*doc.getRoot()->getArray())[0];
+    EXPECT_EQ_STRING("in\"doc", s.getJStr()->s, s.getJStr()->len);
+    EXPECT_EQ_INT(1, s.getJStr()->s == json2 + 3);
+
+    char json3[] = "[ \"ok\", \"bad\\x\" ]";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_INVALID_STRING_ESCAPE, json_parse_insitu(&v, json3));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());
+
+    // 重新解析到仍借用着输入缓冲区或 Arena 的值中，不能释放不属于它的内存（由 ASan 检查）
+    char json4[] = "\"hello\"";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_insitu(&v, json4));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "[1,2]"));
+    EXPECT_EQ_INT(JsonFieldType::J_ARRAY, v.getType());
+    char json5[] = "\"again\"";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_insitu(&v, json5));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "[\"x\"]", 5));
+    EXPECT_EQ_INT(JsonFieldType::J_ARRAY, v.getType());
+    FieldValue moved(std::move(*doc.getRoot()));
+    char json6[] = "[\"next\"]";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_insitu(&moved, json6));
+    EXPECT_EQ_STRING("next", (*moved.getArray())[0].getJStr()->s, 4);
+    EXPECT_EQ_INT(0, moved.isBorrowed());
+}
+
+static void test_scan_string_special() {
+    // 在不同的起始对齐与不同的距离上放置特殊字符，覆盖 16/32 字节块的边界
+    alignas(64) char buf[256];
+    const char specials[] = { '"', '\\', '\x01', '\x1F', '\0' };
+    size_t mismatches = 0;
+    for (size_t k = 0; k < sizeof(specials); ++k) {
+        for (size_t offset = 0; offset < 64; ++offset) {
+            for (size_t pos = 0; pos < 96; ++pos) {
+                memset(buf, 'a', sizeof(buf));
+                buf[sizeof(buf) - 1] = '\0';
+                buf[offset + pos] = specials[k];
+                const char* expect = buf + offset + pos;
+                if (scanStringSpecial(buf + offset) != expect || scanStringSpecialScalar(buf + offset) != expect)
+                    ++mismatches;
+            }
+        }
+    }
+    EXPECT_EQ_SIZE_T(0, mismatches);
+    // 0x20 以上的字节（包括 UTF-8 的多字节序列）都不是特殊字符
+    memset(buf, 0, sizeof(buf));
+    for (int i = 0; i < 200; ++i) {
+        const char ch = static_cast<char>(0x20 + i % 224);
+        buf[i] = (ch == '"' || ch == '\\') ? 'x' : ch;
+    }
+    EXPECT_EQ_SIZE_T(200, (size_t)(scanStringSpecial(buf) - buf));
+    EXPECT_EQ_SIZE_T(200, (size_t)(scanStringSpecialScalar(buf) - buf));
+}
+
+static void test_parse_string_at_buffer_end() {
+    // 字符串的结尾恰好落在一页内存的末尾，向量扫描不能越过这一页
+    const size_t page = 4096;
+    char* mem = static_cast<char*>(aligned_alloc(page, page));
+    for (size_t len = 0; len < 100; ++len) {
+        char* json = mem + page - (len + 3);
+        json[0] = '"';
+        memset(json + 1, 'z', len);
+        json[len + 1] = '"';
+        json[len + 2] = '\0';
+        FieldValue v;
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json));
+        EXPECT_EQ_SIZE_T(len, v.getJStr()->len);
+        v.freeSpace();
+        json[len + 1] = '\0';
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_QUOTATION_MARK, json_parse(&v, json));
+    }
+    free(mem);
+}
+
+static void test_skip_whitespace() {
+    alignas(64) char buf[256];
+    const char* patterns[] = { " ", "\n", "\r\n", "\t", "\n    ", "\r\n\t\t", " \n \t\r" };
+    size_t mismatches = 0;
+    for (size_t k = 0; k < sizeof(patterns) / sizeof(patterns[0]); ++k) {
+        for (size_t offset = 0; offset < 64; ++offset) {
+            for (size_t wsLen = 0; wsLen < 100; ++wsLen) {
+                memset(buf, 'x', sizeof(buf));
+                buf[sizeof(buf) - 1] = '\0';
+                // 以 pattern 开头，后面用空格补齐缩进
+                const size_t patLen = strlen(patterns[k]);
+                for (size_t i = 0; i < wsLen; ++i)
+                    buf[offset + i] = i < patLen ? patterns[k][i] : ' ';
+                const char* expect = buf + offset + wsLen;
+                if (skipWhitespace(buf + offset) != expect || skipWhitespaceScalar(buf + offset) != expect)
+                    ++mismatches;
+            }
+        }
+    }
+    EXPECT_EQ_SIZE_T(0, mismatches);
+
+    // 空白一直延续到输入结尾
+    const size_t page = 4096;
+    char* mem = static_cast<char*>(aligned_alloc(page, page));
+    for (size_t len = 0; len < 100; ++len) {
+        char* json = mem + page - (len + 2);
+        json[0] = '1';
+        memset(json + 1, len % 2 ? ' ' : '\n', len);
+        json[len + 1] = '\0';
+        FieldValue v;
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json));
+    }
+    free(mem);
+}
+
+#define TEST_WRITE_DOUBLE(expect, d)\
+    do {\
+        char buf[NUMBER_BUFFER_SIZE];\
+        const char* end = writeDouble(d, buf);\
+        EXPECT_EQ_STRING(expect, buf, (size_t)(end - buf));\
+    } while(0)
+
+static void test_write_number() {
+    TEST_WRITE_DOUBLE("0.0", 0.0);
+    TEST_WRITE_DOUBLE("-0.0", -0.0);
+    TEST_WRITE_DOUBLE("1.0", 1.0);
+    TEST_WRITE_DOUBLE("-1.5", -1.5);
+    TEST_WRITE_DOUBLE("0.1", 0.1);
+    TEST_WRITE_DOUBLE("3.1416", 3.1416);
+    TEST_WRITE_DOUBLE("123456.789", 123456.789);
+    TEST_WRITE_DOUBLE("0.001", 0.001);
+    TEST_WRITE_DOUBLE("1e-7", 1e-7);
+    TEST_WRITE_DOUBLE("1.234e-10", 1.234E-10);
+    TEST_WRITE_DOUBLE("1e30", 1e30);
+    TEST_WRITE_DOUBLE("100000000000000000000.0", 1e20);
+    TEST_WRITE_DOUBLE("9007199254740991.0", 9007199254740991.0);
+    TEST_WRITE_DOUBLE("1.0000000000000002", 1.0000000000000002);
+    TEST_WRITE_DOUBLE("5e-324", 4.9406564584124654e-324);
+    TEST_WRITE_DOUBLE("2.2250738585072014e-308", 2.2250738585072014e-308);
+    TEST_WRITE_DOUBLE("1.7976931348623157e308", 1.7976931348623157e+308);
+    TEST_WRITE_DOUBLE("-1.7976931348623157e308", -1.7976931348623157e+308);
+
+    char buf[NUMBER_BUFFER_SIZE];
+    EXPECT_EQ_STRING("-9223372036854775808", buf, (size_t)(writeInt64(INT64_MIN, buf) - buf));
+    EXPECT_EQ_STRING("9223372036854775807", buf, (size_t)(writeInt64(INT64_MAX, buf) - buf));
+    EXPECT_EQ_STRING("0", buf, (size_t)(writeInt64(0, buf) - buf));
+    EXPECT_EQ_STRING("18446744073709551615", buf, (size_t)(writeUint64(UINT64_MAX, buf) - buf));
+}
+
+static void test_write_double_roundtrip() {
+    // 随机的 double 格式化后再解析回来必须逐位相同，且有效数字不超过 17 位
+    srand(20210515);
+    size_t mismatches = 0, longer = 0;
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t bits = (uint64_t(rand()) << 62) ^ (uint64_t(rand()) << 31) ^ uint64_t(rand());
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        if (std::isnan(d) || std::isinf(d))
+            continue;
+        char buf[NUMBER_BUFFER_SIZE + 1];
+        *writeDouble(d, buf) = '\0';
+        FieldValue v;
+        if (json_parse(&v, buf) != JsonParseStatus::PARSE_OK || v.getType() != JsonFieldType::J_NUMBER) {
+            ++mismatches;
+            continue;
+        }
+        const double back = v.getNumber();
+        if (memcmp(&back, &d, sizeof(d)) != 0)
+            ++mismatches;
+        std::string digits;
+        for (const char* p = buf; *p != '\0' && *p != 'e'; ++p) {
+            if (*p >= '0' && *p <= '9' && (*p != '0' || !digits.empty()))
+                digits += *p;
+        }
+        while (!digits.empty() && digits.back() == '0')
+            digits.pop_back();
+        if (digits.size() > 17)
+            ++longer;
+    }
+    EXPECT_EQ_SIZE_T(0, mismatches);
+    EXPECT_EQ_SIZE_T(0, longer);
+}
+
+static void test_key_pool() {
+    KeyPool pool(1000, 8);
+    const char* a = pool.intern("alpha", 5);
+    EXPECT_EQ_INT(1, a != nullptr);
+    EXPECT_EQ_INT(1, a == pool.intern("alpha", 5));
+    EXPECT_EQ_INT(1, a == pool.find("alpha", 5));
+    EXPECT_EQ_INT(1, pool.find("alph", 4) == nullptr);
+    EXPECT_EQ_STRING("alpha", a, strlen(a));
+    EXPECT_EQ_INT(1, pool.intern("too long key", 12) == nullptr);
+    EXPECT_EQ_INT(1, pool.intern("", 0) != nullptr);
+    EXPECT_EQ_SIZE_T(2, pool.size());
+
+    // 超出初始容量后表会换成更大的，已驻留的指针保持不变
+    size_t stable = 0;
+    for (int k = 0; k < 2000; ++k) {
+        const std::string key = "k" + std::to_string(k);
+        const char* p = pool.intern(key.data(), key.size());
+        if (k < 998 ? p != nullptr : p == nullptr)
+            ++stable;
+    }
+    EXPECT_EQ_SIZE_T(2000, stable);
+    EXPECT_EQ_SIZE_T(1000, pool.size());
+    EXPECT_EQ_INT(1, a == pool.find("alpha", 5));
+
+    // 两份文档的键指向同一份副本；池满或键过长时退回普通的键
+    ParseOptions options;
+    options.keyPool = &pool;
+    const char* json = "{\"alpha\":1,\"k5\":2,\"fresh\":3,\"a\\u0020very\\u0020long\\u0020key\":4}";
+    FieldValue v1, v2;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v1, json, options));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v2, json, options));
+    EXPECT_EQ_INT(1, (*v1.getObj())[0].first.s == a);
+    EXPECT_EQ_INT(1, (*v1.getObj())[1].first.s == (*v2.getObj())[1].first.s);
+    EXPECT_EQ_INT(1, (*v1.getObj())[2].first.s != (*v2.getObj())[2].first.s);
+    EXPECT_EQ_INT64(1, v1.getObj()->find(a, 5)->second.getInt64());
+    EXPECT_EQ_INT64(3, v2.getObj()->find("fresh")->second.getInt64());
+    EXPECT_EQ_INT64(4, v2.getObj()->find("a very long key")->second.getInt64());
+    v1.freeSpace();
+    v2.freeSpace();
+
+    Document doc;
+    std::string buffer = json;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_insitu(&doc, &buffer[0], options));
+    EXPECT_EQ_INT(1, (*doc.getRoot()->getObj())[0].first.s == a);
+    EXPECT_EQ_INT64(4, doc.getRoot()->getObj()->find("a very long key")->second.getInt64());
+}
+
+static void test_key_pool_concurrent() {
+    // 多个线程共享同一个池解析，键的集合在解析过程中不断增长
+    KeyPool pool;
+    ParseOptions options;
+    options.keyPool = &pool;
+    const int threadCount = 4;
+    std::vector<int> failures(threadCount, 0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([t, &options, &failures]() {
+            for (int round = 0; round < 200; ++round) {
+                std::string json = "{";
+                for (int k = 0; k < 20; ++k) {
+                    json += k == 0 ? "\"" : ",\"";
+                    json += "key" + std::to_string((round * 7 + k * 13 + t) % 500) + "\":" + std::to_string(k);
+                }
+                json += "}";
+                FieldValue v;
+                if (json_parse(&v, json.c_str(), options) != JsonParseStatus::PARSE_OK) {
+                    ++failures[t];
+                    continue;
+                }
+                for (auto& item : *v.getObj()) {
+                    if (options.keyPool->find(item.first.s, item.first.len) != item.first.s)
+                        ++failures[t];
+                }
+                v.freeSpace();
+            }
+        });
+    }
+    for (auto& th : threads)
+        th.join();
+    int total = 0;
+    for (int f : failures)
+        total += f;
+    EXPECT_EQ_INT(0, total);
+    EXPECT_EQ_SIZE_T(500, pool.size());
+}
+
+static void test_lazy_document() {
+    const char* json = " { \"id\" : 42, \"name\" : \"fairy\\njson\", \"skip\" : { \"x\" : [ \"]}\\\"\", { } ] },"
+                       " \"tags\" : [ true, false, null, -1.5, 18446744073709551615 ] } ";
+    LazyDocument doc(json);
+    LazyValue root;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, doc.getRoot(&root));
+    EXPECT_EQ_INT(JsonFieldType::J_OBJECT, root.getType());
+    LazyObject obj;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, root.getObject(&obj));
+
+    LazyValue v;
+    int64_t i = 0;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, obj.findField("id", &v));
+    EXPECT_EQ_INT(JsonFieldType::J_INT64, v.getType());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, v.getInt64(&i));
+    EXPECT_EQ_INT64(42, i);
+
+    std::string s;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, obj.findField("name", &v));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, v.getString(&s));
+    EXPECT_EQ_STRING("fairy\njson", s.c_str(), s.size());
+
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, obj.findField("missing", &v));
+    EXPECT_EQ_INT(0, v.exists());
+
+    // 按文档顺序遍历，未访问的值被跳过
+    const char* key = nullptr;
+    size_t len = 0;
+    size_t members = 0;
+    while (obj.next(&key, &len, &v)) {
+        ++members;
+        if (len == 4 && memcmp(key, "tags", 4) == 0) {
+            LazyArray tags;
+            EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, v.getArray(&tags));
+            LazyValue e;
+            bool b = false, null = false;
+            double d = 0;
+            uint64_t u = 0;
+            EXPECT_EQ_INT(1, tags.next(&e));
+            EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, e.getBool(&b));
+            EXPECT_EQ_INT(1, b);
+            EXPECT_EQ_INT(1, tags.next(&e));
+            EXPECT_EQ_INT(JsonFieldType::J_FALSE, e.getType());
+            EXPECT_EQ_INT(1, tags.next(&e));
+            EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, e.isNull(&null));
+            EXPECT_EQ_INT(1, null);
+            EXPECT_EQ_INT(1, tags.next(&e));
+            EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, e.getNumber(&d));
+            EXPECT_EQ_DOUBLE(-1.5, d);
+            EXPECT_EQ_INT(1, tags.next(&e));
+            EXPECT_EQ_INT(JsonFieldType::J_UINT64, e.getType());
+            EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, e.getUint64(&u));
+            EXPECT_EQ_UINT64(18446744073709551615ULL, u);
+            EXPECT_EQ_INT(0, tags.next(&e));
+            EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, tags.getStatus());
+        }
+    }
+    EXPECT_EQ_SIZE_T(4, members);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, obj.getStatus());
+
+    // 需要时可以把一个子树完整地解析出来
+    FieldValue skip;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, obj.findField("skip", &v));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, v.parse(&skip));
+    EXPECT_EQ_SIZE_T(2, skip.getObj()->find("x")->second.getArray()->size());
+    skip.freeSpace();
+
+    LazyDocument empty(" ");
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_EXPECT_VALUE, empty.getRoot(&root));
+
+    // 类型不符或数字超出范围时返回 PARSE_TYPE_MISMATCH，输出参数保持不变
+    LazyDocument mixed("[1.5, -1, 18446744073709551615, 7, \"s\", true, [], {}]");
+    LazyArray items;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, mixed.getRoot(&root));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, root.getArray(&items));
+    LazyValue item[8];
+    for (auto& e : item)
+        EXPECT_EQ_INT(1, items.next(&e));
+    i = 0;
+    uint64_t u = 0;
+    bool b = false;
+    double d = 0;
+    LazyArray array;
+    LazyObject object;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[0].getInt64(&i));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[0].getUint64(&u));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[1].getUint64(&u));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[2].getInt64(&i));
+    EXPECT_EQ_INT64(0, i);
+    EXPECT_EQ_UINT64(0, u);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, item[1].getInt64(&i));
+    EXPECT_EQ_INT64(-1, i);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, item[3].getUint64(&u));
+    EXPECT_EQ_UINT64(7, u);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[4].getNumber(&d));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[4].getInt64(&i));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[3].getBool(&b));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[5].getString(&s));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[0].getArray(&array));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[6].getObject(&object));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, item[7].getArray(&array));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, item[7].getObject(&object));
+}
+
+/**
+ * 按需遍历整个值，返回遇到的第一个错误
+ */
+static JsonParseStatus walkLazy(const LazyValue& v) {
+    if (v.getType() == JsonFieldType::J_ARRAY) {
+        LazyArray array;
+        v.getArray(&array);
+        LazyValue e;
+        while (array.next(&e)) {
+            auto ret = walkLazy(e);
+            if (ret != JsonParseStatus::PARSE_OK)
+                return ret;
+        }
+        return array.getStatus();
+    }
+    if (v.getType() == JsonFieldType::J_OBJECT) {
+        LazyObject obj;
+        v.getObject(&obj);
+        const char* key;
+        size_t len;
+        LazyValue e;
+        while (obj.next(&key, &len, &e)) {
+            auto ret = walkLazy(e);
+            if (ret != JsonParseStatus::PARSE_OK)
+                return ret;
+        }
+        return obj.getStatus();
+    }
+    FieldValue scalar;
+    auto ret = v.parse(&scalar);
+    scalar.freeSpace();
+    return ret;
+}
+
+#define TEST_LAZY_ERROR(error, json)\
+    do {\
+        LazyDocument doc(json);\
+        LazyValue root;\
+        JsonParseStatus ret = doc.getRoot(&root);\
+        if (ret == JsonParseStatus::PARSE_OK)\
+            ret = walkLazy(root);\
+        EXPECT_EQ_INT(error, ret);\
+    } while(0)
+
+#define TEST_LAZY_SKIP_ERROR(error, json)\
+    do {\
+        LazyDocument doc(json);\
+        LazyValue root, e;\
+        LazyArray array;\
+        doc.getRoot(&root);\
+        root.getArray(&array);\
+        while (array.next(&e)) {}\
+        EXPECT_EQ_INT(error, array.getStatus());\
+    } while(0)
+
+static void test_lazy_errors() {
+    // 访问到的值与 json_parse 报告相同的错误
+    TEST_LAZY_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "[1,]");
+    TEST_LAZY_ERROR(JsonParseStatus::PARSE_EXPECT_VALUE, "[1,");
+    TEST_LAZY_ERROR(JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[1 2]");
+    TEST_LAZY_ERROR(JsonParseStatus::PARSE_MISS_KEY, "{1:1}");
+    TEST_LAZY_ERROR(JsonParseStatus::PARSE_MISS_COLON, "{\"a\" 1}");
+    TEST_LAZY_ERROR(JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET, "{\"a\":1 \"b\":2}");
+    TEST_LAZY_ERROR(JsonParseStatus::PARSE_INVALID_STRING_ESCAPE, "[\"\\v\"]");
+    TEST_LAZY_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "[nul]");
+    TEST_LAZY_ERROR(JsonParseStatus::PARSE_NUMBER_OVERFLOW, "{\"a\":[1e309]}");
+
+    // 跳过的值只检查括号与引号的配对
+    TEST_LAZY_SKIP_ERROR(JsonParseStatus::PARSE_OK, "[[1,\"]\"], {\"a\":[]}, \"x\"]");
+    TEST_LAZY_SKIP_ERROR(JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[[1}]");
+    TEST_LAZY_SKIP_ERROR(JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET, "[{\"a\":1]]");
+    TEST_LAZY_SKIP_ERROR(JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, "[[1, 2");
+    TEST_LAZY_SKIP_ERROR(JsonParseStatus::PARSE_MISS_QUOTATION_MARK, "[[\"abc]]");
+    TEST_LAZY_SKIP_ERROR(JsonParseStatus::PARSE_INVALID_STRING_CHAR, "[\"a\tb\"]");
+    TEST_LAZY_SKIP_ERROR(JsonParseStatus::PARSE_INVALID_VALUE, "[tru]");
+}
+
+/**
+ * 逐字节求结构字符索引，作为 SIMD 实现的对照
+ */
+static std::vector<uint32_t> structuralIndexScalar(const std::string& json) {
+    std::vector<uint32_t> result;
+    bool inString = false, escaped = false, prevNonQuoteScalar = false;
+    for (size_t i = 0; i < json.size(); ++i) {
+        const char ch = json[i];
+        const bool isOp = strchr("{}[]:,", ch) != nullptr && ch != '\0';
+        const bool isWs = ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+        const bool isQuote = ch == '"' && !escaped;
+        if (inString) {
+            if (isQuote)
+                inString = false;
+        } else if (isQuote) {
+            result.push_back(uint32_t(i));
+            inString = true;
+        } else if (isOp || (!isWs && !prevNonQuoteScalar)) {
+            result.push_back(uint32_t(i));
+        }
+        escaped = ch == '\\' && !escaped;
+        prevNonQuoteScalar = !isOp && !isWs && !isQuote;
+    }
+    return result;
+}
+
+static void test_structural_index() {
+    StructuralIndex index;
+    const std::string simple = " {\"a\\\"]\" : [1, true,\"x\"], \"b\":-2.5e3}";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, index.build(simple.data(), simple.size()));
+    const uint32_t expect[] = { 1, 2, 9, 11, 12, 13, 15, 19, 20, 23, 24, 26, 29, 30, 36 };
+    EXPECT_EQ_SIZE_T(sizeof(expect) / sizeof(expect[0]), index.size());
+    EXPECT_EQ_INT(0, memcmp(expect, index.begin(), sizeof(expect)));
+
+    const std::string open = "[\"abc\\\"";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_QUOTATION_MARK, index.build(open.data(), open.size()));
+
+    // 随机输入中大量出现引号与反斜杠，跨越块边界的转义与字符串都要和逐字节的结果一致
+    srand(20210516);
+    const char alphabet[] = "\"\"\\\\\\{}[]:, \na1";
+    size_t mismatches = 0;
+    for (int round = 0; round < 3000; ++round) {
+        std::string json(size_t(rand() % 300), ' ');
+        for (auto& ch : json)
+            ch = alphabet[rand() % (sizeof(alphabet) - 1)];
+        index.build(json.data(), json.size());
+        const auto reference = structuralIndexScalar(json);
+        if (reference.size() != index.size()
+            || !std::equal(reference.begin(), reference.end(), index.begin()))
+            ++mismatches;
+    }
+    EXPECT_EQ_SIZE_T(0, mismatches);
+}
+
+/**
+ * 两阶段解析与递归下降的结果必须完全相同
+ */
+static bool sameAsRecursive(const char* json) {
+    FieldValue a, b;
+    const auto retA = json_parse(&a, json);
+    const auto retB = json_parse_indexed(&b, json);
+    bool same = retA == retB && a.getType() == b.getType();
+    if (same && retA == JsonParseStatus::PARSE_OK)
+        same = jsonStringify(&a) == jsonStringify(&b);
+    if (!same)
+        fprintf(stderr, "json_parse_indexed differs on: %s\n", json);
+    a.freeSpace();
+    b.freeSpace();
+    return same;
+}
+
+static void test_parse_indexed() {
+    const char* inputs[] = {
+        "null", " true ", "false", "0", "-0", "123", "-1.5e-3", "18446744073709551616",
+        "\"\"", "\"a\\\"b\\\\\"", "\"\\u00e9\\ud834\\udd1e\"", "[]", "{}", " [ [ ] , { } ] ",
+        "{\"a\":[1,2,{\"b\":null}],\"c\":\"d\",\"a\":false}",
+        "", " ", "nul", "?", "[1,]", "[1 2]", "[1", "[\"a\"1]", "{\"a\"}", "{\"a\":}", "{\"a\":1,}",
+        "{1:1}", "{\"a\":1 \"b\":2}", "{\"a\":1]", "[1}", "truex", "0123", "1 2", "\"abc", "[\"abc",
+        "[nul, \"abc", "\"\\v\"", "\"\\u12\"", "\"\\ud800\"", "\"a\tb\"", "1e309", "[1e309]",
+        "{\"a\" : 1 } x", "[[[[[[]]]]]]", "[\"]\"]", "{\"}\":\"{\"}",
+    };
+    size_t same = 0;
+    for (auto json : inputs)
+        same += sameAsRecursive(json);
+    EXPECT_EQ_SIZE_T(sizeof(inputs) / sizeof(inputs[0]), same);
+
+    // 对合法的文档随机改动几个字节，错误状态也要一致
+    const std::string base = "{\"id\": 12, \"name\": \"fairy \\\"json\\\"\", \"tags\": [true, false, null],"
+                             " \"nested\": {\"a\": [1.5, -2, {\"b\": \"\\u4e2d\"}]}, \"e\": []}";
+    const char alphabet[] = "{}[]:,\" \\tfn1-.e";
+    srand(20210517);
+    size_t fuzzSame = 0;
+    for (int round = 0; round < 3000; ++round) {
+        std::string json = base;
+        for (int k = rand() % 3 + 1; k > 0; --k)
+            json[rand() % json.size()] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        fuzzSame += sameAsRecursive(json.c_str());
+    }
+    EXPECT_EQ_SIZE_T(3000, fuzzSame);
+
+    Document doc;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_indexed(&doc, base.c_str()));
+    EXPECT_EQ_INT64(12, doc.getRoot()->getObj()->find("id")->second.getInt64());
+
+    // 调用者提供的索引在解析后保留内容与空间
+    StructuralIndex index;
+    ParseOptions options;
+    options.index = &index;
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_indexed(&v, "[1, \"a\", {\"b\": null}]", options));
+    EXPECT_EQ_SIZE_T(11, index.size());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_indexed(&doc, base.c_str(), options));
+    EXPECT_EQ_INT64(12, doc.getRoot()->getObj()->find("id")->second.getInt64());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, json_parse_indexed(&v, "[1 2]", options));
+
+    // 超过上限时释放空间，之后仍可以继续使用
+    index.shrink(1 << 20);
+    EXPECT_EQ_SIZE_T(4, index.size());
+    index.shrink(0);
+    EXPECT_EQ_SIZE_T(0, index.size());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_indexed(&v, "[true]", options));
+    EXPECT_EQ_SIZE_T(3, index.size());
+
+    // 超过线程内索引保留上限的输入，解析结果不受释放影响
+    std::string large = "[0";
+    for (int i = 0; i < 600000; ++i)
+        large += ",1";
+    large += "]";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_indexed(&v, large.c_str()));
+    EXPECT_EQ_SIZE_T(600001, v.getArray()->size());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_indexed(&v, base.c_str()));
+    EXPECT_EQ_INT(JsonFieldType::J_OBJECT, v.getType());
+}
+
+/**
+ * 递归比较 tape 中的值与 FieldValue 树
+ */
+static bool tapeEquals(TapeRef t, const FieldValue* v) {
+    if (t.getType() != v->getType())
+        return false;
+    switch (v->getType()) {
+        case JsonFieldType::J_NUMBER:
+            return t.getNumber() == v->getNumber();
+        case JsonFieldType::J_INT64:
+            return t.getInt64() == v->getInt64();
+        case JsonFieldType::J_UINT64:
+            return t.getUint64() == v->getUint64();
+        case JsonFieldType::J_STRING:
+            return t.getJStr().len == v->getJStr()->len
+                   && memcmp(t.getJStr().s, v->getJStr()->s, v->getJStr()->len + 1) == 0;
+        case JsonFieldType::J_ARRAY: {
+            if (t.size() != v->getArray()->size())
+                return false;
+            size_t i = 0;
+            for (auto it = t.begin(); it != t.end(); ++it, ++i) {
+                if (!tapeEquals(*it, &(*v->getArray())[i]))
+                    return false;
+            }
+            return i == t.size();
+        }
+        case JsonFieldType::J_OBJECT: {
+            if (t.size() != v->getObj()->size())
+                return false;
+            auto member = v->getObj()->begin();
+            for (auto it = t.begin(); it != t.end(); ++it, ++member) {
+                const JString key = it.key();
+                if (key.len != member->first.len || memcmp(key.s, member->first.s, key.len) != 0
+                    || !tapeEquals(*it, &member->second))
+                    return false;
+            }
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+static bool tapeSameAsRecursive(TapeDocument* doc, const char* json) {
+    FieldValue v;
+    const auto retA = json_parse(&v, json);
+    const auto retB = json_parse(doc, json);
+    bool same = retA == retB;
+    if (same && retA == JsonParseStatus::PARSE_OK)
+        same = tapeEquals(doc->getRoot(), &v);
+    if (same && retA != JsonParseStatus::PARSE_OK)
+        same = !doc->getRoot().exists();
+    if (!same)
+        fprintf(stderr, "tape differs on: %s\n", json);
     v.freeSpace();
+    return same;
+}
+
+static void test_tape_document() {
+    TapeDocument doc;
+    EXPECT_FALSE(doc.getRoot().exists());
+    const char* json = " { \"n\" : null, \"b\" : [true, false], \"i\": -12, \"u\": 18446744073709551615,"
+                       " \"d\": 2.5, \"s\": \"a\\u0000b\\n\", \"e\": {}, \"a\": [[], [1, \"x\"]] } ";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&doc, json));
+    const TapeRef root = doc.getRoot();
+    EXPECT_EQ_INT(JsonFieldType::J_OBJECT, root.getType());
+    EXPECT_EQ_SIZE_T(8, root.size());
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, root.find("n").getType());
+    const TapeRef b = root.find("b");
+    EXPECT_EQ_SIZE_T(2, b.size());
+    EXPECT_EQ_INT(JsonFieldType::J_TRUE, (*b.begin()).getType());
+    EXPECT_EQ_INT64(-12, root.find("i").getInt64());
+    EXPECT_EQ_DOUBLE(-12.0, root.find("i").getNumber());
+    EXPECT_EQ_UINT64(18446744073709551615ULL, root.find("u").getUint64());
+    EXPECT_TRUE(root.find("d").isNumber());
+    EXPECT_EQ_DOUBLE(2.5, root.find("d").getNumber());
+    const JString s = root.find("s").getJStr();
+    EXPECT_EQ_STRING("a\0b\n", s.s, s.len);
+    EXPECT_EQ_INT('\0', s.s[s.len]);
+    EXPECT_EQ_SIZE_T(0, root.find("e").size());
+    EXPECT_TRUE(root.find("e").begin() == root.find("e").end());
+    EXPECT_FALSE(root.find("missing").exists());
+
+    // 容器的起始项可以一步跳过，遍历时嵌套的数组不会被展开
+    const TapeRef a = root.find("a");
+    EXPECT_EQ_SIZE_T(2, a.size());
+    auto it = a.begin();
+    EXPECT_EQ_SIZE_T(0, (*it).size());
+    ++it;
+    EXPECT_EQ_SIZE_T(2, (*it).size());
+    ++it;
+    EXPECT_TRUE(it == a.end());
+
+    // 对象成员按文档中的顺序排列，重复的键保留，find 返回第一个
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&doc, "{\"k\":1,\"j\":2,\"k\":3}"));
+    std::string keys;
+    for (auto m = doc.getRoot().begin(); m != doc.getRoot().end(); ++m)
+        keys += m.key().s;
+    EXPECT_TRUE(keys == "kjk");
+    EXPECT_EQ_INT64(1, doc.getRoot().find("k").getInt64());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_INVALID_VALUE, json_parse(static_cast<TapeDocument*>(nullptr), "1"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_INVALID_VALUE, json_parse(&doc, static_cast<const char*>(nullptr)));
+    EXPECT_FALSE(doc.getRoot().exists());
+
+    const char* inputs[] = {
+        "null", "0", "-0", "1e-300", "\"\"", "\"\\ud834\\udd1e\"", "[]", "{}", " [ [ ] , { } ] ",
+        "", " ", "nul", "[1,]", "[1 2]", "[1", "{\"a\"}", "{\"a\":}", "{1:1}", "{\"a\":1]", "1 2",
+        "\"abc", "\"\\v\"", "\"\\ud800\"", "1e309", "[\"a\\\"b\", {\"\\u4e2d\": [null]}]",
+    };
+    size_t same = 0;
+    for (auto input : inputs)
+        same += tapeSameAsRecursive(&doc, input);
+    EXPECT_EQ_SIZE_T(sizeof(inputs) / sizeof(inputs[0]), same);
+
+    const std::string base = "{\"id\": 12, \"name\": \"fairy \\\"json\\\"\", \"tags\": [true, false, null],"
+                             " \"nested\": {\"a\": [1.5, -2, {\"b\": \"\\u4e2d\"}]}, \"e\": []}";
+    const char alphabet[] = "{}[]:,\" \\tfn1-.e";
+    srand(20210518);
+    size_t fuzzSame = 0;
+    for (int round = 0; round < 2000; ++round) {
+        std::string fuzzed = base;
+        for (int k = rand() % 3 + 1; k > 0; --k)
+            fuzzed[rand() % fuzzed.size()] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        fuzzSame += tapeSameAsRecursive(&doc, fuzzed.c_str());
+    }
+    EXPECT_EQ_SIZE_T(2000, fuzzSame);
+}
+
+/**
+ * 把事件记录成一行文本的处理器
+ */
+class RecordingHandler : public BaseSaxHandler<RecordingHandler> {
+public:
+    bool null() { log += "n "; return true; }
+    bool boolean(bool b) { log += b ? "t " : "f "; return true; }
+    bool number(double d) { char buf[32]; snprintf(buf, sizeof(buf), "d%g ", d); log += buf; return true; }
+    bool int64(int64_t i) { log += "i" + std::to_string(i) + " "; return true; }
+    bool string(const char* s, size_t len) { log += "s(" + std::string(s, len) + ") "; return true; }
+    bool startObject() { log += "{ "; return true; }
+    bool key(const char* s, size_t len) { log += "k(" + std::string(s, len) + ") "; return true; }
+    bool endObject(size_t n) { log += "}" + std::to_string(n) + " "; return --budget != 0; }
+    bool startArray() { log += "[ "; return true; }
+    bool endArray(size_t n) { log += "]" + std::to_string(n) + " "; return true; }
+
+    std::string log;
+    int budget = -1;   // 收到这么多个 endObject 之后停止解析
+};
+
+/**
+ * 只关心数字的处理器，整数由基类转换成 double
+ */
+class SumHandler : public BaseSaxHandler<SumHandler> {
+public:
+    bool number(double d) { sum += d; return true; }
+
+    double sum = 0;
+};
+
+static void test_parse_sax() {
+    RecordingHandler h;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_sax(
+        " {\"a\" : [null, true, false, -12, 2.5, 18446744073709551615], \"b\\n\": \"x\\u0041\", \"c\": {}} ", h));
+    EXPECT_TRUE(h.log == "{ k(a) [ n t f i-12 d2.5 d1.84467e+19 ]6 k(b\n) s(xA) k(c) { }0 }3 ");
+
+    SumHandler sum;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_sax("[1, -2, [3.5, {\"k\": 4}], \"5\"]", sum));
+    EXPECT_EQ_DOUBLE(6.5, sum.sum);
+
+    // 处理器返回 false 时停止，之后的事件不再发出
+    RecordingHandler cancel;
+    cancel.budget = 1;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_CANCELLED, json_parse_sax("[{}, {\"a\": 1}]", cancel));
+    EXPECT_TRUE(cancel.log == "[ { }0 ");
+
+    // 解析器可以反复使用
+    RecordingHandler reuse;
+    SaxParser<RecordingHandler> parser(reuse);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, parser.parse("\"\\t\""));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, parser.parse("\"\\\\\""));
+    EXPECT_TRUE(reuse.log == "s(\t) s(\\) ");
+
+    // 错误状态与 json_parse 相同
+    const char* inputs[] = {
+        "", " ", "nul", "?", "[1,]", "[1 2]", "[1", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "{1:1}",
+        "{\"a\":1]", "[1}", "0123", "1 2", "\"abc", "\"\\v\"", "\"\\u12\"", "\"\\ud800\"", "\"a\tb\"",
+        "1e309", "[1e309]", "{\"a\" : 1 } x", "[[[[[[]]]]]]",
+    };
+    size_t same = 0;
+    for (auto json : inputs) {
+        FieldValue v;
+        RecordingHandler any;
+        const auto expect = json_parse(&v, json);
+        v.freeSpace();
+        if (expect == json_parse_sax(json, any))
+            ++same;
+        else
+            fprintf(stderr, "json_parse_sax differs on: %s\n", json);
+    }
+    EXPECT_EQ_SIZE_T(sizeof(inputs) / sizeof(inputs[0]), same);
+}
+
+/**
+ * 把输入切成固定大小的块送入增量解析器，结果必须与 json_parse 相同
+ */
+static bool incrementalSameAsRecursive(IncrementalParser* parser, const std::string& json, size_t chunkSize) {
+    FieldValue a, b;
+    const auto retA = json_parse(&a, json.c_str());
+    for (size_t i = 0; i < json.size(); i += chunkSize) {
+        // 每一块单独拷贝，确保解析器没有保留指向之前的块的指针
+        const std::string chunk = json.substr(i, chunkSize);
+        parser->feed(chunk.data(), chunk.size());
+    }
+    const auto retB = parser->finish(&b);
+    bool same = retA == retB && a.getType() == b.getType();
+    if (same && retA == JsonParseStatus::PARSE_OK)
+        same = jsonStringify(&a) == jsonStringify(&b);
+    if (!same)
+        fprintf(stderr, "IncrementalParser (chunk %zu) differs on: %s\n", chunkSize, json.c_str());
+    a.freeSpace();
+    b.freeSpace();
+    return same;
+}
+
+static void test_parse_incremental() {
+    IncrementalParser parser;
+    const char* chunks[] = { "{\"na", "me\": \"a\\", "u00", "e9\\", "\\b\", \"n\": [-1", "2.5e", "1, tr", "ue]}" };
+    for (auto chunk : chunks)
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, parser.feed(chunk, strlen(chunk)));
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, parser.finish(&v));
+    EXPECT_EQ_STRING("a\xC3\xA9\\b", v.getObj()->find("name")->second.getJStr()->s,
+                     v.getObj()->find("name")->second.getJStr()->len);
+    EXPECT_EQ_DOUBLE(-12.5e1, (*v.getObj()->find("n")->second.getArray())[0].getNumber());
+    v.freeSpace();
+
+    // 出错后之后的块不再解析，finish 之后可以开始下一个文档
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COLON, parser.feed("{\"a\" 1", 6));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COLON, parser.feed("}", 1));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COLON, parser.finish(&v));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, parser.feed("[]", 2));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, parser.finish(&v));
+    EXPECT_EQ_SIZE_T(0, v.getArray()->size());
+    v.freeSpace();
+
+    const char* inputs[] = {
+        "null", " true ", "false", "0", "-0", "123", "-1.5e-3", "18446744073709551616",
+        "\"\"", "\"a\\\"b\\\\\"", "\"\\u00e9\\ud834\\udd1e\"", "[]", "{}", " [ [ ] , { } ] ",
+        "{\"a\":[1,2,{\"b\":null}],\"c\":\"d\",\"a\":false}",
+        "", " ", "nul", "?", "[1,]", "[1 2]", "[1", "[\"a\"1]", "{\"a\"}", "{\"a\":}", "{\"a\":1,}",
+        "{1:1}", "{\"a\":1 \"b\":2}", "{\"a\":1]", "[1}", "truex", "0123", "1 2", "\"abc", "[\"abc",
+        "[nul, \"abc", "\"\\v\"", "\"\\u12\"", "\"\\ud800\"", "\"a\tb\"", "1e309", "[1e309]",
+        "{\"a\" : 1 } x", "[[[[[[]]]]]]", "[\"]\"]", "{\"}\":\"{\"}", "\"\\", "[\"\\\\\"]", "{\"a\":",
+    };
+    const size_t chunkSizes[] = { 1, 2, 3, 7, 64 };
+    size_t same = 0;
+    for (auto json : inputs) {
+        for (auto n : chunkSizes)
+            same += incrementalSameAsRecursive(&parser, json, n);
+    }
+    EXPECT_EQ_SIZE_T(sizeof(inputs) / sizeof(inputs[0]) * 5, same);
+
+    const std::string base = "{\"id\": 12, \"name\": \"fairy \\\"json\\\"\", \"tags\": [true, false, null],"
+                             " \"nested\": {\"a\": [1.5, -2, {\"b\": \"\\u4e2d\"}]}, \"e\": []}";
+    const char alphabet[] = "{}[]:,\" \\tfn1-.e";
+    srand(20210519);
+    size_t fuzzSame = 0;
+    for (int round = 0; round < 2000; ++round) {
+        std::string json = base;
+        for (int k = rand() % 3 + 1; k > 0; --k)
+            json[rand() % json.size()] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        fuzzSame += incrementalSameAsRecursive(&parser, json, size_t(rand() % 8 + 1));
+    }
+    EXPECT_EQ_SIZE_T(2000, fuzzSame);
+}
+
+static void freeRecords(std::vector<NdjsonRecord>* records) {
+    for (auto& record : *records)
+        record.value.freeSpace();
+    records->clear();
+}
+
+static void test_parse_ndjson() {
+    const std::string input = "{\"a\": \"x\\ny\"}\n\n  \r\n[1, 2]\r\n{\"a\":}\n  true  \n\"tail\"";
+    std::vector<NdjsonRecord> records;
+    json_parse_ndjson(input.data(), input.size(), &records, 2);
+    EXPECT_EQ_SIZE_T(5, records.size());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, records[0].status);
+    EXPECT_EQ_STRING("x\ny", records[0].value.getObj()->find("a")->second.getJStr()->s,
+                     records[0].value.getObj()->find("a")->second.getJStr()->len);
+    EXPECT_EQ_SIZE_T(0, records[0].offset);
+    EXPECT_EQ_SIZE_T(2, records[1].value.getArray()->size());
+    EXPECT_EQ_SIZE_T(input.find('['), records[1].offset);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_INVALID_VALUE, records[2].status);
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, records[2].value.getType());
+    EXPECT_EQ_INT(JsonFieldType::J_TRUE, records[3].value.getType());
+    EXPECT_EQ_INT(JsonFieldType::J_STRING, records[4].value.getType());
+    freeRecords(&records);
+
+    json_parse_ndjson("", 0, &records);
+    EXPECT_EQ_SIZE_T(0, records.size());
+    json_parse_ndjson("\n\n", 2, &records);
+    EXPECT_EQ_SIZE_T(0, records.size());
+
+    // 记录很多时由多个线程解析，结果的顺序与状态必须与逐行解析相同
+    std::string many;
+    for (int i = 0; i < 5000; ++i) {
+        if (i % 97 == 0)
+            many += "{\"id\": " + std::to_string(i) + ", \"bad\": [}\n";
+        else
+            many += "{\"id\": " + std::to_string(i) + ", \"name\": \"n" + std::to_string(i) + "\"}\n";
+    }
+    NdjsonParser parser(4);
+    EXPECT_EQ_INT(4, parser.getThreads());
+    size_t inOrder = 0;
+    for (int round = 0; round < 2; ++round) {
+        parser.parse(many.data(), many.size(), &records);
+        EXPECT_EQ_SIZE_T(5000, records.size());
+        for (size_t i = 0; i < records.size(); ++i) {
+            const bool bad = i % 97 == 0;
+            if (bad ? records[i].status == JsonParseStatus::PARSE_INVALID_VALUE
+                    : records[i].status == JsonParseStatus::PARSE_OK
+                      && records[i].value.getObj()->find("id")->second.getInt64() == int64_t(i))
+                ++inOrder;
+        }
+        freeRecords(&records);
+    }
+    EXPECT_EQ_SIZE_T(10000, inOrder);
+}
+
+static bool parallelSameAsRecursive(const char* json) {
+    FieldValue a, b;
+    const auto retA = json_parse(&a, json);
+    const auto retB = json_parse_parallel(&b, json, 4);
+    bool same = retA == retB && a.getType() == b.getType();
+    if (same && retA == JsonParseStatus::PARSE_OK)
+        same = jsonStringify(&a) == jsonStringify(&b);
+    if (!same)
+        fprintf(stderr, "json_parse_parallel differs on: %s\n", json);
+    a.freeSpace();
+    b.freeSpace();
+    return same;
+}
+
+static void test_parse_parallel() {
+    const char* inputs[] = {
+        "[]", " [ ] ", "[1]", "[1, \"a,]\", [2, [3]], {\"k\": [4, 5]}, null]", "{\"a\": [1, 2]}", "1",
+        "[\"\\\"]\", \"\\\\\"]", "", "[", "[1,]", "[,1]", "[1,,2]", "[1 2]", "[{]}", "[]]", "[] x", "[1] 2",
+        "[\"abc]", "[{\"a\":}]", "[1, {\"a\": 1, }]", "x[1]", "[[1, 2], [3, 4]] ",
+        "[1}", "[1,2}", "[\"a\",{\"b\":1}}", "[[1]}", "{1]",
+    };
+    size_t same = 0;
+    for (auto json : inputs)
+        same += parallelSameAsRecursive(json);
+    EXPECT_EQ_SIZE_T(sizeof(inputs) / sizeof(inputs[0]), same);
+
+    // 足够多的元素才会真正分给多个线程，其中一个元素出错时整体的错误状态与 json_parse 相同
+    std::string big = "[";
+    for (int i = 0; i < 3000; ++i) {
+        if (i != 0)
+            big += ",\n ";
+        big += "{\"id\": " + std::to_string(i) + ", \"s\": \"a,b]\\\"c\", \"v\": [" + std::to_string(i) + ", {}]}";
+    }
+    big += "]";
+    EXPECT_TRUE(parallelSameAsRecursive(big.c_str()));
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_parallel(&v, big.c_str(), 3));
+    EXPECT_EQ_SIZE_T(3000, v.getArray()->size());
+    EXPECT_EQ_INT64(2999, (*v.getArray())[2999].getObj()->find("id")->second.getInt64());
+    v.freeSpace();
+    std::string broken = big;
+    broken[broken.size() / 2] = ':';
+    EXPECT_TRUE(parallelSameAsRecursive(broken.c_str()));
+
+    // 字符串跨越分段扫描的边界时，其中的 "]," 不能被当作元素的边界
+    std::string window = "[\"" + std::string((1 << 20) - 4, 'x') + "\\\"],[\"" + big.substr(1);
+    EXPECT_TRUE(parallelSameAsRecursive(window.c_str()));
+}
+
+/**
+ * 把内容写进临时文件
+ * @return 文件路径
+ */
+static std::string writeTempFile(const std::string& name, const std::string& content) {
+    const std::string path = "fairyjson_test_" + name + ".json";
+    FILE* fp = fopen(path.c_str(), "wb");
+    fwrite(content.data(), 1, content.size(), fp);
+    fclose(fp);
+    return path;
+}
+
+static void test_parse_file() {
+    const std::string path = writeTempFile("small", " {\"a\": [1, \"x\"], \"b\": null} \n");
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_file(&v, path.c_str()));
+    EXPECT_EQ_SIZE_T(2, v.getObj()->find("a")->second.getArray()->size());
+    v.freeSpace();
+    Document doc;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_file(&doc, path.c_str()));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, doc.getRoot()->getObj()->find("b")->second.getType());
+    remove(path.c_str());
+
+    // 文件恰好占满整页时，末尾的 '\0' 来自额外映射的匿名页
+    std::string exact = "[\"" + std::string(4096 * 2 - 4, 'y') + "\"]";
+    const std::string exactPath = writeTempFile("page", exact);
+    MappedFile file;
+    EXPECT_TRUE(file.open(exactPath.c_str()));
+    EXPECT_EQ_SIZE_T(exact.size(), file.size());
+    EXPECT_EQ_INT('\0', file.data()[file.size()]);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_file(&v, exactPath.c_str()));
+    EXPECT_EQ_SIZE_T(4096 * 2 - 4, (*v.getArray())[0].getJStr()->len);
+    v.freeSpace();
+    file.close();
+    remove(exactPath.c_str());
+
+    // 不论文件长度是否页对齐，内容之后都至少有一整页的 0
+    const std::string shortPath = writeTempFile("short", "[1]");
+    EXPECT_TRUE(file.open(shortPath.c_str()));
+    size_t zeros = 0;
+    for (size_t i = file.size(); i < 4096 * 2; ++i)
+        zeros += file.data()[i] == '\0';
+    EXPECT_EQ_SIZE_T(4096 * 2 - file.size(), zeros);
+    file.close();
+    remove(shortPath.c_str());
+
+    const std::string emptyPath = writeTempFile("empty", "");
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_EXPECT_VALUE, json_parse_file(&v, emptyPath.c_str()));
+    remove(emptyPath.c_str());
+
+    const std::string nulPath = writeTempFile("nul", std::string("[1]\0[2]", 7));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_ROOT_NOT_SINGULAR, json_parse_file(&v, nulPath.c_str()));
+    remove(nulPath.c_str());
+
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_IO_ERROR, json_parse_file(&v, "fairyjson_test_missing.json"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_IO_ERROR, json_parse_file(&v, "."));
+}
+
+/**
+ * 把 json 拷贝进恰好等长、不以 '\0' 结尾的缓冲区按有界的输入解析，再按带填充的输入解析，
+ * 两者的结果都应与 json_parse 相同
+ */
+static bool lengthSameAsTerminated(const std::string& json) {
+    FieldValue expect, bounded, padded;
+    const auto expectStatus = json_parse(&expect, json.c_str());
+    const std::vector<char> exact(json.begin(), json.end());
+    const auto boundedStatus = json_parse(&bounded, exact.data(), exact.size());
+    ParseOptions options;
+    options.padded = true;
+    const auto paddedStatus = json_parse(&padded, json.c_str(), json.size(), options);
+    bool same = expectStatus == boundedStatus && expectStatus == paddedStatus;
+    if (same && expectStatus == JsonParseStatus::PARSE_OK)
+        same = jsonStringify(&expect) == jsonStringify(&bounded) && jsonStringify(&expect) == jsonStringify(&padded);
+    expect.freeSpace();
+    bounded.freeSpace();
+    padded.freeSpace();
+    return same;
+}
+
+static void test_parse_length() {
+    const char* cases[] = {
+        "", "  ", "null", "true", "false", "nul", "tru", "fals", "-", "0", "-1.5e10", "1e", "1.", "0x0",
+        "\"abc\"", "\"a\\n\\u4e2d\"", "\"\\", "\"\\u00", "\"\\uD834\"", "\"\\uD834\\", "\"\\uD834\\u",
+        "\"\\uD834\\uDD", "\"\\uD834\\uDD1E\"", "\"abc", "\"\x01\"", "[1,2", "[1,2]", "[1 2]", "{\"a\":1}",
+        "{\"a\"", "{\"a\":", "{1:1}", " [ ] ", "[1] x", "[\n        1,\n        \"x\"\n    ]\n\n"
+    };
+    for (auto json : cases)
+        EXPECT_TRUE(lengthSameAsTerminated(json));
+
+    // 被截断在任意位置的文档
+    const std::string doc = "{\"name\" : \"fairy\\tjson\", \"list\": [1, -2.5e3, true, null, \"\\uD834\\uDD1E\"],"
+                            "\n    \"nested\": {\"" + std::string(40, 'k') + "\": [{}, []]}}   ";
+    size_t mismatches = 0;
+    for (size_t len = 0; len <= doc.size(); ++len) {
+        if (!lengthSameAsTerminated(doc.substr(0, len)))
+            ++mismatches;
+    }
+    EXPECT_EQ_SIZE_T(0, mismatches);
+
+    // 长度之后的内容不属于输入
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "[1,2][3]", 5));
+    EXPECT_EQ_SIZE_T(2, v.getArray()->size());
+    v.freeSpace();
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "12345", 2));
+    EXPECT_EQ_INT64(12, v.getInt64());
+
+    // 长度之内的 '\0' 是非法字符，无论输入是否带填充
+    ParseOptions padded;
+    padded.padded = true;
+    for (const ParseOptions& options : { ParseOptions(), padded }) {
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_ROOT_NOT_SINGULAR, json_parse(&v, "[1]\0", 4, options));
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_INVALID_STRING_CHAR, json_parse(&v, "\"a\0b\"", 5, options));
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_INVALID_VALUE, json_parse(&v, "[\0]", 3, options));
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_INVALID_VALUE, json_parse(&v, "\0", 1, options));
+    }
+
+    // std::string_view 与 Document
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, std::string_view("{\"a\":1}xyz", 7)));
+    EXPECT_EQ_INT64(1, v.getObj()->find("a")->second.getInt64());
+    v.freeSpace();
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_EXPECT_VALUE, json_parse(&v, std::string_view()));
+    Document document;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&document, std::string("[\"s\", 2]")));
+    EXPECT_EQ_STRING("s", (*document.getRoot()->getArray())[0].getJStr()->s, 1);
+
+    // 输入恰好结束在一页内存的末尾
+    const size_t page = 4096;
+    char* mem = static_cast<char*>(aligned_alloc(page, page));
+    for (size_t len = 0; len < 100; ++len) {
+        char* json = mem + page - (len + 1);
+        json[0] = '1';
+        memset(json + 1, len % 2 ? ' ' : '\n', len);
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json, len + 1));
+        json = mem + page - (len + 2);
+        json[0] = '"';
+        memset(json + 1, 'z', len);
+        json[len + 1] = '"';
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json, len + 2));
+        EXPECT_EQ_SIZE_T(len, v.getJStr()->len);
+        v.freeSpace();
+    }
+    free(mem);
+}
+
+static void test_parse_depth() {
+    ParseOptions options;
+    FieldValue v;
+    options.maxDepth = 2;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "[[1], {\"a\": 2}]", options));
+    v.freeSpace();
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&v, "[[1], {\"a\": []}]", options));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&v, "{\"a\": {\"b\": {}}}", options));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse_indexed(&v, "[[[1]]]", options));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse_parallel(&v, "[1, [[2]], 3]", 2, options));
+    options.maxDepth = 0;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "1", options));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&v, "[]", options));
+
+    // 出错时已经解析出的元素与键都被释放（由 ASan 检查）
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COLON, json_parse(&v, "[\"s\", [1, {\"k\": [\"x\"], \"key\" 1}]]"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, json_parse(&v, "{\"a\": [\"s\", {}, [2] 3]}"));
+
+    // 一百万个 '['：默认的层数限制
+    const std::string deep(1000000, '[');
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&v, deep.c_str()));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse_indexed(&v, deep.c_str()));
+    TapeDocument tape;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&tape, deep.c_str()));
+    SumHandler sum;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse_sax(deep.c_str(), sum));
+    IncrementalParser incremental;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, incremental.feed(deep.data(), deep.size()));
+
+    // 层数限制最多放宽到 MAX_DEPTH_LIMIT：恰好这么深的闭合文档在各个解析器中都能完成解析与析构，
+    // 再深一层、或者两百万层的闭合文档都被拒绝，不会耗尽线程的栈
+    options.maxDepth = SIZE_MAX;
+    const size_t maxLimit = ParseOptions::MAX_DEPTH_LIMIT;
+    const std::string deepest = std::string(maxLimit, '[') + std::string(maxLimit, ']');
+    const std::string deeper = "[" + deepest + "]";
+    const std::string huge = std::string(2000000, '[') + std::string(2000000, ']');
+    const std::string deepestElement = "[1, " + std::string(maxLimit - 1, '[') + std::string(maxLimit - 1, ']') + "]";
+    const std::string deeperElement = "[1, " + deepest + "]";
+    for (const std::string* json : { &deepest, &deeper, &huge }) {
+        const auto expect = json == &deepest ? JsonParseStatus::PARSE_OK : JsonParseStatus::PARSE_DEPTH_EXCEEDED;
+        {
+            FieldValue tree;
+            EXPECT_EQ_INT(expect, json_parse(&tree, json->c_str(), options));
+            EXPECT_EQ_INT(expect, json_parse(&tree, json->data(), json->size(), options));
+            EXPECT_EQ_INT(expect, json_parse_indexed(&tree, json->c_str(), options));
+        }
+        Document doc;
+        EXPECT_EQ_INT(expect, json_parse(&doc, json->c_str(), options));
+        EXPECT_EQ_INT(expect, json_parse(&tape, json->c_str(), options));
+        EXPECT_EQ_INT(expect, json_parse_sax(json->c_str(), sum, options));
+        IncrementalParser unlimited(options);
+        EXPECT_EQ_INT(expect, unlimited.feed(json->data(), json->size()));
+    }
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_parallel(&v, deepestElement.c_str(), 2, options));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse_parallel(&v, deeperElement.c_str(), 2, options));
+    Document doc;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&doc, deepest.c_str(), options));
+    const std::string packed = msgpackEncode(doc.getRoot());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, msgpack_decode(&v, packed.data(), packed.size(), options));
+    v.freeSpace();
+
+    // 恰好达到限制的嵌套
+    const size_t limit = ParseOptions::DEFAULT_MAX_DEPTH;
+    const std::string nested = std::string(limit, '[') + std::string(limit, ']');
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, nested.c_str()));
+    v.freeSpace();
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&tape, nested.c_str()));
+    const std::string over = "[" + nested + "]";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&v, over.c_str()));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&tape, over.c_str()));
+
+    // 外层递归、内层用显式栈解析时，层数限制与出错时的释放都跨过两者的交界
+    auto alternate = [](int levels, const char* inner) {
+        std::string s;
+        for (int i = 0; i < levels; ++i)
+            s += i % 2 ? "{\"k\": " : "[\"s\", ";
+        s += inner;
+        for (int i = levels - 1; i >= 0; --i)
+            s += i % 2 ? "}" : "]";
+        return s;
+    };
+    options.maxDepth = 40;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, alternate(40, "1").c_str(), options));
+    EXPECT_EQ_INT(JsonFieldType::J_ARRAY, v.getType());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&v, alternate(41, "1").c_str(), options));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COMMA_OR_CURLY_BRACKET, json_parse(&v, alternate(40, "1 2").c_str()));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, json_parse(&v, alternate(41, "1 2").c_str()));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());
+
+    // Tape、SAX 与增量解析同样可以收紧或放宽限制
+    ParseOptions tight;
+    tight.maxDepth = 2;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&tape, "[[1], {\"a\": 2}]", tight));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&tape, "[[1], {\"a\": []}]", tight));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_sax("[[1], {\"a\": 2}]", sum, tight));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse_sax("[[1], {\"a\": []}]", sum, tight));
+    IncrementalParser tightIncremental(tight);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, tightIncremental.feed("[[1], {\"a\": 2}]", 16));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, tightIncremental.finish(&v));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, tightIncremental.feed("[[1], {\"a\": []}]", 17));
+    tightIncremental.reset();
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, tightIncremental.feed("[[[", 3));
+    ParseOptions loose;
+    loose.maxDepth = limit + 1;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&tape, over.c_str(), loose));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse_sax(over.c_str(), sum, loose));
+    IncrementalParser looseIncremental(loose);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, looseIncremental.feed(over.data(), over.size()));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, looseIncremental.finish(&v));
+    EXPECT_EQ_INT(JsonFieldType::J_ARRAY, v.getType());
+}
+
+static void test_field_value_move() {
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "{\"a\": [1, \"x\"], \"b\": \"y\"}"));
+    FieldValue w(std::move(v));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());
+    EXPECT_EQ_INT(JsonFieldType::J_OBJECT, w.getType());
+    EXPECT_EQ_SIZE_T(2, w.getObj()->size());
+
+    // 移动赋值先释放目标原有的内容；值与容器析构时释放自己的内存（由 ASan 检查）
+    FieldValue s;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&s, "\"old\""));
+    s = std::move(w);
+    EXPECT_EQ_INT(JsonFieldType::J_OBJECT, s.getType());
+    std::vector<FieldValue> values;
+    values.push_back(std::move(s));
+    for (int i = 0; i < 100; ++i) {
+        values.emplace_back();
+        json_parse(&values.back(), "[\"z\", {\"k\": []}]");
+    }
+    EXPECT_EQ_INT(JsonFieldType::J_ARRAY, values[100].getType());
+    EXPECT_EQ_STRING("y", values[0].getObj()->find("b")->second.getJStr()->s, 1);
+
+    // 解析到已有内容的值中时先释放原来的内容
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "[\"first\"]"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "[\"second\"]"));
+    EXPECT_EQ_STRING("second", (*v.getArray())[0].getJStr()->s, 6);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, json_parse(&v, "[\"third\" 1]"));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());
+
+    // 每个以 FieldValue* 为目标的入口都先释放原来的内容（泄漏由 ASan 检查）
+    const std::string path = writeTempFile("reparse", "[\"file\"]");
+    Projection projection;
+    projection.add("/0");
+    const std::string packed = msgpackEncode(&values[100]);
+    IncrementalParser incremental;
+    std::deque<std::string> insituBuffers;  // 原地解析会改写输入，每次使用新的缓冲区
+    const std::function<JsonParseStatus(FieldValue*)> reparse[] = {
+        [](FieldValue* t) { return json_parse(t, "[\"a\"]"); },
+        [](FieldValue* t) { return json_parse(t, "[\"a\"]", 5); },
+        [&](FieldValue* t) {
+            insituBuffers.emplace_back("[\"insitu\"]");
+            return json_parse_insitu(t, &insituBuffers.back()[0]);
+        },
+        [](FieldValue* t) { return json_parse_indexed(t, "[\"a\"]"); },
+        [&](FieldValue* t) { return json_parse_file(t, path.c_str()); },
+        [](FieldValue* t) { return json_parse_parallel(t, "[\"a\"]", 2); },
+        [&](FieldValue* t) { return json_parse(t, "[\"a\"]", projection); },
+        [&](FieldValue* t) { return msgpack_decode(t, packed); },
+        [&](FieldValue* t) {
+            incremental.feed("[\"chunk\"]", 9);
+            return incremental.finish(t);
+        },
+    };
+    // 原来的内容分别属于值自己、借用原地解析的输入、借用 Document 的 Arena
+    size_t reparsed = 0;
+    for (auto& parse : reparse) {
+        FieldValue owned;
+        json_parse(&owned, "[\"x\", [1]]");
+        reparsed += parse(&owned) == JsonParseStatus::PARSE_OK && owned.getType() == JsonFieldType::J_ARRAY;
+        char buffer[] = "[\"x\", [1]]";
+        FieldValue insituArray;
+        json_parse_insitu(&insituArray, buffer);
+        reparsed += parse(&insituArray) == JsonParseStatus::PARSE_OK && insituArray.getType() == JsonFieldType::J_ARRAY;
+        FieldValue insituString;
+        char stringBuffer[] = "\"x\"";
+        json_parse_insitu(&insituString, stringBuffer);
+        reparsed += parse(&insituString) == JsonParseStatus::PARSE_OK && insituString.getType() == JsonFieldType::J_ARRAY;
+        Document source;
+        json_parse(&source, "[\"x\", {\"k\": \"y\"}]");
+        FieldValue arenaOld(std::move(*source.getRoot()));
+        reparsed += parse(&arenaOld) == JsonParseStatus::PARSE_OK && !arenaOld.isBorrowed();
+    }
+    EXPECT_EQ_SIZE_T(4 * sizeof(reparse) / sizeof(reparse[0]), reparsed);
+    remove(path.c_str());
+
+    // Document 中的值属于 Arena，移动出来之后析构也不会释放
+    Document doc;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&doc, "[\"arena\"]"));
+    {
+        FieldValue borrowed(std::move(*doc.getRoot()));
+        EXPECT_EQ_INT(1, borrowed.isBorrowed());
+    }
+}
+
+/**
+ * 递归比较两棵 FieldValue 树
+ */
+static bool valueEquals(const FieldValue* a, const FieldValue* b) {
+    if (a->getType() != b->getType())
+        return false;
+    switch (a->getType()) {
+        case JsonFieldType::J_NUMBER:
+            return a->getNumber() == b->getNumber();
+        case JsonFieldType::J_INT64:
+            return a->getInt64() == b->getInt64();
+        case JsonFieldType::J_UINT64:
+            return a->getUint64() == b->getUint64();
+        case JsonFieldType::J_STRING:
+            return a->getJStr()->len == b->getJStr()->len
+                   && memcmp(a->getJStr()->s, b->getJStr()->s, a->getJStr()->len) == 0;
+        case JsonFieldType::J_ARRAY: {
+            if (a->getArray()->size() != b->getArray()->size())
+                return false;
+            for (size_t i = 0; i < a->getArray()->size(); ++i) {
+                if (!valueEquals(&(*a->getArray())[i], &(*b->getArray())[i]))
+                    return false;
+            }
+            return true;
+        }
+        case JsonFieldType::J_OBJECT: {
+            if (a->getObj()->size() != b->getObj()->size())
+                return false;
+            for (auto x = a->getObj()->begin(), y = b->getObj()->begin(); x != a->getObj()->end(); ++x, ++y) {
+                if (x->first.len != y->first.len || memcmp(x->first.s, y->first.s, x->first.len) != 0
+                    || !valueEquals(&x->second, &y->second))
+                    return false;
+            }
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+static void test_json_path() {
+    // RFC 6901 第 5 节的例子
+    const char* json = "{\"foo\": [\"bar\", \"baz\"], \"\": 0, \"a/b\": 1, \"c%d\": 2, \"e^f\": 3, \"g|h\": 4,"
+                       " \"i\\\\j\": 5, \"k\\\"l\": 6, \" \": 7, \"m~n\": 8}";
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json));
+    const struct {
+        const char* path;
+        int64_t expect;
+    } pointers[] = {
+        {"/", 0}, {"/a~1b", 1}, {"/c%d", 2}, {"/e^f", 3}, {"/g|h", 4},
+        {"/i\\j", 5}, {"/k\"l", 6}, {"/ ", 7}, {"/m~0n", 8}
+    };
+    LazyDocument doc(json);
+    LazyValue root;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, doc.getRoot(&root));
+    for (auto& p : pointers) {
+        JsonPath path;
+        EXPECT_EQ_INT(1, path.compile(p.path));
+        const FieldValue* found = path.evaluateFirst(&v);
+        EXPECT_EQ_INT(1, found != nullptr);
+        if (found != nullptr)
+            EXPECT_EQ_INT64(p.expect, found->getInt64());
+        std::vector<LazyValue> raw;
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, path.evaluate(root, &raw));
+        EXPECT_EQ_SIZE_T(1, raw.size());
+        int64_t i = -1;
+        if (!raw.empty())
+            raw[0].getInt64(&i);
+        EXPECT_EQ_INT64(p.expect, i);
+    }
+    JsonPath path;
+    EXPECT_EQ_INT(1, path.compile(""));
+    EXPECT_EQ_INT(1, path.evaluateFirst(&v) == &v);
+    EXPECT_EQ_INT(1, path.compile("/foo"));
+    EXPECT_EQ_INT(JsonFieldType::J_ARRAY, path.evaluateFirst(&v)->getType());
+    EXPECT_EQ_INT(1, path.compile("/foo/1"));
+    EXPECT_EQ_STRING("baz", path.evaluateFirst(&v)->getJStr()->s, 3);
+    EXPECT_EQ_INT(1, path.compile("/foo/2"));
+    EXPECT_EQ_INT(1, path.evaluateFirst(&v) == nullptr);
+    EXPECT_EQ_INT(1, path.compile("/foo/01"));
+    EXPECT_EQ_INT(1, path.evaluateFirst(&v) == nullptr);
+
+    // JSON Pointer 的数字记号也可以是对象的键；JSONPath 的 [n] 只匹配数组
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v,
+        "{\"a\": {\"b\": [10, 11, 12, {\"c\": true}], \"0\": \"zero\"}, \"x.y\": 1,"
+        " \"list\": [{\"id\": 1}, {\"name\": \"n\"}, {\"id\": 3}]}"));
+    EXPECT_EQ_INT(1, path.compile("/a/0"));
+    EXPECT_EQ_STRING("zero", path.evaluateFirst(&v)->getJStr()->s, 4);
+    EXPECT_EQ_INT(1, path.compile("$.a[0]"));
+    EXPECT_EQ_INT(1, path.evaluateFirst(&v) == nullptr);
+    EXPECT_EQ_INT(1, path.compile("$.a.b[3].c"));
+    EXPECT_EQ_INT(JsonFieldType::J_TRUE, path.evaluateFirst(&v)->getType());
+    EXPECT_EQ_INT(1, path.compile("$['x.y']"));
+    EXPECT_EQ_INT64(1, path.evaluateFirst(&v)->getInt64());
+    EXPECT_EQ_INT(1, path.compile("$.x.y"));
+    EXPECT_EQ_INT(1, path.evaluateFirst(&v) == nullptr);
+    EXPECT_EQ_INT(1, path.compile("$[\"a\"][\"b\"][1]"));
+    EXPECT_EQ_INT64(11, path.evaluateFirst(&v)->getInt64());
+    EXPECT_EQ_INT(1, path.compile("$.list[*].id"));
+    std::vector<const FieldValue*> matches;
+    path.evaluate(&v, &matches);
+    EXPECT_EQ_SIZE_T(2, matches.size());
+    EXPECT_EQ_INT64(3, matches[1]->getInt64());
+    EXPECT_EQ_INT(1, path.compile("$.a.*"));
+    matches.clear();
+    path.evaluate(&v, &matches);
+    EXPECT_EQ_SIZE_T(2, matches.size());
+    EXPECT_EQ_INT(1, path.compile("$"));
+    EXPECT_EQ_INT(1, path.evaluateFirst(&v) == &v);
+
+    // 语法错误
+    const char* invalid[] = {"a", "/~", "/~2", "$.", "$a", "$[", "$[1", "$[-1]", "$[01]", "$['a", "$['a'", "$[*"};
+    for (auto p : invalid) {
+        EXPECT_EQ_INT(0, path.compile(p));
+        EXPECT_EQ_SIZE_T(0, path.getSteps().size());
+    }
+
+    // 在 json 文本上求值的结果与在树上相同
+    const char* text = "{\"list\": [{\"id\": 1}, {\"name\": \"n\"}, {\"id\": 3}], \"a\": {\"b\": [10, 11, 12]}}";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, text));
+    const char* paths[] = {"$.list[*].id", "/a/b/2", "$.a.*[*]", "$.*", "/list/1/name", "/missing"};
+    for (auto p : paths) {
+        EXPECT_EQ_INT(1, path.compile(p));
+        LazyDocument lazy(text);
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, lazy.getRoot(&root));
+        std::vector<LazyValue> raw;
+        matches.clear();
+        path.evaluate(&v, &matches);
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, path.evaluate(root, &raw));
+        EXPECT_EQ_SIZE_T(matches.size(), raw.size());
+        for (size_t i = 0; i < raw.size() && i < matches.size(); ++i) {
+            FieldValue parsed;
+            EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, raw[i].parse(&parsed));
+            EXPECT_EQ_INT(1, valueEquals(&parsed, matches[i]));
+        }
+    }
+
+    // 一组路径：每条路径取第一个匹配的值
+    JsonPathSet set;
+    size_t id = 0;
+    const char* setPaths[] = {"/list/0/id", "$.list[*].name", "$.a.b[1]", "/missing", "$.list[2].id", "/a/b/1"};
+    for (size_t i = 0; i < sizeof(setPaths) / sizeof(setPaths[0]); ++i) {
+        EXPECT_EQ_INT(1, set.add(setPaths[i], &id));
+        EXPECT_EQ_SIZE_T(i, id);
+    }
+    EXPECT_EQ_INT(0, set.add("$[", &id));
+    EXPECT_EQ_SIZE_T(6, set.size());
+    set.evaluate(&v, &matches);
+    EXPECT_EQ_SIZE_T(6, matches.size());
+    EXPECT_EQ_INT64(1, matches[0]->getInt64());
+    EXPECT_EQ_STRING("n", matches[1]->getJStr()->s, 1);
+    EXPECT_EQ_INT64(11, matches[2]->getInt64());
+    EXPECT_EQ_INT(1, matches[3] == nullptr);
+    EXPECT_EQ_INT64(3, matches[4]->getInt64());
+    EXPECT_EQ_INT(1, matches[5] == matches[2]);
+    for (int round = 0; round < 2; ++round) {
+        LazyDocument lazy(text);
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, lazy.getRoot(&root));
+        std::vector<LazyValue> values;
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, set.evaluate(root, &values));
+        EXPECT_EQ_SIZE_T(6, values.size());
+        for (size_t i = 0; i < values.size(); ++i) {
+            EXPECT_EQ_INT(matches[i] != nullptr, values[i].exists());
+            FieldValue parsed;
+            if (values[i].exists() && values[i].parse(&parsed) == JsonParseStatus::PARSE_OK)
+                EXPECT_EQ_INT(1, valueEquals(&parsed, matches[i]));
+        }
+    }
+
+    // 所有路径都找到值之后不再扫描剩下的部分，因此之后的语法错误不会被发现
+    JsonPathSet first;
+    EXPECT_EQ_INT(1, first.add("/a", &id));
+    LazyDocument broken("{\"a\": 1, \"b\": [}");
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, broken.getRoot(&root));
+    std::vector<LazyValue> values;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, first.evaluate(root, &values));
+    EXPECT_EQ_INT(1, values[0].exists());
+    EXPECT_EQ_INT(1, first.add("/c", &id));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET, first.evaluate(root, &values));
+}
+
+static void test_parse_projection() {
+    const char* json = "{\"id\": 7, \"name\": \"fairy\", \"tags\": [\"a\", \"b\", \"c\"],"
+                       " \"address\": {\"city\": \"Beijing\", \"zip\": \"100000\"},"
+                       " \"items\": [{\"id\": 1, \"v\": [1, 2]}, {\"id\": 2, \"v\": []}, 3]}";
+    Projection projection;
+    EXPECT_EQ_INT(1, projection.add("/id"));
+    EXPECT_EQ_INT(1, projection.add("$.address.city"));
+    EXPECT_EQ_INT(1, projection.add("$.items[*].id"));
+    EXPECT_EQ_INT(1, projection.add("/tags/1"));
+    EXPECT_EQ_INT(1, projection.add("/name/first"));
+    EXPECT_EQ_INT(0, projection.add("$["));
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json, projection));
+    const FieldObject* obj = v.getObj();
+    EXPECT_EQ_SIZE_T(4, obj->size());
+    EXPECT_EQ_INT64(7, obj->find("id")->second.getInt64());
+    // 字符串之下没有值，不出现在结果中
+    EXPECT_EQ_INT(1, obj->find("name") == obj->end());
+    // 数组中没有选中的元素以 null 占位，最后一个选中的元素之后不保留
+    const FieldArray* tags = obj->find("tags")->second.getArray();
+    EXPECT_EQ_SIZE_T(2, tags->size());
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, (*tags)[0].getType());
+    EXPECT_EQ_STRING("b", (*tags)[1].getJStr()->s, 1);
+    const FieldObject* address = obj->find("address")->second.getObj();
+    EXPECT_EQ_SIZE_T(1, address->size());
+    EXPECT_EQ_STRING("Beijing", address->find("city")->second.getJStr()->s, 7);
+    const FieldArray* items = obj->find("items")->second.getArray();
+    EXPECT_EQ_SIZE_T(2, items->size());
+    EXPECT_EQ_SIZE_T(1, (*items)[0].getObj()->size());
+    EXPECT_EQ_INT64(2, (*items)[1].getObj()->find("id")->second.getInt64());
+
+    // 通配符与指定的键重叠时两者的选择合并，与加入的顺序无关
+    const char* orders[][2] = {{"$.items[*].id", "/items/0/v/1"}, {"/items/0/v/1", "$.items[*].id"}};
+    for (auto& order : orders) {
+        Projection overlap;
+        overlap.add(order[0]);
+        overlap.add(order[1]);
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json, overlap));
+        items = v.getObj()->find("items")->second.getArray();
+        EXPECT_EQ_SIZE_T(2, (*items)[0].getObj()->size());
+        EXPECT_EQ_SIZE_T(1, (*items)[1].getObj()->size());
+        const FieldArray* values = (*items)[0].getObj()->find("v")->second.getArray();
+        EXPECT_EQ_SIZE_T(2, values->size());
+        EXPECT_EQ_INT64(2, (*values)[1].getInt64());
+    }
+
+    // 前缀路径保留整个子树；空路径保留整个文档
+    Projection prefix;
+    prefix.add("/address/city");
+    prefix.add("/address");
+    prefix.add("/address/zip/more");
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json, prefix));
+    EXPECT_EQ_SIZE_T(2, v.getObj()->find("address")->second.getObj()->size());
+    Projection all;
+    all.add("");
+    FieldValue full;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&full, json));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json, all));
+    EXPECT_EQ_INT(1, valueEquals(&v, &full));
+    Projection none;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json, none));
+    EXPECT_EQ_SIZE_T(0, v.getObj()->size());
+
+    // 跳过的子树也按完整的语法校验，错误状态与 json_parse 相同
+    Projection some;
+    some.add("/id");
+    some.add("$.nested.a[1]");
+    const std::string base = "{\"id\": 12, \"name\": \"fairy \\\"json\\\"\", \"tags\": [true, false, null],"
+                             " \"nested\": {\"a\": [1.5, -2, {\"b\": \"\\u4e2d\"}]}, \"e\": []}";
+    const char alphabet[] = "{}[]:,\" \\tfn1-.e";
+    srand(20210518);
+    size_t same = 0;
+    for (int round = 0; round < 3000; ++round) {
+        std::string input = base;
+        for (int k = rand() % 3 + 1; k > 0; --k)
+            input[rand() % input.size()] = alphabet[rand() % (sizeof(alphabet) - 1)];
+        const auto expect = json_parse(&full, input.c_str());
+        const auto actual = json_parse(&v, input.c_str(), some);
+        same += expect == actual && (actual == JsonParseStatus::PARSE_OK || v.getType() == JsonFieldType::J_NULL);
+    }
+    EXPECT_EQ_SIZE_T(3000, same);
+
+    // 跳过的深层嵌套不递归，同样受 maxDepth 限制
+    const size_t levels = ParseOptions::MAX_DEPTH_LIMIT - 1;
+    const std::string nested = "{\"id\": 1, \"deep\": " + std::string(levels, '[') + std::string(levels, ']') + "}";
+    ParseOptions options;
+    options.maxDepth = 64;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&v, nested.c_str(), some, options));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());
+    options.maxDepth = SIZE_MAX;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, nested.c_str(), some, options));
+    EXPECT_EQ_SIZE_T(1, v.getObj()->size());
+    const std::string deeper = "{\"deep\": [" + std::string(levels, '[') + std::string(levels, ']') + "]}";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_parse(&v, deeper.c_str(), some, options));
+}
+
+static void test_msgpack() {
+    // 编码后再解码与 json_parse 的结果相同，类型也不变
+    std::vector<std::string> inputs = {
+        "null", "true", "false", "0", "127", "128", "255", "256", "65535", "65536", "4294967295", "4294967296",
+        "9223372036854775807", "18446744073709551615", "-1", "-32", "-33", "-128", "-129", "-32768", "-32769",
+        "-2147483648", "-2147483649", "-9223372036854775808", "1.5", "-0.0", "1e308", "3.141592653589793",
+        "\"\"", "\"a\\u0000b\"", "\"\\u4e2d\\ud834\\udd1e\"", "[]", "{}", "[[[]], {}]",
+        "{\"a\": [1, -2, 3.5, \"x\", null, true, false], \"b\": {\"c\": {}}, \"a\": 2}",
+        "\"" + std::string(31, 's') + "\"", "\"" + std::string(32, 's') + "\"", "\"" + std::string(300, 's') + "\"",
+        "\"" + std::string(70000, 's') + "\"",
+    };
+    std::string wide = "{";
+    for (int i = 0; i < 20; ++i)
+        wide += (i == 0 ? "\"k" : ", \"k") + std::to_string(i) + "\": " + std::to_string(i * 1000);
+    inputs.push_back(wide + "}");
+    std::string longArray = "[0";
+    for (int i = 1; i < 70000; ++i)
+        longArray += "," + std::to_string(i % 300 - 150);
+    inputs.push_back(longArray + "]");
+    for (auto& json : inputs) {
+        FieldValue v, decoded;
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json.c_str()));
+        const std::string packed = msgpackEncode(&v);
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, msgpack_decode(&decoded, packed));
+        EXPECT_EQ_INT(1, valueEquals(&v, &decoded));
+        EXPECT_EQ_INT(1, jsonStringify(&v) == jsonStringify(&decoded));
+        Document doc;
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, msgpack_decode(&doc, packed));
+        EXPECT_EQ_INT(1, valueEquals(&v, doc.getRoot()));
+    }
+
+    // 整数使用最短的格式
+    const struct {
+        const char* json;
+        const char* packed;
+        size_t len;
+    } encodings[] = {
+        {"null", "\xc0", 1}, {"1", "\x01", 1}, {"-1", "\xff", 1}, {"200", "\xcc\xc8", 2},
+        {"-200", "\xd1\xff\x38", 3}, {"\"a\"", "\xa1" "a", 2}, {"[]", "\x90", 1}, {"{\"a\":[true]}", "\x81\xa1" "a\x91\xc3", 5},
+        {"1.5", "\xcb\x3f\xf8\x00\x00\x00\x00\x00\x00", 9},
+    };
+    for (auto& e : encodings) {
+        FieldValue v;
+        json_parse(&v, e.json);
+        const std::string packed = msgpackEncode(&v);
+        EXPECT_EQ_SIZE_T(e.len, packed.size());
+        EXPECT_EQ_INT(1, packed == std::string(e.packed, e.len));
+    }
+
+    // 其他编码器可能产生的 float32 与非最短的整数
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, msgpack_decode(&v, std::string("\xca\x3f\xc0\x00\x00", 5)));
+    EXPECT_EQ_DOUBLE(1.5, v.getNumber());
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, msgpack_decode(&v, std::string("\xcf\x00\x00\x00\x00\x00\x00\x00\x05", 9)));
+    EXPECT_EQ_INT(JsonFieldType::J_INT64, v.getType());
+    EXPECT_EQ_INT64(5, v.getInt64());
+
+    // 截断的输入与不支持的格式
+    FieldValue src;
+    json_parse(&src, "{\"name\": \"fairy\", \"list\": [1, 300, -70000, 2.5, \"" + std::string(40, 'x') + "\"], \"n\": null}");
+    const std::string packed = msgpackEncode(&src);
+    size_t truncated = 0;
+    for (size_t len = 0; len < packed.size(); ++len) {
+        const auto retStatus = msgpack_decode(&v, packed.data(), len);
+        truncated += retStatus == JsonParseStatus::PARSE_INVALID_BINARY && v.getType() == JsonFieldType::J_NULL;
+    }
+    Document doc;
+    for (size_t len = 0; len < packed.size(); ++len) {
+        const auto retStatus = msgpack_decode(&doc, packed.data(), len);
+        truncated += retStatus == JsonParseStatus::PARSE_INVALID_BINARY && doc.getRoot()->getType() == JsonFieldType::J_NULL;
+    }
+    EXPECT_EQ_SIZE_T(packed.size() * 2, truncated);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_ROOT_NOT_SINGULAR, msgpack_decode(&v, packed + '\xc0'));
+    EXPECT_EQ_INT(JsonFieldType::J_NULL, v.getType());
+    const std::string invalid[] = {
+        std::string("\xc1", 1), std::string("\xc4\x01\x00", 3), std::string("\xd4\x01\x00", 3),
+        std::string("\x81\x01\x01", 3), std::string("\xdd\xff\xff\xff\xff\xc0", 6), std::string("\xdf\x7f\xff\xff\xff", 5),
+    };
+    for (auto& bytes : invalid)
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_INVALID_BINARY, msgpack_decode(&v, bytes));
+
+    // 嵌套层数受 maxDepth 限制
+    const std::string deep = std::string(ParseOptions::DEFAULT_MAX_DEPTH + 1, '\x91') + '\xc0';
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, msgpack_decode(&v, deep));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, msgpack_decode(&v, deep.substr(1)));
+}
+
+struct BindAddress {
+    std::string city;
+    std::string street;
+    int zip = 0;
+};
+FAIRY_JSON_BIND(BindAddress, city, street, zip)
+
+struct BindUser {
+    int64_t id = 0;
+    std::string name;
+    std::optional<std::string> email;
+    std::vector<std::string> tags;
+    double score = 0.0;
+    bool active = false;
+    BindAddress address;
+    std::vector<BindAddress> history;
+    std::optional<std::vector<int>> lucky;
+    uint8_t level = 1;
+    std::vector<bool> flags;
+};
+FAIRY_JSON_BIND(BindUser, id, name, email, tags, score, active, address, history, lucky, level, flags)
+
+static void test_bind() {
+    // 直接解析到结构体，未声明的键被跳过，没有出现的成员保持默认值
+    const char* json = " {\"id\": -42, \"name\": \"fairy\\u4e2d\", \"email\": null, \"tags\": [\"a\", \"b\\n\"],"
+                       " \"extra\": {\"x\": [1, {\"y\": \"}\"}]}, \"score\": 2, \"active\": true,"
+                       " \"address\": {\"zip\": 100000, \"city\": \"Beijing\", \"street\": \"Chang'an\"},"
+                       " \"history\": [{\"city\": \"A\"}, {}], \"lucky\": [7, 8], \"flags\": [true, false, true]} ";
+    BindUser user;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_read(&user, json));
+    EXPECT_EQ_INT64(-42, user.id);
+    EXPECT_EQ_INT(1, user.name == "fairy\xe4\xb8\xad");
+    EXPECT_FALSE(user.email.has_value());
+    EXPECT_EQ_SIZE_T(2, user.tags.size());
+    EXPECT_EQ_INT(1, user.tags[1] == "b\n");
+    EXPECT_EQ_DOUBLE(2.0, user.score);
+    EXPECT_TRUE(user.active);
+    EXPECT_EQ_INT(1, user.address.city == "Beijing" && user.address.street == "Chang'an");
+    EXPECT_EQ_INT(100000, user.address.zip);
+    EXPECT_EQ_SIZE_T(2, user.history.size());
+    EXPECT_EQ_INT(1, user.history[0].city == "A" && user.history[1].city.empty());
+    EXPECT_TRUE(user.lucky.has_value() && user.lucky->size() == 2 && (*user.lucky)[1] == 8);
+    EXPECT_EQ_INT(1, user.level);
+    EXPECT_EQ_INT(1, user.flags == std::vector<bool>({true, false, true}));
+
+    // 序列化按声明的顺序输出成员，空的 optional 被省略；结果与 json_parse 后 jsonStringify 的结果相同
+    const std::string written = json_write(user);
+    EXPECT_EQ_INT(1, written == "{\"id\":-42,\"name\":\"fairy\xe4\xb8\xad\",\"tags\":[\"a\",\"b\\n\"],\"score\":2.0,"
+                                "\"active\":true,\"address\":{\"city\":\"Beijing\",\"street\":\"Chang'an\",\"zip\":100000},"
+                                "\"history\":[{\"city\":\"A\",\"street\":\"\",\"zip\":0},{\"city\":\"\",\"street\":\"\",\"zip\":0}],"
+                                "\"lucky\":[7,8],\"level\":1,\"flags\":[true,false,true]}");
+    FieldValue tree;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&tree, written.c_str()));
+    EXPECT_EQ_INT(1, jsonStringify(&tree) == written);
+    BindUser again;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_read(&again, written));
+    EXPECT_EQ_INT(1, json_write(again) == written);
+    std::string appended = "[";
+    json_write(user.address, &appended);
+    EXPECT_EQ_INT(1, appended == "[{\"city\":\"Beijing\",\"street\":\"Chang'an\",\"zip\":100000}");
+
+    // 重复的键以最后一个为准，vector 会先被清空
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_read(&user, "{\"id\": 1, \"tags\": [\"x\"], \"id\": 2, \"email\": \"e\"}"));
+    EXPECT_EQ_INT64(2, user.id);
+    EXPECT_EQ_SIZE_T(1, user.tags.size());
+    EXPECT_TRUE(user.email.has_value() && *user.email == "e");
+
+    // 标量与容器
+    int i = 0;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_read(&i, " -2147483648 "));
+    EXPECT_EQ_INT(-2147483647 - 1, i);
+    uint64_t u = 0;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_read(&u, "18446744073709551615"));
+    EXPECT_EQ_UINT64(18446744073709551615ULL, u);
+    float f = 0.0f;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_read(&f, "1.5e1"));
+    EXPECT_EQ_DOUBLE(15.0, static_cast<double>(f));
+    std::vector<std::vector<double>> matrix;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_read(&matrix, "[[1, 2.5], [], [-0.5]]"));
+    EXPECT_EQ_INT(1, json_write(matrix) == "[[1.0,2.5],[],[-0.5]]");
+    EXPECT_EQ_INT(1, json_write(std::nan("")) == "null");
+    EXPECT_EQ_INT(1, json_write(std::optional<int>()) == "null");
+    EXPECT_EQ_INT(1, json_write(std::string("a\"\\\x01")) == "\"a\\\"\\\\\\u0001\"");
+
+    // 类型不符或者超出范围
+    const struct {
+        const char* json;
+        JsonParseStatus status;
+    } ints[] = {
+        {"2147483648", JsonParseStatus::PARSE_TYPE_MISMATCH}, {"-2147483649", JsonParseStatus::PARSE_TYPE_MISMATCH},
+        {"1.0", JsonParseStatus::PARSE_TYPE_MISMATCH}, {"\"1\"", JsonParseStatus::PARSE_TYPE_MISMATCH},
+        {"null", JsonParseStatus::PARSE_TYPE_MISMATCH}, {"[1]", JsonParseStatus::PARSE_TYPE_MISMATCH},
+        {"[1", JsonParseStatus::PARSE_MISS_COMMA_OR_SQUARE_BRACKET}, {"\"1", JsonParseStatus::PARSE_MISS_QUOTATION_MARK},
+        {"01", JsonParseStatus::PARSE_ROOT_NOT_SINGULAR}, {"", JsonParseStatus::PARSE_EXPECT_VALUE},
+        {"1 2", JsonParseStatus::PARSE_ROOT_NOT_SINGULAR}, {"tru", JsonParseStatus::PARSE_INVALID_VALUE},
+    };
+    for (auto& e : ints)
+        EXPECT_EQ_INT(e.status, json_read(&i, e.json));
+    uint8_t level = 0;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, json_read(&level, "256"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, json_read(&level, "-1"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, json_read(&u, "-1"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, json_read(&f, "1e300"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, json_read(&f, "-3.5e38"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_read(&f, "-3.4e38"));
+    EXPECT_EQ_INT(1, std::isfinite(f));
+    std::vector<float> floats;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, json_read(&floats, "[1.5, 1e300]"));
+    double d = 0.0;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_read(&d, "1e300"));
+    EXPECT_EQ_DOUBLE(1e300, d);
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, json_read(&user, "{\"level\": 300}"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, json_read(&user, "{\"address\": []}"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, json_read(&user, "{\"tags\": [\"a\", 1]}"));
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_TYPE_MISMATCH, json_read(&user, "[]"));
+    // 值本身有语法错误时报告语法错误
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_MISS_QUOTATION_MARK, json_read(&user, "{\"address\": [\"a]}"));
+
+    // 语法错误与 json_parse 相同
+    const char* invalid[] = {
+        "{", "{\"id\"", "{\"id\" 1}", "{\"id\": 1,}", "{\"id\": 1 \"name\": \"a\"}", "{1: 2}", "{\"tags\": [\"a\",]}",
+        "{\"tags\": [\"a\" \"b\"]}", "{\"extra\": [1, 2}", "{\"extra\": {\"a\" 1}}", "{\"id\": 1} x", "{\"name\": \"\\x\"}",
+        "{\"extra\": tru}", "{\"score\": -}",
+    };
+    for (auto s : invalid) {
+        FieldValue v;
+        EXPECT_EQ_INT(json_parse(&v, s), json_read(&user, s));
+    }
+
+    // 嵌套层数受 maxDepth 限制，跳过的值也一样
+    std::vector<std::vector<std::vector<int>>> cube;
+    ParseOptions options;
+    options.maxDepth = 2;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_read(&cube, "[[[1]]]", options));
+    options.maxDepth = 3;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_read(&cube, "[[[1]]]", options));
+    const std::string deep = "{\"extra\": " + std::string(ParseOptions::DEFAULT_MAX_DEPTH, '[')
+                             + std::string(ParseOptions::DEFAULT_MAX_DEPTH, ']') + "}";
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_DEPTH_EXCEEDED, json_read(&user, deep));
 }
 
 static void test_stringify() {
@@ -217,7 +2334,78 @@ static void test_stringify() {
     auto retStatus = json_parse(&v, oldJsonStr.c_str());
     EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, retStatus);
     auto afterJsonStr = jsonStringify(&v);
-    std::cout << afterJsonStr << std::endl;
+    EXPECT_EQ_STRING("{\"n\":null,\"f\":false,\"t\":true,\"i\":123,\"s\":\"abc\","
+                     "\"a\":[1,2,3],\"o\":{\"1\":1,\"2\":2,\"3\":3}}",
+                     afterJsonStr.c_str(), afterJsonStr.size());
+    v.freeSpace();
+}
+
+#define TEST_ROUNDTRIP(json) \
+    do {\
+        FieldValue v;\
+        EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, json));\
+        auto out = jsonStringify(&v);\
+        EXPECT_EQ_STRING(json, out.c_str(), out.size());\
+        v.freeSpace();\
+    } while(0)
+
+static void test_stringify_roundtrip() {
+    TEST_ROUNDTRIP("null");
+    TEST_ROUNDTRIP("false");
+    TEST_ROUNDTRIP("true");
+    TEST_ROUNDTRIP("0");
+    TEST_ROUNDTRIP("-9223372036854775808");
+    TEST_ROUNDTRIP("18446744073709551615");
+    TEST_ROUNDTRIP("1.5");
+    TEST_ROUNDTRIP("-1e-300");
+    TEST_ROUNDTRIP("\"\"");
+    TEST_ROUNDTRIP("\"Hello\"");
+    TEST_ROUNDTRIP("\"Hello\\nWorld\"");
+    TEST_ROUNDTRIP("\"\\\" \\\\ / \\b \\f \\n \\r \\t\"");
+    TEST_ROUNDTRIP("\"\\u0000\\u0001\\u001F\"");
+    TEST_ROUNDTRIP("\"a long string without any escape, longer than one simd block\\t\"");
+    TEST_ROUNDTRIP("\"\xE2\x82\xAC\"");
+    TEST_ROUNDTRIP("[]");
+    TEST_ROUNDTRIP("{}");
+    TEST_ROUNDTRIP("[[],{},[null]]");
+    TEST_ROUNDTRIP("{\"\\n\":{\"\":[]}}");
+}
+
+static void test_stringify_pretty() {
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "{\"a\":[1,{}],\"b\":[],\"c\":\"x\"}"));
+    std::string out;
+    jsonStringify(&v, &out, StringifyStyle::PRETTY, 2);
+    EXPECT_EQ_STRING("{\n"
+                     "  \"a\": [\n"
+                     "    1,\n"
+                     "    {}\n"
+                     "  ],\n"
+                     "  \"b\": [],\n"
+                     "  \"c\": \"x\"\n"
+                     "}", out.c_str(), out.size());
+    v.freeSpace();
+
+    // NaN 与无穷大没有 json 表示，写作 null
+    FieldValue n(JsonFieldType::J_NUMBER);
+    n.setNumber(NAN);
+    out.clear();
+    jsonStringify(&n, &out);
+    EXPECT_EQ_STRING("null", out.c_str(), out.size());
+}
+
+static void test_stringify_append() {
+    // 结果追加到已有内容之后，缓冲区可以在多次调用之间复用
+    FieldValue v;
+    EXPECT_EQ_INT(JsonParseStatus::PARSE_OK, json_parse(&v, "[1,\"two\",3.0]"));
+    std::string out = "prefix:";
+    jsonStringify(&v, &out);
+    EXPECT_EQ_STRING("prefix:[1,\"two\",3.0]", out.c_str(), out.size());
+    out.clear();
+    for (int i = 0; i < 3; ++i)
+        jsonStringify(&v, &out);
+    EXPECT_EQ_STRING("[1,\"two\",3.0][1,\"two\",3.0][1,\"two\",3.0]", out.c_str(), out.size());
+    v.freeSpace();
 }
 
 static void test_parse() {
@@ -226,12 +2414,53 @@ static void test_parse() {
     test_parse_invalid_value();
     test_parse_root_not_singular();
     test_parse_number();
+    test_parse_integer();
+    test_parse_number_against_strtod();
+    test_parse_number_too_big();
+    test_parse_invalid_number();
     test_parse_string();
     test_parse_invalid_string_escape();
     test_parse_invalid_string_char();
+    test_parse_missing_quotation_mark();
+    test_parse_invalid_unicode_hex();
+    test_parse_invalid_unicode_surrogate();
+    test_parse_string_in_array();
+    test_scan_string_special();
+    test_parse_string_at_buffer_end();
+    test_skip_whitespace();
     test_parse_array();
     test_parse_object();
+    test_parse_miss_key();
+    test_parse_miss_colon();
+    test_parse_miss_comma_or_curly_bracket();
+    test_parse_wide_object();
+    test_parse_document();
+    test_parse_insitu();
+    test_write_number();
+    test_write_double_roundtrip();
+    test_key_pool();
+    test_key_pool_concurrent();
+    test_lazy_document();
+    test_lazy_errors();
+    test_structural_index();
+    test_parse_indexed();
+    test_tape_document();
+    test_parse_sax();
+    test_parse_incremental();
+    test_parse_ndjson();
+    test_parse_parallel();
+    test_parse_file();
+    test_parse_length();
+    test_parse_depth();
+    test_field_value_move();
+    test_json_path();
+    test_parse_projection();
+    test_msgpack();
+    test_bind();
     test_stringify();
+    test_stringify_roundtrip();
+    test_stringify_pretty();
+    test_stringify_append();
 }
 
 
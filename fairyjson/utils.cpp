@@ -3,26 +3,23 @@
 //
 #include "utils.h"
 #include <cstdlib>
+#include <cstring>
 
 using namespace std;
 using namespace fairy;
 
-char* fetchStrFromCharStack(stack<char>& cStack, size_t len) {
-    char* buf = new char[len + 1];
-    buf[len] = '\0';
-    while (len != 0) {
-        --len;
-        buf[len] = cStack.top();
-        cStack.pop();
-    }
-    return buf;
+char* copyStr(const char* s, size_t len, Arena* arena) {
+    char* str = arena != nullptr ? static_cast<char*>(arena->allocate(len + 1, 1)) : new char[len + 1];
+    if (len != 0)
+        memcpy(str, s, len);
+    str[len] = '\0';
+    return str;
 }
 
-
-void popN(std::stack<char>& s, size_t n) {
-    for (size_t i = 0; i < n; ++i) {
-        s.pop();
-    }
+char* fetchStrFromBuffer(vector<char>& buf, size_t head, Arena* arena) {
+    char* str = copyStr(buf.data() + head, buf.size() - head, arena);
+    buf.resize(head);
+    return str;
 }
 
 const char* parseHex4(const char* p, unsigned* u) {
@@ -39,29 +36,36 @@ const char* parseHex4(const char* p, unsigned* u) {
 }
 
 
-static void putCharToStack(fairy::ParseContext* c, unsigned const value) {
-    assert(value <= 255);
-    c->charStack.push(static_cast<char>(value));
-}
-
-
-void encodeUtf8(fairy::ParseContext* c, unsigned u) {
-    if (u <= 0x7F)
-        putCharToStack(c, u & 0xFF);
+size_t encodeUtf8(char* out, unsigned u) {
+    auto o = reinterpret_cast<unsigned char*>(out);
+    if (u <= 0x7F) {
+        o[0] = u & 0xFF;
+        return 1;
+    }
     else if (u <= 0x7FF) {
-        putCharToStack(c, 0xC0 | ((u >> 6) & 0xFF));
-        putCharToStack(c, 0x80 | ( u       & 0x3F));
+        o[0] = 0xC0 | ((u >> 6) & 0xFF);
+        o[1] = 0x80 | ( u       & 0x3F);
+        return 2;
     }
     else if (u <= 0xFFFF) {
-        putCharToStack(c, 0xE0 | ((u >> 12) & 0xFF));
-        putCharToStack(c, 0x80 | ((u >>  6) & 0x3F));
-        putCharToStack(c, 0x80 | ( u        & 0x3F));
+        o[0] = 0xE0 | ((u >> 12) & 0xFF);
+        o[1] = 0x80 | ((u >>  6) & 0x3F);
+        o[2] = 0x80 | ( u        & 0x3F);
+        return 3;
     }
     else {
         assert(u <= 0x10FFFF);
-        putCharToStack(c, 0xF0 | ((u >> 18) & 0xFF));
-        putCharToStack(c, 0x80 | ((u >> 12) & 0x3F));
-        putCharToStack(c, 0x80 | ((u >>  6) & 0x3F));
-        putCharToStack(c, 0x80 | ( u        & 0x3F));
+        o[0] = 0xF0 | ((u >> 18) & 0xFF);
+        o[1] = 0x80 | ((u >> 12) & 0x3F);
+        o[2] = 0x80 | ((u >>  6) & 0x3F);
+        o[3] = 0x80 | ( u        & 0x3F);
+        return 4;
     }
-}
\ No newline at end of file
+}
+
+
+void encodeUtf8(fairy::ParseContext* c, unsigned u) {
+    char buf[4];
+    const size_t n = encodeUtf8(buf, u);
+    c->strBuf.insert(c->strBuf.end(), buf, buf + n);
+}
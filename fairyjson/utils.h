@@ -4,7 +4,10 @@
 
 #pragma once
 
-#include <stack>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "fairy_json.h"
 
 /**
@@ -25,25 +28,49 @@ inline bool isDigit(char ch) {
     return ch >= '0' && ch <= '9';
 }
 
-char* fetchStrFromCharStack(std::stack<char>& cStack, size_t len);
+/**
+ * 计算一段字节的 FNV-1a 哈希值
+ * @param s 起始位置
+ * @param len 字节数
+ * @return 32 位哈希值
+ */
+inline uint32_t hashBytes(const char* s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
 
 /**
- * 对一个栈进行弹出 N 次的操作
- * @param s STL中的栈
- * @param n 弹出的次数
+ * 把一段字节拷贝成以 '\0' 结尾的新字符串
+ * @param s 源字节
+ * @param len 字节数
+ * @param arena 非空时字符串从 Arena 中分配，否则使用 new[]
+ * @return 新字符串
  */
-void popN(std::stack<char>& s, size_t n);
+char* copyStr(const char* s, size_t len, fairy::Arena* arena);
+
+/**
+ * 取出缓冲区中从 head 开始的全部字节，一次拷贝成以 '\0' 结尾的字符串，并把缓冲区截回 head
+ * @param buf 字符串缓冲区
+ * @param head 字符串在缓冲区中的起始位置
+ * @param arena 同 copyStr
+ * @return 取出的字符串
+ */
+char* fetchStrFromBuffer(std::vector<char>& buf, size_t head, fairy::Arena* arena);
 
 
 /**
  * 在解析字符串时出现错误所调用的函数，该函数会完成一些退出前的清理工作
  * @param c 解析上下文
- * @param head 原先 stack 的头位置
+ * @param head 原先缓冲区的末尾位置
  * @param retStatus 解析的错误状态
  * @return 完成清理工作后直接返回所传入的错误状态
  */
 inline fairy::JsonParseStatus strParseError(fairy::ParseContext* c, size_t head, const fairy::JsonParseStatus retStatus) {
-    popN(c->charStack, c->charStack.size() - head);
+    c->strBuf.resize(head);
     return retStatus;
 }
 
@@ -55,9 +82,130 @@ inline fairy::JsonParseStatus strParseError(fairy::ParseContext* c, size_t head,
  */
 const char* parseHex4(const char* p, unsigned* u);
 
+/**
+ * 把码点编码成 UTF-8，直接写到 out 处
+ * @param out 输出位置，至少要有 4 个字节的空间
+ * @param u 所要转换的码点
+ * @return 写入的字节数
+ */
+size_t encodeUtf8(char* out, unsigned u);
+
 /**
  * 把码点编码成 UTF-8，写进缓冲区
  * @param c 解析上下文
  * @param u 所要转换的码点
  */
-void encodeUtf8(fairy::ParseContext* c, unsigned u);
\ No newline at end of file
+void encodeUtf8(fairy::ParseContext* c, unsigned u);
+
+namespace fairy {
+    /**
+     * @return 当前字符；有界的输入读到末尾时返回 '\0'，与以 '\0' 结尾的输入一致
+     */
+    inline char peekChar(const ParseContext* c) {
+        return c->bounded && c->json == c->end ? '\0' : *c->json;
+    }
+
+    /**
+     * @return 当前位置是否为输入的末尾；指定了 end 时，end 之前的 '\0' 不算末尾
+     */
+    inline bool atInputEnd(const ParseContext* c) {
+        return c->end != nullptr ? c->json == c->end : *c->json == '\0';
+    }
+
+    /*
+     * 以下是 fairy_json.cpp 中的语法规则，供按需解析等其他模块复用
+     * 调用时 c->json 指向值的第一个字符，成功后移动到值之后
+     */
+
+    /**
+     * 解析 json 数字
+     */
+    JsonParseStatus parseNumber(ParseContext* c, FieldValue* v);
+
+    /**
+     * 解码一个字符串，但不为结果分配内存
+     * 没有转义时 *pStr 直接指向输入，否则指向 strBuf 中原有内容之后的部分，调用者用完后需要把 strBuf 截回原来的长度
+     * @param c c->json 指向开头的 '"'
+     * @param pStr 解码结果的起始位置，不以 '\0' 结尾
+     * @param pLen 解码结果的长度
+     */
+    JsonParseStatus decodeStringRaw(ParseContext* c, const char** pStr, size_t* pLen);
+
+    /**
+     * 解析字符串，结果拷贝成以 '\0' 结尾的新字符串，存在 Arena 时从 Arena 中分配，否则使用 new[]
+     */
+    JsonParseStatus parseStringRaw(ParseContext* c, char** pStr, size_t* pLen);
+
+    /**
+     * 创建一个空数组，存在 Arena 时连同数组对象本身一起放进 Arena
+     */
+    FieldArray* newArray(ParseContext* c);
+
+    /**
+     * 创建一个空对象，存在 Arena 时连同对象本身一起放进 Arena，键的所有权与 parseStringRaw 分配的方式一致
+     */
+    FieldObject* newObject(ParseContext* c);
+
+    /**
+     * 解析任意一个 json 值
+     */
+    JsonParseStatus parseValue(ParseContext* c, FieldValue* v);
+
+    /**
+     * 解析整个 json 文本：ws value ws，之后必须是输入的末尾
+     */
+    JsonParseStatus parseRoot(ParseContext* c, FieldValue* v);
+
+    /*
+     * 以下两个函数只用于以 '\0' 结尾的输入，供投影解析与结构体绑定跳过不需要的值
+     */
+
+    /**
+     * 读取对象成员的键以及之后的 ':'，键解码在 c->strBuf 或输入中，不分配内存
+     * @param key 解码后的键，在下一次解码之前有效
+     */
+    JsonParseStatus readMemberKey(ParseContext* c, const char** key, size_t* len);
+
+    /**
+     * 校验并跳过 c->json 处的一个值，不建立任何节点，错误状态与 json_parse 相同
+     * @param open 尚未闭合的括号，由调用者提供以便复用；嵌套层数从 c->depth 开始计算
+     */
+    JsonParseStatus skipValue(ParseContext* c, std::string* open);
+
+    /**
+     * 把带引号并转义过的字符串追加到 out 的末尾，转义规则与 jsonStringify 相同
+     */
+    void appendQuotedString(std::string* out, const char* s, size_t len);
+
+    /**
+     * 把 [0, count) 分成每批 batch 个，由 threads 个线程按批领取并调用 fn(worker, begin, end)
+     * 调用线程本身作为第 0 个工作线程；只需要一个线程时不创建新线程
+     * @param threads 最多使用的线程数
+     * @param fn 各线程同时调用，worker 为线程的编号，同一个编号不会被两个线程同时使用
+     */
+    template <typename F>
+    void parallelFor(size_t threads, size_t count, size_t batch, F fn) {
+        threads = std::min(threads, (count + batch - 1) / batch);
+        if (threads <= 1) {
+            if (count != 0)
+                fn(size_t(0), size_t(0), count);
+            return;
+        }
+        std::atomic<size_t> next(0);
+        auto run = [&](size_t worker) {
+            while (true) {
+                const size_t begin = next.fetch_add(batch);
+                if (begin >= count)
+                    break;
+                fn(worker, begin, std::min(begin + batch, count));
+            }
+        };
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for (size_t i = 1; i < threads; ++i)
+            pool.emplace_back(run, i);
+        run(0);
+        for (auto& t : pool)
+            t.join();
+    }
+}